@@ -73,6 +73,7 @@ class Heap
 		heap_key_t he_key;
 		heap_secondary_key_t he_s_key;
 		void*		he_elem;
+		int*		he_pos;		// kept up to date with the index, or 0
 	} *h_elems;
 	unsigned int    h_s_key;
 	unsigned int	h_size;
@@ -82,11 +83,17 @@ class Heap
 	unsigned int	parent(unsigned int i)	{ return ((i - 1) / 2); }
 	unsigned int	left(unsigned int i)	{ return ((i * 2) + 1); }
 	unsigned int	right(unsigned int i)	{ return ((i + 1) * 2); }
+	void place(unsigned int i, const Heap_elem& he) {
+		// store he at elems[i] and tell it where it is
+		h_elems[i] = he;
+		if (he.he_pos)
+			*he.he_pos = i;
+	};
 	void swap(unsigned int i, unsigned int j) {
 		// swap elems[i] with elems[j] in this
 		Heap_elem __he = h_elems[i];
-		h_elems[i] = h_elems[j];
-		h_elems[j] = __he;
+		place(i, h_elems[j]);
+		place(j, __he);
 		return;
 	};
 	unsigned int	KEY_LESS_THAN(heap_key_t k1, heap_secondary_key_t ks1,
@@ -113,6 +120,14 @@ public:
 	 */
 	int heap_delete(void* elem);
 
+	/*
+	 * int	heap_delete_at(unsigned int i):			O(log n) algorithm
+	 *
+	 *	Same as heap_delete() for the element at index i, as kept in
+	 *	the pos argument of heap_insert().
+	 */
+	int heap_delete_at(unsigned int i);
+
 	/*
 	 * Couple of functions to support iterating through all things on the
 	 * heap without having to know what a heap looks like.  To be used as
@@ -146,12 +161,14 @@ public:
 	};
 
 	/*
-	 * void	heap_insert(Heap *h, heap_key_t *key, void *elem)
+	 * void	heap_insert(Heap *h, heap_key_t *key, void *elem, int *pos)
 	 *
 	 * Insert <key, elem> into heap h.
 	 * Adjust heap_size if we hit the limit.
+	 * If pos is given, *pos holds the index of elem as long as it is
+	 * in the heap.
 	 */
-	void heap_insert(heap_key_t key, void* elem);
+	void heap_insert(heap_key_t key, void* elem, int* pos = 0);
 
 	/*
 	 * void *heap_min(Heap *h)
@@ -0,0 +1,394 @@
+/* -*-  Mode:C++; c-basic-offset:8; tab-width:8; indent-tabs-mode:t -*- */
+
+/*
+ * ladder-scheduler.cc
+ *
+ * Scheduler based on a ladder queue.
+ *
+ * W.T. Tang, R.S.M. Goh and I.L.-J. Thng. Ladder queue: An O(1)
+ * priority queue structure for large-scale discrete event simulation.
+ * ACM Trans. on Modeling and Computer Simulation, 15(3):175--204, 2005.
+ *
+ * Basic idea of this scheduler: events far in the future are appended
+ * to the unsorted top list.  When the events up to then are used up,
+ * top is spread over the buckets of a rung, each bucket again unsorted.
+ * The first non-empty bucket of the lowest rung is either spread over
+ * the buckets of a new, finer rung (more than threshold_ events) or
+ * sorted into the bottom list, from which events are dequeued.  Each
+ * event is moved a bounded number of times, so insert and deque are
+ * O(1) amortized, unlike the calendar queue there is no resize and
+ * bursts of events with the same time cost no bucket scans.
+ *
+ * Implementation notes: an event is routed to top, to the first rung
+ * whose unconsumed buckets cover its time or else to bottom, and the
+ * events moved between them keep their order.  Events with the same
+ * time therefore always stay in the order they were inserted in, as
+ * with Scheduler/Calendar, bottom is sorted with a stable merge sort.
+ * All lists are circular with a sentinel Event, Event::next_ and
+ * Event::prev_ link them, so cancel() unlinks without a search.
+ * Event::pos_ is 1 while an event is in bottom, so that cancel() keeps
+ * the size of bottom.
+ * lookup() walks the whole queue.
+ *
+ * Memory used by this scheduler is O(N) for the buckets of the rungs,
+ * which are kept allocated for reuse.
+ */
+#include <scheduler.h>
+#include <float.h>
+#include <assert.h>
+
+
+static class LadderSchedulerClass : public TclClass
+{
+public:
+        LadderSchedulerClass() : TclClass("Scheduler/Ladder") {}
+        TclObject* create(int /* argc */, const char*const* /* argv */) {
+                return (new LadderScheduler);
+        }
+} class_ladder_sched;
+
+#define LIST_EMPTY(l)		((l)->next_ == (l))
+#define LIST_INIT(l)		((l)->next_ = (l)->prev_ = (l))
+#define LIST_APPEND(l, e)		\
+    do {				\
+	(e)->prev_ = (l)->prev_;	\
+	(e)->next_ = (l);		\
+	(l)->prev_->next_ = (e);	\
+	(l)->prev_ = (e);		\
+    } while (0)
+
+/* number of events, time range and whether sorted of list l */
+static void
+scan(Event* l, int& n, double& min, double& max, bool& sorted)
+{
+	n = 0;
+	sorted = true;
+	min = DBL_MAX;
+	max = -DBL_MAX;
+	for (Event* e = l->next_; e != l; e = e->next_) {
+		if (e->time_ < max)
+			sorted = false;
+		if (e->time_ < min)
+			min = e->time_;
+		if (e->time_ > max)
+			max = e->time_;
+		n++;
+	}
+}
+
+/* stable merge sort of the n events from e on, linked by next_ only */
+static Event*
+msort(Event* e, int n)
+{
+	if (n <= 1) {
+		if (e)
+			e->next_ = 0;
+		return e;
+	}
+	int h = n / 2;
+	Event* b = e;
+	for (int i = 0; i < h; i++)
+		b = b->next_;
+	Event* a = msort(e, h);
+	b = msort(b, n - h);
+
+	Event head;
+	Event* t = &head;
+	while (a && b) {
+		// on equal times the earlier half goes first
+		if (b->time_ < a->time_) {
+			t->next_ = b;
+			b = b->next_;
+		} else {
+			t->next_ = a;
+			a = a->next_;
+		}
+		t = t->next_;
+	}
+	t->next_ = a ? a : b;
+	return head.next_;
+}
+
+LadderScheduler::LadderScheduler() : top_start_(-DBL_MAX), nrungs_(0),
+	nbottom_(0), qsize_(0)
+{
+	bind("threshold_", &threshold_);
+	if (threshold_ < 1)
+		threshold_ = 1;
+	bottom_limit_ = threshold_;
+	LIST_INIT(&top_);
+	LIST_INIT(&bottom_);
+	for (int i = 0; i < LADDER_MAX_RUNGS; i++) {
+		rungs_[i].bucket_ = 0;
+		rungs_[i].size_ = 0;
+		rungs_[i].nbuckets_ = 0;
+		rungs_[i].cur_ = 0;
+	}
+}
+
+LadderScheduler::~LadderScheduler()
+{
+	// XXX free events?
+	for (int i = 0; i < LADDER_MAX_RUNGS; i++)
+		delete [] rungs_[i].bucket_;
+}
+
+/*
+ * The list an event at time t is appended to, or 0 for bottom.
+ * Every rung only takes times from its current bucket on, so the
+ * events of a rung are later than those of the rungs below it and
+ * than those of bottom.
+ */
+Event*
+LadderScheduler::route(double t)
+{
+	if (t >= top_start_)
+		return (&top_);
+	for (int i = 0; i < nrungs_; i++) {
+		Rung& r = rungs_[i];
+		double x = (t - r.start_) / r.width_;
+		// a used up rung waiting for the one below it takes nothing
+		if (x >= r.cur_ && r.cur_ < r.nbuckets_) {
+			int b = (x < r.nbuckets_) ? (int)x : r.nbuckets_ - 1;
+			return (&r.bucket_[b]);
+		}
+	}
+	return (0);
+}
+
+void
+LadderScheduler::insert(Event* e)
+{
+	if (qsize_ == 0) {
+		// start over with an empty ladder
+		nrungs_ = 0;
+		top_start_ = -DBL_MAX;
+	}
+	++qsize_;
+
+	Event* l = route(e->time_);
+	if (l) {
+		e->pos_ = -1;
+		LIST_APPEND(l, e);
+		return;
+	}
+	insertBottom(e);
+}
+
+void
+LadderScheduler::insertBottom(Event* e)
+{
+	double t = e->time_;
+	Event* after = bottom_.prev_;
+
+	// after the last event not later than e, FIFO for same-time events
+	if (after != &bottom_ && t < after->time_) {
+		if (t < bottom_.next_->time_)
+			after = &bottom_;
+		else
+			while (t < after->time_)
+				after = after->prev_;
+	}
+	e->prev_ = after;
+	e->next_ = after->next_;
+	after->next_->prev_ = e;
+	after->next_ = e;
+	e->pos_ = 1;
+
+	if (++nbottom_ <= bottom_limit_)
+		return;
+
+	// bottom grew too long to insert into, spread it over a new rung
+	int n;
+	double min, max;
+	bool sorted;
+	scan(&bottom_, n, min, max, sorted);
+	nbottom_ = n;
+	if (spawn(&bottom_, n, min, max)) {
+		nbottom_ = 0;
+		bottom_limit_ = threshold_;
+	} else
+		bottom_limit_ = 2 * n;
+}
+
+/*
+ * Spread the n events of list over the buckets of a new lowest rung,
+ * which starts at min.  Fails if there are too few events, no more
+ * rungs or all events have the same time.
+ */
+bool
+LadderScheduler::spawn(Event* list, int n, double min, double max)
+{
+	if (n <= threshold_ || nrungs_ == LADDER_MAX_RUNGS || max <= min)
+		return (false);
+	int nb = (n < LADDER_MAX_BUCKETS) ? n : LADDER_MAX_BUCKETS;
+	double width = (max - min) / nb;
+	if (width <= 0.0)
+		return (false);
+
+	Rung& r = rungs_[nrungs_];
+	if (r.size_ < nb) {
+		delete [] r.bucket_;
+		r.bucket_ = new Event[nb];
+		r.size_ = nb;
+	}
+	for (int i = 0; i < nb; i++)
+		LIST_INIT(&r.bucket_[i]);
+	r.nbuckets_ = nb;
+	r.cur_ = 0;
+	r.start_ = min;
+	r.width_ = width;
+
+	Event* e = list->next_;
+	while (e != list) {
+		Event* next = e->next_;
+		double x = (e->time_ - min) / width;
+		int b = (x < nb) ? (int)x : nb - 1;
+		e->pos_ = -1;
+		LIST_APPEND(&r.bucket_[b], e);
+		e = next;
+	}
+	LIST_INIT(list);
+	nrungs_++;
+	return (true);
+}
+
+/* move the n events of list to the empty bottom */
+void
+LadderScheduler::toBottom(Event* list, int n, bool sorted)
+{
+	assert(LIST_EMPTY(&bottom_));
+	if (n == 0)
+		return;
+	if (!sorted) {
+		list->prev_->next_ = 0;
+		Event* e = msort(list->next_, n);
+		Event* p = list;
+		for (; e; e = e->next_) {
+			p->next_ = e;
+			e->prev_ = p;
+			p = e;
+		}
+		p->next_ = list;
+		list->prev_ = p;
+	}
+	bottom_.next_ = list->next_;
+	bottom_.prev_ = list->prev_;
+	bottom_.next_->prev_ = &bottom_;
+	bottom_.prev_->next_ = &bottom_;
+	LIST_INIT(list);
+	for (Event* e = bottom_.next_; e != &bottom_; e = e->next_)
+		e->pos_ = 1;
+	nbottom_ = n;
+	bottom_limit_ = threshold_;
+}
+
+/*
+ * Make sure bottom holds the earliest events, taking them from the
+ * lowest rung or from top.  Returns false if the queue is empty.
+ */
+bool
+LadderScheduler::refill()
+{
+	int n;
+	double min, max;
+	bool sorted;
+
+	while (LIST_EMPTY(&bottom_)) {
+		if (nrungs_ == 0) {
+			if (LIST_EMPTY(&top_))
+				return (false);
+			scan(&top_, n, min, max, sorted);
+			if (spawn(&top_, n, min, max)) {
+				Rung& r = rungs_[0];
+				top_start_ = r.start_ + r.nbuckets_ * r.width_;
+			} else
+				toBottom(&top_, n, sorted);
+			// top only takes events after all others
+			if (top_start_ < max)
+				top_start_ = max;
+			continue;
+		}
+		Rung& r = rungs_[nrungs_ - 1];
+		while (r.cur_ < r.nbuckets_ && LIST_EMPTY(&r.bucket_[r.cur_]))
+			r.cur_++;
+		if (r.cur_ == r.nbuckets_) {
+			nrungs_--;
+			continue;
+		}
+		Event* l = &r.bucket_[r.cur_++];
+		scan(l, n, min, max, sorted);
+		if (!spawn(l, n, min, max))
+			toBottom(l, n, sorted);
+	}
+	return (true);
+}
+
+const Event*
+LadderScheduler::head()
+{
+	if (!refill())
+		return (0);
+	return (bottom_.next_);
+}
+
+Event*
+LadderScheduler::deque()
+{
+	if (!refill())
+		return (0);
+	Event* e = bottom_.next_;
+	bottom_.next_ = e->next_;
+	e->next_->prev_ = &bottom_;
+	e->next_ = e->prev_ = 0;
+	e->pos_ = -1;
+	--nbottom_;
+	--qsize_;
+	return (e);
+}
+
+/*
+ * Cancel an event.  As with the other schedulers the caller must free
+ * the event if necessary, this routine only removes it from the queue.
+ */
+void
+LadderScheduler::cancel(Event* e)
+{
+	if (e->uid_ <= 0)	// event not in queue
+		return;
+	assert(e->prev_->next_ == e);
+	assert(e->next_->prev_ == e);
+	e->next_->prev_ = e->prev_;
+	e->prev_->next_ = e->next_;
+	e->next_ = e->prev_ = 0;
+	if (e->pos_ > 0) {
+		e->pos_ = -1;
+		--nbottom_;
+	}
+	e->uid_ = -e->uid_;
+	--qsize_;
+}
+
+Event*
+LadderScheduler::lookup(scheduler_uid_t uid)
+{
+	Event* l;
+	Event* e;
+
+	for (e = bottom_.next_; e != &bottom_; e = e->next_)
+		if (e->uid_ == uid)
+			return (e);
+	for (int i = nrungs_ - 1; i >= 0; i--) {
+		Rung& r = rungs_[i];
+		for (int b = r.cur_; b < r.nbuckets_; b++) {
+			l = &r.bucket_[b];
+			for (e = l->next_; e != l; e = e->next_)
+				if (e->uid_ == uid)
+					return (e);
+		}
+	}
+	for (e = top_.next_; e != &top_; e = e->next_)
+		if (e->uid_ == uid)
+			return (e);
+	return (0);
+}
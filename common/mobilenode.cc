@@ -129,6 +129,9 @@ MobileNode::MobileNode(void) :
 	log_target_ = 0;
 	next_ = 0;
 	radius_ = 0;
+	nextX_ = prevX_ = 0;
+	nextCell_ = prevCell_ = 0;
+	cell_ = -1;
 
 	position_update_interval_ = MN_POSITION_UPDATE_INTERVAL;
 	position_update_time_ = 0.0;
@@ -433,6 +436,8 @@ MobileNode::set_destination(double x, double y, double s)
 	}
   
 	position_update_time_ = Scheduler::instance().clock();
+	/* list-keeper, lets the grid index know about the new speed */
+	T_->updateNodesList(this, X_);
 
 #ifdef DEBUG
 	fprintf(stderr, "%d - %s: calling log_movement()\n", 
@@ -470,7 +475,7 @@ MobileNode::update_position()
 	double now = Scheduler::instance().clock();
 	double interval = now - position_update_time_;
 	double oldX = X_;
-	//double oldY = Y_;
+	double oldY = Y_;
 
 	if ((interval == 0.0)&&(position_update_time_!=0))
 		return;         // ^^^ for list-based imprvmnt 
@@ -486,7 +491,7 @@ MobileNode::update_position()
 	  Y_ = destY_;		// correct overshoot (slow? XXX)
 	
 	/* list based improvement */
-	if(oldX != X_)// || oldY != Y_)
+	if(oldX != X_ || oldY != Y_)
 		T_->updateNodesList(this, oldX);//, oldY);
 	// COMMENTED BY -VAL- // bound_position();
 
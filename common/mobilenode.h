@@ -162,6 +162,11 @@ public:
 	/* For list-keeper */
 	MobileNode* nextX_;
 	MobileNode* prevX_;
+	/* For the grid index of WirelessChannel */
+	MobileNode* nextCell_;
+	MobileNode* prevCell_;
+	int cell_;
+	inline Topography* topography() { return T_; }
 	
 protected:
 	/*
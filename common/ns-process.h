@@ -87,6 +87,12 @@ enum AppDataType {
 	//Diffusion ADU
 	DIFFUSION_DATA,
 
+	// TDL MAC aggregated data frame
+	TDL_AGG_DATA,
+
+	// TDL MAC neighbor list of a frame
+	TDL_NB_DATA,
+
 	// Last ADU
 	ADU_LAST
 
@@ -59,6 +59,8 @@ int p_info::addPacket(char *name)
 
 int Packet::hdrlen_ = 0;		// size of a packet's header
 Packet* Packet::free_;			// free list
+int Packet::num_alloc_ = 0;		// packets allocated
+int Packet::num_new_ = 0;		// packets created
 int hdr_cmn::offset_;			// static offset of common header
 int hdr_flags::offset_;			// static offset of flags header
 
@@ -149,6 +151,8 @@ class PacketHeaderManager : public TclObject {
 public:
 	PacketHeaderManager() {
 		bind("hdrlen_", &Packet::hdrlen_);
+		bind("num_alloc_", &Packet::num_alloc_);
+		bind("num_new_", &Packet::num_new_);
 	}
 };
 
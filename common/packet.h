@@ -480,6 +480,8 @@ typedef void (*FailureCallback)(Packet *,void *);
 class Packet : public Event {
 private:
 	unsigned char* bits_;	// header bits
+	unsigned char* own_;	// header bits of this packet, bits_ unless shared
+	Packet* shared_;	// packet whose header bits and data are in use
 //	unsigned char* data_;	// variable size buffer for 'data'
 //  	unsigned int datalen_;	// length of variable size buffer
 	AppData* data_;		// variable size buffer for 'data'
@@ -491,10 +493,16 @@ protected:
 public:
 	Packet* next_;		// for queues and the free list
 	static int hdrlen_;
+	static int num_alloc_;	// packets handed out by alloc() and sharedcopy()
+	static int num_new_;	// packets created, i.e. not taken from free_
 
-	Packet() : bits_(0), data_(0), ref_count_(0), next_(0) { }
+	Packet() : bits_(0), own_(0), shared_(0), data_(0), ref_count_(0),
+		   next_(0) { }
 	inline unsigned char* const bits() { return (bits_); }
 	inline Packet* copy() const;
+	inline Packet* sharedcopy();
+	inline void unshare();
+	inline int shared() const { return (shared_ != 0); }
 	inline Packet* refcopy() { ++ref_count_; return this; }
 	inline int& ref_count() { return (ref_count_); }
 	static inline Packet* alloc();
@@ -508,6 +516,10 @@ public:
 			abort();
 		return (&bits_[off]);
 	}
+	// Common header, private to the packet even when shared
+	inline unsigned char* access_own(int off) const {
+		return (&own_[off]);
+	}
 	// This is used for backward compatibility, i.e., assuming user data
 	// is PacketData and return its pointer.
 	inline unsigned char* accessdata() const {
@@ -522,10 +534,20 @@ public:
 		return data_;
 	}
 	inline void setdata(AppData* d) {
+		if (shared_ != 0)
+			unshare();
 		if (data_ != NULL)
 			delete data_;
 		data_ = d;
 	}
+	// Hand the user data over to the caller, leaving the packet without
+	inline AppData* takedata() {
+		if (shared_ != 0)
+			unshare();
+		AppData* d = data_;
+		data_ = 0;
+		return d;
+	}
 	inline int datalen() const { return data_ ? data_->size() : 0; }
 
 	// Monarch extn
@@ -639,7 +661,7 @@ struct hdr_cmn {
 	static int offset_;	// offset for this header
 	inline static int& offset() { return offset_; }
 	inline static hdr_cmn* access(const Packet* p) {
-		return (hdr_cmn*) p->access(offset_);
+		return (hdr_cmn*) p->access_own(offset_);
 	}
 
         /* per-field member functions */
@@ -699,7 +721,10 @@ inline Packet* Packet::alloc()
 		p->bits_ = new unsigned char[hdrlen_];
 		if (p == 0 || p->bits_ == 0)
 			abort();
+		p->own_ = p->bits_;
+		num_new_++;
 	}
+	num_alloc_++;
 	init(p); // Initialize bits_[]
 	(HDR_CMN(p))->next_hop_ = -2; // -1 reserved for IP_BROADCAST
 	(HDR_CMN(p))->last_hop_ = -2; // -1 reserved for IP_BROADCAST
@@ -743,6 +768,14 @@ inline void Packet::free(Packet* p)
 			 * == 0 (newed but never gets into the event queue.
 			 */
 			assert(p->uid_ <= 0);
+			if (p->shared_ != 0) {
+				// header bits and data belong to the shared packet
+				Packet* s = p->shared_;
+				p->shared_ = 0;
+				p->bits_ = p->own_;
+				p->data_ = 0;
+				free(s);
+			}
 			// Delete user data because we won't need it any more.
 			if (p->data_ != 0) {
 				delete p->data_;
@@ -763,6 +796,9 @@ inline Packet* Packet::copy() const
 
 	Packet* p = alloc();
 	memcpy(p->bits(), bits_, hdrlen_);
+	if (shared_)
+		memcpy(p->bits_ + hdr_cmn::offset(), own_ + hdr_cmn::offset(),
+		       sizeof(hdr_cmn));
 	if (data_)
 		p->data_ = data_->copy();
 	p->txinfo_.init(&txinfo_);
@@ -770,6 +806,58 @@ inline Packet* Packet::copy() const
 	return (p);
 }
 
+/*
+ * Copy for one receiver of a broadcast. The copy refers to the header bits
+ * and user data of this packet, which is kept until the last copy is freed.
+ * Only the common header (direction, error) and txinfo_ are private to the
+ * copy, anything else has to be modified after unshare() only.
+ */
+inline Packet* Packet::sharedcopy()
+{
+	Packet* s = shared_ ? shared_ : this;
+	Packet* p = free_;
+	if (p != 0) {
+		assert(p->fflag_ == FALSE);
+		free_ = p->next_;
+		assert(p->data_ == 0);
+		p->uid_ = 0;
+		p->time_ = 0;
+	} else {
+		p = new Packet;
+		p->own_ = new unsigned char[hdrlen_];
+		if (p->own_ == 0)
+			abort();
+		num_new_++;
+	}
+	num_alloc_++;
+	memcpy(p->own_ + hdr_cmn::offset(), own_ + hdr_cmn::offset(),
+	       sizeof(hdr_cmn));
+	p->bits_ = s->bits_;
+	p->data_ = s->data_;
+	p->shared_ = s->refcopy();
+	p->fflag_ = TRUE;
+	p->next_ = 0;
+	p->txinfo_.init(&txinfo_);
+
+	return (p);
+}
+
+/* Give the packet its own header bits and data, keeping its common header */
+inline void Packet::unshare()
+{
+	if (shared_ == 0)
+		return;
+	int off = hdr_cmn::offset();
+	int end = off + sizeof(hdr_cmn);
+	memcpy(own_, bits_, off);
+	memcpy(own_ + end, bits_ + end, hdrlen_ - end);
+	Packet* s = shared_;
+	shared_ = 0;
+	bits_ = own_;
+	data_ = data_ ? data_->copy() : 0;
+	free(s);
+}
+
 inline void
 Packet::dump_header(Packet *p, int offset, int length)
 {
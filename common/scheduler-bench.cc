@@ -0,0 +1,379 @@
+/* -*-	Mode:C++; c-basic-offset:8; tab-width:8; indent-tabs-mode:t -*- */
+
+/*
+ * scheduler-bench.cc
+ *
+ * Recording and replay of the event stream of a scheduler, to pick the
+ * scheduler which fits a scenario best, see sims/bench_sched.tcl.
+ *
+ * Scheduler/Record passes every call on to the scheduler it wraps and
+ * writes one line per insert, cancel and deque:
+ *	i <delay> <uid>		event uid inserted delay after the clock
+ *	c <uid>			event uid cancelled
+ *	d			earliest event dequeued
+ * Only the delays are kept, not the handlers, so a stream replays the
+ * same queue operations without the simulation behind them.
+ *
+ * SchedBench loads such a stream and replays it against any scheduler,
+ * which must not be the one of the simulator, and reports ns/op, the
+ * cache misses if the perf counters are available and the queue size.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "scheduler.h"
+
+
+class RecordScheduler : public Scheduler {
+public:
+	RecordScheduler() : sched_(0), fp_(0) {}
+	~RecordScheduler();
+	void cancel(Event*);
+	void insert(Event*);
+	Event* lookup(scheduler_uid_t uid) { return sched_->lookup(uid); }
+	Event* deque();
+	const Event* head() { return sched_->head(); }
+protected:
+	int command(int argc, const char*const* argv);
+	Scheduler* sched_;	// the scheduler doing the work
+	FILE* fp_;
+};
+
+static class RecordSchedulerClass : public TclClass {
+public:
+	RecordSchedulerClass() : TclClass("Scheduler/Record") {}
+	TclObject* create(int /* argc */, const char*const* /* argv */) {
+		return (new RecordScheduler);
+	}
+} class_record_sched;
+
+RecordScheduler::~RecordScheduler()
+{
+	if (fp_)
+		fclose(fp_);
+}
+
+void
+RecordScheduler::insert(Event* e)
+{
+	fprintf(fp_, "i %.17g ", e->time_ - clock_);
+	fprintf(fp_, UID_PRINTF_FORMAT, e->uid_);
+	fprintf(fp_, "\n");
+	sched_->insert(e);
+}
+
+void
+RecordScheduler::cancel(Event* e)
+{
+	if (e->uid_ > 0) {
+		fprintf(fp_, "c ");
+		fprintf(fp_, UID_PRINTF_FORMAT, e->uid_);
+		fprintf(fp_, "\n");
+	}
+	sched_->cancel(e);
+}
+
+Event*
+RecordScheduler::deque()
+{
+	Event* e = sched_->deque();
+	if (e)
+		fprintf(fp_, "d\n");
+	return (e);
+}
+
+/*
+ * $rec record <scheduler> <file>
+ *	wrap scheduler, which holds the events scheduled so far, and
+ *	become the scheduler of the simulator.  Used by Simulator
+ *	record-scheduler, not meant to be called later on.
+ */
+int
+RecordScheduler::command(int argc, const char*const* argv)
+{
+	Tcl& tcl = Tcl::instance();
+	if (argc == 4 && strcmp(argv[1], "record") == 0) {
+		Scheduler* s = (Scheduler*)TclObject::lookup(argv[2]);
+		if (s == 0 || s == this) {
+			tcl.resultf("no scheduler %s", argv[2]);
+			return (TCL_ERROR);
+		}
+		FILE* fp = fopen(argv[3], "w");
+		if (fp == 0) {
+			tcl.resultf("cannot open %s", argv[3]);
+			return (TCL_ERROR);
+		}
+		if (fp_)
+			fclose(fp_);
+		fp_ = fp;
+		sched_ = s;
+		clock_ = s->clock();
+		instance_ = this;
+		return (TCL_OK);
+	}
+	if (argc == 2 && strcmp(argv[1], "flush") == 0) {
+		if (fp_)
+			fflush(fp_);
+		return (TCL_OK);
+	}
+	return (Scheduler::command(argc, argv));
+}
+
+
+/*
+ * Replay of a recorded stream.  The events come from a free list and
+ * are found by their index in the stream, so that the replay measures
+ * the scheduler and not the bookkeeping around it.
+ */
+class SchedBench : public TclObject {
+public:
+	SchedBench() : ops_(0), nops_(0), ninserts_(0) {}
+	~SchedBench() { delete [] ops_; }
+protected:
+	int command(int argc, const char*const* argv);
+	int load(const char* file);
+	void run(Scheduler* s);
+
+	struct Op {
+		char type_;		// 'i', 'c' or 'd'
+		double delay_;		// insert
+		int index_;		// insert index of the event, insert or cancel
+	} *ops_;
+	int nops_;
+	int ninserts_;
+};
+
+static class SchedBenchClass : public TclClass {
+public:
+	SchedBenchClass() : TclClass("SchedBench") {}
+	TclObject* create(int, const char*const*) {
+		return (new SchedBench);
+	}
+} class_sched_bench;
+
+int
+SchedBench::load(const char* file)
+{
+	FILE* fp = fopen(file, "r");
+	if (fp == 0)
+		return (-1);
+
+	char line[128];
+	int n = 0;
+	while (fgets(line, sizeof(line), fp))
+		n++;
+	rewind(fp);
+	delete [] ops_;
+	ops_ = new Op[n];
+	nops_ = 0;
+	ninserts_ = 0;
+
+	// the uids of the stream to insert indexes
+	Tcl_HashTable ht;
+	Tcl_InitHashTable(&ht, TCL_ONE_WORD_KEYS);
+	while (nops_ < n && fgets(line, sizeof(line), fp)) {
+		Op& op = ops_[nops_];
+		char uid[64];
+		double delay;
+		Tcl_HashEntry* he;
+		int isnew;
+
+		op.type_ = line[0];
+		op.delay_ = 0;
+		op.index_ = -1;
+		switch (line[0]) {
+		case 'i':
+			if (sscanf(line + 1, "%lf %63s", &delay, uid) != 2)
+				continue;
+			op.delay_ = delay;
+			op.index_ = ninserts_++;
+			he = Tcl_CreateHashEntry(&ht, (char*)STRTOUID(uid),
+						 &isnew);
+			Tcl_SetHashValue(he, (ClientData)(long)op.index_);
+			break;
+		case 'c':
+			if (sscanf(line + 1, "%63s", uid) != 1)
+				continue;
+			he = Tcl_FindHashEntry(&ht, (char*)STRTOUID(uid));
+			if (he == 0)
+				continue;	// inserted before the recording
+			op.index_ = (int)(long)Tcl_GetHashValue(he);
+			break;
+		case 'd':
+			break;
+		default:
+			continue;
+		}
+		nops_++;
+	}
+	Tcl_DeleteHashTable(&ht);
+	fclose(fp);
+	return (nops_);
+}
+
+#ifdef __linux__
+static int
+perfOpen()
+{
+	struct perf_event_attr pe;
+	memset(&pe, 0, sizeof(pe));
+	pe.type = PERF_TYPE_HARDWARE;
+	pe.size = sizeof(pe);
+	pe.config = PERF_COUNT_HW_CACHE_MISSES;
+	pe.disabled = 1;
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+	return (syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0));
+}
+#endif
+
+/*
+ * Replay the stream against s and leave the result in the Tcl result:
+ *	ops inserts cancels deques	operations replayed
+ *	ns_per_op			wall clock time per operation
+ *	cache_misses			per operation, -1 without perf counters
+ *	q_mean q_max			queue size over the operations
+ */
+void
+SchedBench::run(Scheduler* s)
+{
+	Event* pool = new Event[ninserts_ > 0 ? ninserts_ : 1];
+	Event** live = new Event*[ninserts_ > 0 ? ninserts_ : 1];
+	Event* freelist = 0;
+	int nused = 0;
+	double clock = 0;
+	int inserts = 0, cancels = 0, deques = 0;
+	int qsize = 0, qmax = 0;
+	double qsum = 0;
+	int i;
+
+	memset(live, 0, sizeof(Event*) * (ninserts_ > 0 ? ninserts_ : 1));
+	int perf = -1;
+#ifdef __linux__
+	perf = perfOpen();
+	if (perf >= 0) {
+		ioctl(perf, PERF_EVENT_IOC_RESET, 0);
+		ioctl(perf, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+	timeval start, end;
+	gettimeofday(&start, 0);
+
+	for (i = 0; i < nops_; i++) {
+		Op& op = ops_[i];
+		Event* e;
+		switch (op.type_) {
+		case 'i':
+			if (freelist) {
+				e = freelist;
+				freelist = e->next_;
+			} else
+				e = &pool[nused++];
+			e->time_ = clock + op.delay_;
+			e->uid_ = op.index_ + 1;
+			live[op.index_] = e;
+			s->insert(e);
+			inserts++;
+			qsize++;
+			break;
+		case 'c':
+			// may be gone already if s breaks time ties otherwise
+			e = live[op.index_];
+			if (e == 0)
+				break;
+			s->cancel(e);
+			live[op.index_] = 0;
+			e->next_ = freelist;
+			freelist = e;
+			cancels++;
+			qsize--;
+			break;
+		case 'd':
+			e = s->deque();
+			if (e == 0)
+				break;
+			clock = e->time_;
+			live[e->uid_ - 1] = 0;
+			e->next_ = freelist;
+			freelist = e;
+			deques++;
+			qsize--;
+			break;
+		}
+		qsum += qsize;
+		if (qsize > qmax)
+			qmax = qsize;
+	}
+
+	gettimeofday(&end, 0);
+	double misses = -1;
+#ifdef __linux__
+	if (perf >= 0) {
+		long long count;
+		ioctl(perf, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(perf, &count, sizeof(count)) == sizeof(count) &&
+		    nops_ > 0)
+			misses = (double)count / nops_;
+		close(perf);
+	}
+#endif
+	// leave s empty for the caller to delete
+	while (s->deque())
+		;
+	delete [] live;
+	delete [] pool;
+
+	double ns = (end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_usec - start.tv_usec) * 1e3;
+	Tcl::instance().resultf("ops %d inserts %d cancels %d deques %d "
+				"ns_per_op %.1f cache_misses %.3f "
+				"q_mean %.1f q_max %d",
+				nops_, inserts, cancels, deques,
+				nops_ > 0 ? ns / nops_ : 0.0, misses,
+				nops_ > 0 ? qsum / nops_ : 0.0, qmax);
+}
+
+/*
+ * $bench load <file>
+ *	read a stream written by Scheduler/Record, returns its length
+ * $bench run <scheduler>
+ *	replay it against a fresh scheduler, see SchedBench::run
+ */
+int
+SchedBench::command(int argc, const char*const* argv)
+{
+	Tcl& tcl = Tcl::instance();
+	if (argc == 3) {
+		if (strcmp(argv[1], "load") == 0) {
+			int n = load(argv[2]);
+			if (n < 0) {
+				tcl.resultf("cannot open %s", argv[2]);
+				return (TCL_ERROR);
+			}
+			tcl.resultf("%d", n);
+			return (TCL_OK);
+		}
+		if (strcmp(argv[1], "run") == 0) {
+			Scheduler* s = (Scheduler*)TclObject::lookup(argv[2]);
+			if (s == 0) {
+				tcl.resultf("no scheduler %s", argv[2]);
+				return (TCL_ERROR);
+			}
+			if (s == &Scheduler::instance() || s->head() != 0) {
+				tcl.resultf("%s is in use", argv[2]);
+				return (TCL_ERROR);
+			}
+			run(s);
+			return (TCL_OK);
+		}
+	}
+	return (TclObject::command(argc, argv));
+}
@@ -0,0 +1,267 @@
+/* -*-	Mode:C++; c-basic-offset:8; tab-width:8; indent-tabs-mode:t -*- */
+
+/*
+ * scheduler-profile.cc
+ *
+ * See scheduler-profile.h.  A handler is mapped to its Site once, the
+ * dynamic type and for TclObjects the name are checked again on every
+ * event as handlers are freed and their memory reused, so the cost per
+ * event is a hash lookup, a typeid and two clock reads, plus a
+ * dynamic_cast and a strcmp for TclObjects.  Nothing of it runs with profiling off.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+#include "scheduler.h"
+#include "scheduler-profile.h"
+
+#define PROFILE_REPORT_OBJECTS	20	/* objects in report() */
+
+static double
+profileClock()
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + 1e-9 * ts.tv_nsec);
+#else
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return (tv.tv_sec + 1e-6 * tv.tv_usec);
+#endif
+}
+
+SchedProfile::SchedProfile() : tstats_(0), ostats_(0), scheduled_(0),
+	events_(0), time_(0), dispatching_(0), pending_reset_(0)
+{
+	Tcl_InitHashTable(&types_, TCL_ONE_WORD_KEYS);
+	Tcl_InitHashTable(&sites_, TCL_ONE_WORD_KEYS);
+}
+
+SchedProfile::~SchedProfile()
+{
+	clear();
+	Tcl_DeleteHashTable(&types_);
+	Tcl_DeleteHashTable(&sites_);
+}
+
+/*
+ * A reset from within handle(), e.g. by "$ns at 100 {$ns profile reset}"
+ * to skip the warm-up, must not free the Site dispatch() still counts
+ * the event for, it is done once the event is counted.
+ */
+void
+SchedProfile::reset()
+{
+	if (dispatching_ > 0)
+		pending_reset_ = 1;
+	else
+		clear();
+}
+
+void
+SchedProfile::clear()
+{
+	Tcl_HashSearch hs;
+	for (Tcl_HashEntry* he = Tcl_FirstHashEntry(&sites_, &hs); he;
+	     he = Tcl_NextHashEntry(&hs))
+		delete (Site*)Tcl_GetHashValue(he);
+	Tcl_DeleteHashTable(&sites_);
+	Tcl_DeleteHashTable(&types_);
+	Tcl_InitHashTable(&types_, TCL_ONE_WORD_KEYS);
+	Tcl_InitHashTable(&sites_, TCL_ONE_WORD_KEYS);
+	freeStats(tstats_);
+	freeStats(ostats_);
+	tstats_ = ostats_ = 0;
+	events_ = 0;
+	time_ = 0;
+}
+
+SchedProfile::Stat*
+SchedProfile::newStat(const char* name, const char* type, Stat** list)
+{
+	Stat* s = new Stat;
+	s->name_ = new char[strlen(name) + 1];
+	strcpy(s->name_, name);
+	s->type_ = new char[strlen(type) + 1];
+	strcpy(s->type_, type);
+	s->events_ = 0;
+	s->time_ = 0;
+	s->scheduled_ = 0;
+	s->next_ = *list;
+	*list = s;
+	return (s);
+}
+
+void
+SchedProfile::freeStats(Stat* list)
+{
+	while (list) {
+		Stat* s = list;
+		list = s->next_;
+		delete [] s->name_;
+		delete [] s->type_;
+		delete s;
+	}
+}
+
+/* the Stat of type ti, created on first use */
+SchedProfile::Stat*
+SchedProfile::typeStat(const std::type_info* ti)
+{
+	int isnew;
+	Tcl_HashEntry* he = Tcl_CreateHashEntry(&types_, (char*)ti, &isnew);
+	if (isnew) {
+		const char* name = ti->name();
+		char* dm = 0;
+#ifdef __GNUC__
+		int status;
+		dm = abi::__cxa_demangle(name, 0, 0, &status);
+		if (dm)
+			name = dm;
+#endif
+		Tcl_SetHashValue(he, (ClientData)newStat(name, name, &tstats_));
+		free(dm);
+	}
+	return ((Stat*)Tcl_GetHashValue(he));
+}
+
+/* a new object Stat for o, named by its type if o has no name */
+void
+SchedProfile::objStat(Site* s, TclObject* o)
+{
+	const char* name = o->name();
+	s->oname_ = name;
+	s->obj_ = newStat(name ? name : s->type_->name_, s->type_->name_,
+			  &ostats_);
+}
+
+SchedProfile::Site*
+SchedProfile::site(Handler* h)
+{
+	const std::type_info* ti = &typeid(*h);
+	int isnew;
+	Tcl_HashEntry* he = Tcl_CreateHashEntry(&sites_, (char*)h, &isnew);
+	Site* s;
+	if (!isnew) {
+		s = (Site*)Tcl_GetHashValue(he);
+		if (s->ti_ == ti) {
+			if (s->obj_ == 0)
+				return (s);
+			// the same type, but maybe another object at h
+			TclObject* o = dynamic_cast<TclObject*>(h);
+			const char* name = o->name();
+			if (name != s->oname_ ||
+			    (name != 0 && strcmp(name, s->obj_->name_) != 0))
+				objStat(s, o);
+			return (s);
+		}
+	} else {
+		s = new Site;
+		Tcl_SetHashValue(he, (ClientData)s);
+	}
+	s->ti_ = ti;
+	s->type_ = typeStat(ti);
+	s->obj_ = 0;
+	s->oname_ = 0;
+	TclObject* o = dynamic_cast<TclObject*>(h);
+	if (o)
+		objStat(s, o);
+	return (s);
+}
+
+void
+SchedProfile::dispatch(Event* p)
+{
+	Handler* h = p->handler_;
+	Site* s = site(h);
+	long sched = scheduled_;
+	double start = profileClock();
+
+	dispatching_++;
+	h->handle(p);	// h and p may be gone after this
+	dispatching_--;
+
+	double t = profileClock() - start;
+	sched = scheduled_ - sched;
+	s->type_->events_++;
+	s->type_->time_ += t;
+	s->type_->scheduled_ += sched;
+	if (s->obj_) {
+		s->obj_->events_++;
+		s->obj_->time_ += t;
+		s->obj_->scheduled_ += sched;
+	}
+	events_++;
+	time_ += t;
+	if (pending_reset_ && dispatching_ == 0) {
+		pending_reset_ = 0;
+		clear();
+	}
+}
+
+/* insertion sort by time spent, the lists are short */
+void
+SchedProfile::sort(Stat** list)
+{
+	Stat* sorted = 0;
+	while (*list) {
+		Stat* s = *list;
+		*list = s->next_;
+		Stat** p = &sorted;
+		while (*p && (*p)->time_ >= s->time_)
+			p = &(*p)->next_;
+		s->next_ = *p;
+		*p = s;
+	}
+	*list = sorted;
+}
+
+void
+SchedProfile::reportList(FILE* fp, const char* title, Stat* list, int max)
+{
+	fprintf(fp, "%-40s %10s %10s %8s %7s %6s\n", title,
+		"events", "time_s", "us/ev", "fanout", "time%");
+	for (Stat* s = list; s && max != 0; s = s->next_, max--) {
+		if (s->events_ == 0)
+			continue;
+		fprintf(fp, "%-40s %10ld %10.3f %8.2f %7.2f %6.1f\n", s->name_,
+			s->events_, s->time_, 1e6 * s->time_ / s->events_,
+			(double)s->scheduled_ / s->events_,
+			time_ > 0 ? 100.0 * s->time_ / time_ : 0.0);
+	}
+}
+
+void
+SchedProfile::report(FILE* fp)
+{
+	sort(&tstats_);
+	sort(&ostats_);
+	fprintf(fp, "profile: %ld events, %.3f s in handle()\n",
+		events_, time_);
+	reportList(fp, "handler type", tstats_, -1);
+	fprintf(fp, "\n");
+	reportList(fp, "object", ostats_, PROFILE_REPORT_OBJECTS);
+}
+
+void
+SchedProfile::dump(FILE* fp)
+{
+	Stat* s;
+
+	sort(&tstats_);
+	sort(&ostats_);
+	fprintf(fp, "kind,name,type,events,time_s,scheduled\n");
+	for (s = tstats_; s; s = s->next_)
+		fprintf(fp, "type,\"%s\",\"%s\",%ld,%.9f,%ld\n", s->name_,
+			s->type_, s->events_, s->time_, s->scheduled_);
+	for (s = ostats_; s; s = s->next_)
+		fprintf(fp, "object,\"%s\",\"%s\",%ld,%.9f,%ld\n", s->name_,
+			s->type_, s->events_, s->time_, s->scheduled_);
+}
@@ -0,0 +1,70 @@
+/* -*-	Mode:C++; c-basic-offset:8; tab-width:8; indent-tabs-mode:t -*- */
+
+/*
+ * scheduler-profile.h
+ *
+ * Per handler profile of the events a Scheduler dispatches, kept while
+ * "$ns profile on".  Events are counted by the dynamic type of their
+ * handler and, for handlers which are TclObjects, by object:
+ *	events		events dispatched to it
+ *	time		wall clock seconds spent in handle()
+ *	scheduled	events scheduled from within handle(), divided
+ *			by events this is the fan-out
+ */
+
+#ifndef ns_scheduler_profile_h
+#define ns_scheduler_profile_h
+
+#include <stdio.h>
+#include <typeinfo>
+#include <tcl.h>
+
+class Event;
+class Handler;
+class TclObject;
+
+class SchedProfile {
+public:
+	SchedProfile();
+	~SchedProfile();
+	void dispatch(Event* p);	// time p->handler_->handle(p)
+	void scheduled() { scheduled_++; }
+	void report(FILE* fp);		// tables for reading
+	void dump(FILE* fp);		// one CSV line per type and object
+	void reset();			// deferred while in handle()
+protected:
+	struct Stat {
+		char* name_;		// type or object name
+		char* type_;		// type name
+		long events_;
+		double time_;
+		long scheduled_;
+		Stat* next_;
+	};
+	struct Site {			// what a handler is counted for
+		const std::type_info* ti_;
+		Stat* type_;
+		Stat* obj_;		// 0 if not a TclObject
+		const char* oname_;	// name of the object obj_ is for
+	};
+	Site* site(Handler* h);
+	Stat* typeStat(const std::type_info* ti);
+	void objStat(Site* s, TclObject* o);
+	Stat* newStat(const char* name, const char* type, Stat** list);
+	void freeStats(Stat* list);
+	void clear();
+	void sort(Stat** list);
+	void reportList(FILE* fp, const char* title, Stat* list, int max);
+
+	Tcl_HashTable types_;		// type_info* to Stat
+	Tcl_HashTable sites_;		// Handler* to Site
+	Stat* tstats_;
+	Stat* ostats_;
+	long scheduled_;		// events scheduled so far
+	long events_;
+	double time_;
+	int dispatching_;		// depth of handle() calls
+	int pending_reset_;		// reset() called from handle()
+};
+
+#endif
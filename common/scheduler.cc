@@ -45,6 +45,7 @@ static const char rcsid[] =
 
 #include "config.h"
 #include "scheduler.h"
+#include "scheduler-profile.h"
 #include "packet.h"
 
 
@@ -60,11 +61,14 @@ scheduler_uid_t Scheduler::uid_ = 1;
 // 	char* proc_;
 // };
 
-Scheduler::Scheduler() : clock_(SCHED_START), halted_(0)
+Scheduler::Scheduler() : clock_(SCHED_START), start_clock_(SCHED_START),
+	halted_(0), dispatched_(0), uids_(0), prof_(0), profiling_(0)
 {
 }
 
 Scheduler::~Scheduler(){
+	delete uids_;
+	delete prof_;
 	instance_ = NULL ;
 }
 
@@ -110,6 +114,8 @@ Scheduler::schedule(Handler* h, Event* e, double delay)
 	e->uid_ = uid_++;
 	e->handler_ = h;
 	double t = clock_ + delay;
+	if (profiling_)
+		prof_->scheduled();
 
 	e->time_ = t;
 	insert(e);
@@ -146,7 +152,12 @@ Scheduler::dispatch(Event* p, double t)
 	}
 
 	clock_ = t;
+	dispatched_++;
 	p->uid_ = -p->uid_;	// being dispatched
+	if (profiling_) {
+		prof_->dispatch(p);
+		return;
+	}
 	p->handler_->handle(p);	// dispatch
 }
 
@@ -182,7 +193,7 @@ AtHandler::handle(Event* e)
 void
 Scheduler::reset()
 {
-	clock_ = SCHED_START;
+	clock_ = start_clock_;
 }
 
 int 
@@ -216,9 +227,17 @@ Scheduler::command(int argc, const char*const* argv)
 				globalMemTrace->diff("Sim.");
 #endif
 			return (TCL_OK);
+		} else if (strcmp(argv[1], "dispatched") == 0) {
+			sprintf(tcl.buffer(), "%.0f", (double) dispatched_);
+			tcl.result(tcl.buffer());
+			return (TCL_OK);
 		} else if (strcmp(argv[1], "is-running") == 0) {
 			sprintf(tcl.buffer(), "%d", !halted_);
 			return (TCL_OK);
+		} else if (strcmp(argv[1], "profile-report") == 0) {
+			if (prof_)
+				prof_->report(stdout);
+			return (TCL_OK);
 		} else if (strcmp(argv[1], "dumpq") == 0) {
 			if (!halted_) {
 				fprintf(stderr, "Scheduler: dumpq only allowed while halted\n");
@@ -229,6 +248,58 @@ Scheduler::command(int argc, const char*const* argv)
 			return (TCL_OK);
 		}
 	} else if (argc == 3) {
+		/*
+		 * $sched profile on|off|reset
+		 *	count the dispatched events by handler, see
+		 *	scheduler-profile.h
+		 * $sched profile-dump <file>
+		 *	the counts as CSV, "-" for stdout
+		 */
+		if (strcmp(argv[1], "profile") == 0) {
+			if (strcmp(argv[2], "on") == 0) {
+				if (prof_ == 0)
+					prof_ = new SchedProfile;
+				profiling_ = 1;
+			} else if (strcmp(argv[2], "off") == 0) {
+				profiling_ = 0;
+			} else if (strcmp(argv[2], "reset") == 0) {
+				if (prof_)
+					prof_->reset();
+			} else {
+				tcl.resultf("profile %s: on, off or reset",
+					    argv[2]);
+				return (TCL_ERROR);
+			}
+			return (TCL_OK);
+		}
+		/*
+		 * $sched clock-set <time>
+		 *	start the run at time instead of 0, e.g. to continue
+		 *	from a checkpoint.  Only before anything is scheduled.
+		 */
+		if (strcmp(argv[1], "clock-set") == 0) {
+			if (head() != 0) {
+				tcl.result("clock-set: events already scheduled");
+				return (TCL_ERROR);
+			}
+			start_clock_ = clock_ = atof(argv[2]);
+			return (TCL_OK);
+		}
+		if (strcmp(argv[1], "profile-dump") == 0) {
+			FILE* fp = stdout;
+			if (strcmp(argv[2], "-") != 0 &&
+			    (fp = fopen(argv[2], "w")) == 0) {
+				tcl.resultf("cannot open %s", argv[2]);
+				return (TCL_ERROR);
+			}
+			if (prof_)
+				prof_->dump(fp);
+			if (fp != stdout)
+				fclose(fp);
+			else
+				fflush(fp);
+			return (TCL_OK);
+		}
 		if (strcmp(argv[1], "at") == 0 ||
 		    strcmp(argv[1], "cancel") == 0) {
 			Event* p = lookup(STRTOUID(argv[2]));
@@ -290,6 +361,67 @@ Scheduler::dumpq()
 	}
 }
 
+void
+EventIndex::resize(unsigned int size)
+{
+	Event** old = slot_;
+	unsigned int osize = old ? mask_ + 1 : 0;
+
+	slot_ = new Event*[size];
+	memset(slot_, 0, size * sizeof(Event*));
+	mask_ = size - 1;
+	n_ = 0;
+	for (unsigned int i = 0; i < osize; i++)
+		if (old[i])
+			insert(old[i]);
+	delete [] old;
+}
+
+void
+EventIndex::insert(Event* e)
+{
+	if (2 * (n_ + 1) > mask_ + 1)	// at most half full
+		resize(2 * (mask_ + 1));
+	unsigned int i = hash(e->uid_);
+	while (slot_[i])
+		i = (i + 1) & mask_;
+	slot_[i] = e;
+	n_++;
+}
+
+Event*
+EventIndex::find(scheduler_uid_t uid)
+{
+	for (unsigned int i = hash(uid); slot_[i]; i = (i + 1) & mask_)
+		if (slot_[i]->uid_ == uid)
+			return slot_[i];
+	return 0;
+}
+
+/*
+ * Remove e and shift the entries after it back, so that no entry is
+ * separated from its hash slot by an empty one.
+ */
+void
+EventIndex::remove(Event* e)
+{
+	unsigned int i, j, k;
+
+	for (i = hash(e->uid_); slot_[i] != e; i = (i + 1) & mask_)
+		if (slot_[i] == 0)
+			return;
+	for (j = (i + 1) & mask_; slot_[j]; j = (j + 1) & mask_) {
+		k = hash(slot_[j]->uid_);
+		// entry j may move to i unless its slot k is in (i, j]
+		if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+			slot_[i] = slot_[j];
+			i = j;
+		}
+	}
+	slot_[i] = 0;
+	n_--;
+}
+
 static class ListSchedulerClass : public TclClass {
 public:
 	ListSchedulerClass() : TclClass("Scheduler/List") {}
@@ -414,7 +546,15 @@ Heap::heap_delete(void* elem)
 	int	i;
 	if ((i = heap_member(elem)) == 0)
 		return 0;
-	for (--i; i; i = parent(i)) {
+	return heap_delete_at(i - 1);
+}
+
+int
+Heap::heap_delete_at(unsigned int i)
+{
+	if (i >= h_size)
+		return 0;
+	for (; i; i = parent(i)) {
 		swap(i, parent(i));
 	}
 	(void) heap_extract_min();
@@ -435,7 +575,7 @@ Heap::heap_delete(void* elem)
  *	h[i] := key
  */
 void
-Heap::heap_insert(heap_key_t key, void* elem) 
+Heap::heap_insert(heap_key_t key, void* elem, int* pos) 
 {
 	unsigned int	i, par;
 	if (h_maxsize == h_size) {	/* Adjust heap_size */
@@ -452,13 +592,16 @@ Heap::heap_insert(heap_key_t key, void* elem)
 	while ((i > 0) && 
 	       (KEY_LESS_THAN(key, h_s_key,
 			      h_elems[par].he_key, h_elems[par].he_s_key))) {
-		h_elems[i] = h_elems[par];
+		place(i, h_elems[par]);
 		i = par;
 		par = parent(i);
 	}
 	h_elems[i].he_key  = key;
 	h_elems[i].he_s_key= h_s_key++;
 	h_elems[i].he_elem = elem;
+	h_elems[i].he_pos  = pos;
+	if (pos)
+		*pos = i;
 	return;
 }
 		
@@ -504,7 +647,7 @@ Heap::heap_extract_min()
 	if (h_size == 0)
 		return 0;
 	min = h_elems[0].he_elem;
-	h_elems[0] = h_elems[--h_size];
+	place(0, h_elems[--h_size]);
 // Heapify:
 	i = 0;
 	while (i < h_size) {
@@ -544,17 +687,22 @@ HeapScheduler::lookup(scheduler_uid_t uid)
 {
 	Event* e;
 	
-	for (e = (Event*) hp_->heap_iter_init(); e;
-	     e = (Event*) hp_->heap_iter())
-		if (e->uid_ == uid)
-			break;
-	return e;
+	if (uids_ == 0) {
+		uids_ = new EventIndex;
+		for (e = (Event*) hp_->heap_iter_init(); e;
+		     e = (Event*) hp_->heap_iter())
+			uids_->insert(e);
+	}
+	return uids_->find(uid);
 }
 
 Event*
 HeapScheduler::deque()
 {
-	return ((Event*) hp_->heap_extract_min());
+	Event* e = (Event*) hp_->heap_extract_min();
+	if (e && uids_)
+		uids_->remove(e);
+	return e;
 }
 
 /*
@@ -651,6 +799,8 @@ CalendarScheduler::insert(Event* e)
 	++qsize_;
 	//assert(e == buckets_[i].list_ ||  e->prev_->time_ <= e->time_);
 	//assert(e == buckets_[i].list_->prev_ || e->next_->time_ >= e->time_);
+	if (uids_)
+		uids_->insert(e);
 
   	if (stat_qsize_ > top_threshold_) {
   		resize(nbuckets_ << 1, cal_clock_);
@@ -829,6 +979,8 @@ CalendarScheduler::deque()
 	}
 
 	e->next_ = e->prev_ = NULL;
+	if (uids_)
+		uids_->remove(e);
 
 
 	//if (buckets_[l].count_ == 0)
@@ -991,6 +1143,8 @@ CalendarScheduler::cancel(Event* e)
 	if (buckets_[i].count_ == 0)
 		assert(buckets_[i].list_ == 0);
 
+	if (uids_)
+		uids_->remove(e);
 	e->uid_ = -e->uid_;
 	e->next_ = e->prev_ = NULL;
 
@@ -1002,18 +1156,20 @@ CalendarScheduler::cancel(Event* e)
 Event * 
 CalendarScheduler::lookup(scheduler_uid_t uid)
 {
-	for (int i = 0; i < nbuckets_; i++) {
-		Event* head =  buckets_[i].list_;
-		Event* p = head;
-		if (p) {
-			do {
-				if (p->uid_== uid) 
-					return p;
-				p = p->next_;
-			} while (p != head);
+	if (uids_ == 0) {
+		uids_ = new EventIndex;
+		for (int i = 0; i < nbuckets_; i++) {
+			Event* head =  buckets_[i].list_;
+			Event* p = head;
+			if (p) {
+				do {
+					uids_->insert(p);
+					p = p->next_;
+				} while (p != head);
+			}
 		}
 	}
-	return NULL;
+	return uids_->find(uid);
 }
 
 #ifndef WIN32
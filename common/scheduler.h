@@ -52,6 +52,7 @@ typedef int scheduler_uid_t;
 
 
 class Handler;
+class SchedProfile;
 
 class Event {
 public:
@@ -60,7 +61,35 @@ public:
 	Handler* handler_;	/* handler to call when event ready */
 	double time_;		/* time at which event is ready */
 	scheduler_uid_t uid_;	/* unique ID */
-	Event() : time_(0), uid_(0) {}
+	int pos_;		/* index in the queue (HeapScheduler),
+				   > 0 if in bottom (LadderScheduler) */
+	Event() : time_(0), uid_(0), pos_(-1) {}
+};
+
+/*
+ * Index from uid to the events in a scheduler queue, for lookup().
+ * Open addressing with linear probing over the events themselves,
+ * which are found by their uid_, so an entry is a single pointer.
+ * A scheduler builds it on the first lookup() and from then on adds
+ * every event it inserts and removes every event before it negates
+ * the uid_ of a cancelled or dequeued event.
+ */
+class EventIndex {
+public:
+	EventIndex() : slot_(0), mask_(0), n_(0) { resize(64); }
+	~EventIndex() { delete [] slot_; }
+	void insert(Event*);
+	void remove(Event*);
+	Event* find(scheduler_uid_t uid);
+protected:
+	unsigned int hash(scheduler_uid_t uid) const {
+		// uids are consecutive, the low bits alone spread them
+		return ((unsigned int)uid * 2654435761U) & mask_;
+	}
+	void resize(unsigned int size);
+	Event** slot_;
+	unsigned int mask_;
+	unsigned int n_;
 };
 
 /*
@@ -93,7 +122,7 @@ public:
 	}
 	virtual void sync() {};
 	virtual double start() {		// start time
-		return SCHED_START;
+		return start_clock_;
 	}
 	virtual void reset();
 protected:
@@ -104,7 +133,12 @@ protected:
 	virtual ~Scheduler();
 	int command(int argc, const char*const* argv);
 	double clock_;
+	double start_clock_;		// clock at "run", see "clock-set"
 	int halted_;
+	scheduler_uid_t dispatched_;	// events dispatched so far
+	EventIndex* uids_;		// uid index, once lookup() is used
+	SchedProfile* prof_;		// handler profile, once profiling
+	int profiling_;			// "profile on"
 	static Scheduler* instance_;
 	static scheduler_uid_t uid_;
 };
@@ -130,11 +164,15 @@ public:
 	void cancel(Event* e) {
 		if (e->uid_ <= 0)
 			return;
+		if (uids_)
+			uids_->remove(e);
 		e->uid_ = - e->uid_;
-		hp_->heap_delete((void*) e);
+		hp_->heap_delete_at(e->pos_);
 	}
 	void insert(Event* e) {
-		hp_->heap_insert(e->time_, (void*) e);
+		hp_->heap_insert(e->time_, (void*) e, &e->pos_);
+		if (uids_)
+			uids_->insert(e);
 	}
 	Event* lookup(scheduler_uid_t uid);
 	Event* deque();
@@ -190,6 +228,54 @@ private:
 
 };
 
+/*
+ * Ladder queue, see ladder-scheduler.cc.  Events are kept in the
+ * unsorted top list, in the buckets of up to LADDER_MAX_RUNGS rungs and
+ * in the sorted bottom list, all of them circular lists headed by a
+ * sentinel Event so that cancel() can unlink an event in O(1).
+ */
+#define LADDER_MAX_RUNGS	8
+#define LADDER_MAX_BUCKETS	65536
+
+class LadderScheduler : public Scheduler {
+public:
+	LadderScheduler();
+	~LadderScheduler();
+	void cancel(Event*);
+	void insert(Event*);
+	Event* lookup(scheduler_uid_t uid);
+	Event* deque();
+	const Event* head();
+
+protected:
+	struct Rung {
+		Event* bucket_;		// bucket sentinels
+		int size_;		// buckets allocated
+		int nbuckets_;		// buckets in use
+		int cur_;		// first bucket not yet dequeued
+		double start_;		// time of bucket 0
+		double width_;
+	};
+
+	int threshold_;			// largest bucket sorted into bottom
+
+	Event top_;
+	double top_start_;		// events from here on go to top
+	Rung rungs_[LADDER_MAX_RUNGS];
+	int nrungs_;
+	Event bottom_;
+	int nbottom_;			// bottom size
+	int bottom_limit_;		// bottom size which spawns a rung
+	int qsize_;
+
+private:
+	Event* route(double t);
+	void insertBottom(Event*);
+	bool spawn(Event* list, int n, double min, double max);
+	void toBottom(Event* list, int n, bool sorted);
+	bool refill();
+};
+
 class SplayScheduler : public Scheduler 
 {
 public:
@@ -44,6 +44,11 @@
  *
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
 #include "simulator.h"
 #include "node.h"
 #include "address.h"
@@ -65,6 +70,38 @@ int Simulator::command(int argc, const char*const* argv) {
 	Tcl& tcl = Tcl::instance();
 	if ((instance_ == 0) || (instance_ != this))
 		instance_ = this;
+	if (argc == 2) {
+		// for "$ns sweep": the pid of the child, 0 in the child
+		if (strcmp(argv[1], "fork") == 0) {
+			fflush(0);
+			pid_t pid = fork();
+			if (pid < 0) {
+				tcl.resultf("fork: %s", strerror(errno));
+				return TCL_ERROR;
+			}
+			tcl.resultf("%d", (int)pid);
+			return TCL_OK;
+		}
+		// wait for a child, "pid exit-code" or "" without children
+		if (strcmp(argv[1], "wait") == 0) {
+			int status;
+			pid_t pid;
+			while ((pid = waitpid(-1, &status, 0)) < 0 && errno == EINTR)
+				;
+			if (pid < 0) {
+				tcl.result("");
+				return TCL_OK;
+			}
+			tcl.resultf("%d %d", (int)pid, WIFEXITED(status) ?
+				    WEXITSTATUS(status) : 128 + WTERMSIG(status));
+			return TCL_OK;
+		}
+		if (strcmp(argv[1], "ncpus") == 0) {
+			long n = sysconf(_SC_NPROCESSORS_ONLN);
+			tcl.resultf("%ld", n > 0 ? n : 1);
+			return TCL_OK;
+		}
+	}
 	if (argc == 3) {
 		if (strcmp(argv[1], "populate-flat-classifiers") == 0) {
 			nn_ = atoi(argv[2]);
@@ -94,6 +131,32 @@ int Simulator::command(int argc, const char*const* argv) {
 		}
 	}
 	if (argc == 4) {
+		/*
+		 * redirect <channel> <file>: from now on what is written to
+		 * channel, by Tcl or by the C++ objects holding it, goes to
+		 * file.  For the traces a "$ns sweep" child inherits.
+		 */
+		if (strcmp(argv[1], "redirect") == 0) {
+			int mode;
+			ClientData h;
+			Tcl_Channel ch = Tcl_GetChannel(tcl.interp(),
+						(char*)argv[2], &mode);
+			if (ch == 0 || !(mode & TCL_WRITABLE) ||
+			    Tcl_GetChannelHandle(ch, TCL_WRITABLE, &h) != TCL_OK) {
+				tcl.resultf("%s is no writable file channel", argv[2]);
+				return TCL_ERROR;
+			}
+			Tcl_Flush(ch);
+			fflush(0);
+			int fd = open(argv[3], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0) {
+				tcl.resultf("cannot open %s", argv[3]);
+				return TCL_ERROR;
+			}
+			dup2(fd, (int)(long)h);
+			close(fd);
+			return TCL_OK;
+		}
 		if (strcmp(argv[1], "add-node") == 0) {
 			Node *node = (Node *)(TclObject::lookup(argv[2]));
 			if (node == NULL) {
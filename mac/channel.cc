@@ -58,6 +58,7 @@ static const char rcsid[] =
 #include "lib/bsd-list.h"
 #include "phy.h"
 #include "wireless-phy.h"
+#include "topography.h"
 #include "mobilenode.h"
 #include "ip.h"
 #include "dsr/hdr_sr.h"
@@ -288,7 +289,17 @@ double WirelessChannel::highestAntennaZ_ = -1; // i.e., uninitialized
 double WirelessChannel::distCST_ = -1;
 
 WirelessChannel::WirelessChannel(void) : Channel(), numNodes_(0), 
-					 xListHead_(NULL), sorted_(0) {}
+					 xListHead_(NULL), sorted_(0),
+					 freq_lambda_(NULL), freq_count_(NULL),
+					 num_freqs_(0), num_nonselective_(0),
+					 grid_(NULL), grid_nx_(0), grid_ny_(0),
+					 cell_size_(0), max_speed_(0), sweep_time_(0),
+					 affected_(NULL), affected_size_(0)
+{
+	bind("freq_partition_", &freq_partition_);
+	bind("shared_rx_", &shared_rx_);
+	bind("grid_index_", &grid_index_);
+}
 
 int WirelessChannel::command(int argc, const char*const* argv)
 {
@@ -304,6 +315,14 @@ int WirelessChannel::command(int argc, const char*const* argv)
 			addNodeToList((MobileNode*) obj);
 			return TCL_OK;
 		}
+		else if (strcmp(argv[1], "addif") == 0) {
+			// index the interface, Channel attaches it
+			WirelessPhy *wifp = dynamic_cast<WirelessPhy*>(obj);
+			if (wifp && wifp->freqSelective())
+				addToFreqIndex(wifp->getLambda(), 1);
+			else
+				num_nonselective_++;
+		}
 		else if (strcmp(argv[1], "remove-node") == 0) {
 			removeNodeFromList((MobileNode*) obj);
 			return TCL_OK;
@@ -323,6 +342,18 @@ WirelessChannel::sendUp(Packet* p, Phy *tifp)
 	Packet *newp;
 	double propdelay = 0.0;
 	struct hdr_cmn *hdr = HDR_CMN(p);
+	double lambda = p->txinfo_.getLambda();
+	int filter = 0;
+
+	if (freq_partition_) {
+		int f = freqIndex(lambda);
+		// nobody else is tuned to the transmit frequency
+		if (f >= 0 && freq_count_[f] < 2 && num_nonselective_ == 0) {
+			Packet::free(p);
+			return;
+		}
+		filter = (num_freqs_ > 1);
+	}
 
          /* list-based improvement */
          if(highestAntennaZ_ == -1) {
@@ -345,11 +376,17 @@ WirelessChannel::sendUp(Packet* p, Phy *tifp)
 						         outlist);
 	    for (i=0; i < out_index; i ++) {
 		
-		  newp = p->copy();
 		  rnode = outlist[i];
+		  rifp = (rnode->ifhead()).lh_first; 
+		  if (filter) {
+			  for(; rifp && rifp->channel() != this; rifp = rifp->nextnode());
+			  if (rifp == 0 || !receives(rifp, lambda))
+				  continue;
+		  }
+
+		  newp = shared_rx_ ? p->sharedcopy() : p->copy();
 		  propdelay = get_pdelay(tnode, rnode);
 
-		  rifp = (rnode->ifhead()).lh_first; 
 		  for(; rifp; rifp = rifp->nextnode()){
 			  if (rifp->channel() == this){
 				 s.schedule(rifp, newp, propdelay); 
@@ -365,7 +402,7 @@ WirelessChannel::sendUp(Packet* p, Phy *tifp)
 		 MobileNode **affectedNodes;// **aN;
 		 int numAffectedNodes = -1, i;
 		 
-		 if(!sorted_){
+		 if(!sorted_ && !grid_index_){
 			 sortLists();
 		 }
 		 
@@ -376,21 +413,85 @@ WirelessChannel::sendUp(Packet* p, Phy *tifp)
 			 if(rnode == tnode)
 				 continue;
 			 
-			 newp = p->copy();
+			 rifp = (rnode->ifhead()).lh_first;
+			 if (filter) {
+				 // skip nodes with no interface on the frequency
+				 for(; rifp && !receives(rifp, lambda); rifp = rifp->nextnode());
+				 if (rifp == 0)
+					 continue;
+			 }
+
+			 newp = shared_rx_ ? p->sharedcopy() : p->copy();
 			 
 			 propdelay = get_pdelay(tnode, rnode);
 			 
-			 rifp = (rnode->ifhead()).lh_first;
 			 for(; rifp; rifp = rifp->nextnode()){
-				 s.schedule(rifp, newp, propdelay);
+				 if (!filter || receives(rifp, lambda))
+					 s.schedule(rifp, newp, propdelay);
 			 }
 		 }
-		 delete [] affectedNodes;
 	 }
 	 Packet::free(p);
 }
 
 
+inline int
+WirelessChannel::receives(Phy *rifp, double lambda)
+{
+	WirelessPhy *wifp = dynamic_cast<WirelessPhy*>(rifp);
+	return (wifp == NULL || !wifp->freqSelective() ||
+		wifp->getLambda() == lambda);
+}
+
+int
+WirelessChannel::freqIndex(double lambda)
+{
+	for (int f = 0; f < num_freqs_; f++)
+		if (freq_lambda_[f] == lambda)
+			return f;
+	return -1;
+}
+
+void
+WirelessChannel::addToFreqIndex(double lambda, int n)
+{
+	int f = freqIndex(lambda);
+
+	if (f < 0) {
+		if (n <= 0)
+			return;
+		// one entry per frequency in use, there are only a few
+		double *l = new double[num_freqs_ + 1];
+		int *c = new int[num_freqs_ + 1];
+		for (f = 0; f < num_freqs_; f++) {
+			l[f] = freq_lambda_[f];
+			c[f] = freq_count_[f];
+		}
+		l[f] = lambda;
+		c[f] = 0;
+		delete [] freq_lambda_;
+		delete [] freq_count_;
+		freq_lambda_ = l;
+		freq_count_ = c;
+		num_freqs_++;
+	}
+	freq_count_[f] += n;
+	if (freq_count_[f] <= 0) {
+		num_freqs_--;
+		freq_lambda_[f] = freq_lambda_[num_freqs_];
+		freq_count_[f] = freq_count_[num_freqs_];
+	}
+}
+
+void
+WirelessChannel::freqChanged(WirelessPhy *wifp, double old_lambda)
+{
+	if (!wifp->freqSelective() || old_lambda == wifp->getLambda())
+		return;
+	addToFreqIndex(old_lambda, -1);
+	addToFreqIndex(wifp->getLambda(), 1);
+}
+
 void
 WirelessChannel::addNodeToList(MobileNode *mn)
 {
@@ -409,6 +510,8 @@ WirelessChannel::addNodeToList(MobileNode *mn)
 		mn->nextX_ = NULL;
 	}
 	numNodes_++;
+	if (grid_ != NULL)
+		gridInsert(mn);
 }
 
 void
@@ -429,6 +532,8 @@ WirelessChannel::removeNodeFromList(MobileNode *mn) {
 				tmp->nextX_->prevX_ = tmp->prevX_;
 			}
 			numNodes_--;
+			if (grid_ != NULL)
+				gridRemove(mn);
 			return;
 		}
 	}
@@ -482,6 +587,21 @@ WirelessChannel::updateNodesList(class MobileNode *mn, double oldX) {
 	MobileNode* tmp;
 	double X = mn->X();
 	bool skipX=false;
+
+	if (grid_index_) {
+		// the x-list is not kept in order, only the grid
+		if (grid_ == NULL)
+			return;
+		if (mn->speed() > max_speed_)
+			max_speed_ = mn->speed();
+		if (gridCell(mn->X(), mn->Y()) != mn->cell_) {
+			gridRemove(mn);
+			gridInsert(mn);
+		}
+		return;
+	}
+	if (X == oldX)
+		return;		// only moved along y, or changed speed
 	
 	if(!sorted_) {
 		sortLists();
@@ -565,7 +685,7 @@ WirelessChannel::getAffectedNodes(MobileNode *mn, double radius,
 {
 	double xmin, xmax, ymin, ymax;
 	int n = 0;
-	MobileNode *tmp, **list, **tmpList;
+	MobileNode *tmp, **tmpList;
 
 	if (xListHead_ == NULL) {
 		*numAffectedNodes=-1;
@@ -573,13 +693,20 @@ WirelessChannel::getAffectedNodes(MobileNode *mn, double radius,
 		return NULL;
 	}
 	
+	// First allocate as much as possibly needed
+	growAffected();
+
+	if (grid_index_) {
+		*numAffectedNodes = gridAffectedNodes(mn, radius);
+		return affected_;
+	}
+
 	xmin = mn->X() - radius;
 	xmax = mn->X() + radius;
 	ymin = mn->Y() - radius;
 	ymax = mn->Y() + radius;
-	
-	// First allocate as much as possibly needed
-	tmpList = new MobileNode*[numNodes_];
+
+	tmpList = affected_;
 	
 	for(tmp = xListHead_; tmp != NULL; tmp = tmp->nextX_) tmpList[n++] = tmp;
 	for(int i = 0; i < n; ++i)
@@ -597,13 +724,147 @@ WirelessChannel::getAffectedNodes(MobileNode *mn, double radius,
 			tmpList[n++] = tmp;
 		}
 	}
-	
-	list = new MobileNode*[n];
-	memcpy(list, tmpList, n * sizeof(MobileNode *));
-	delete [] tmpList;
          
 	*numAffectedNodes = n;
-	return list;
+	return tmpList;
+}
+
+void
+WirelessChannel::growAffected(void)
+{
+	if (affected_size_ >= numNodes_)
+		return;
+	delete [] affected_;
+	affected_size_ = numNodes_ + numNodes_ / 2;
+	affected_ = new MobileNode*[affected_size_];
+}
+
+/*
+ * Grid over the topography with cells of about cell_size, which is the
+ * query radius. The number of cells is kept in proportion to the number
+ * of nodes, positions outside the topography go to the border cells.
+ */
+void
+WirelessChannel::buildGrid(MobileNode *mn, double cell_size)
+{
+	Topography *T = mn->topography();
+	double maxX = (T != NULL && T->upperX() > 0) ? T->upperX() : cell_size;
+	double maxY = (T != NULL && T->upperY() > 0) ? T->upperY() : cell_size;
+	int max_cells = (4 * numNodes_ > 1024) ? 4 * numNodes_ : 1024;
+
+	cell_size_ = cell_size;
+	for (;;) {
+		grid_nx_ = (int) ceil(maxX / cell_size_);
+		grid_ny_ = (int) ceil(maxY / cell_size_);
+		if (grid_nx_ < 1)
+			grid_nx_ = 1;
+		if (grid_ny_ < 1)
+			grid_ny_ = 1;
+		if ((double) grid_nx_ * grid_ny_ <= max_cells)
+			break;
+		cell_size_ *= 2;
+	}
+
+	grid_ = new MobileNode*[grid_nx_ * grid_ny_];
+	for (int c = 0; c < grid_nx_ * grid_ny_; c++)
+		grid_[c] = NULL;
+	for (MobileNode *tmp = xListHead_; tmp != NULL; tmp = tmp->nextX_)
+		gridInsert(tmp);
+	gridSweep();
+}
+
+int
+WirelessChannel::gridCell(double x, double y)
+{
+	int cx = (int) floor(x / cell_size_);
+	int cy = (int) floor(y / cell_size_);
+
+	if (cx < 0)
+		cx = 0;
+	else if (cx >= grid_nx_)
+		cx = grid_nx_ - 1;
+	if (cy < 0)
+		cy = 0;
+	else if (cy >= grid_ny_)
+		cy = grid_ny_ - 1;
+	return cy * grid_nx_ + cx;
+}
+
+void
+WirelessChannel::gridInsert(MobileNode *mn)
+{
+	int c = gridCell(mn->X(), mn->Y());
+
+	mn->cell_ = c;
+	mn->prevCell_ = NULL;
+	mn->nextCell_ = grid_[c];
+	if (grid_[c] != NULL)
+		grid_[c]->prevCell_ = mn;
+	grid_[c] = mn;
+}
+
+void
+WirelessChannel::gridRemove(MobileNode *mn)
+{
+	if (mn->prevCell_ != NULL)
+		mn->prevCell_->nextCell_ = mn->nextCell_;
+	else
+		grid_[mn->cell_] = mn->nextCell_;
+	if (mn->nextCell_ != NULL)
+		mn->nextCell_->prevCell_ = mn->prevCell_;
+	mn->nextCell_ = mn->prevCell_ = NULL;
+}
+
+/* Bring every moving node up to date, which bounds how stale the grid is */
+void
+WirelessChannel::gridSweep(void)
+{
+	max_speed_ = 0;
+	for (MobileNode *tmp = xListHead_; tmp != NULL; tmp = tmp->nextX_) {
+		if (tmp->speed() != 0.0)
+			tmp->update_position();
+		if (tmp->speed() > max_speed_)
+			max_speed_ = tmp->speed();
+	}
+	sweep_time_ = Scheduler::instance().clock();
+}
+
+int
+WirelessChannel::gridAffectedNodes(MobileNode *mn, double radius)
+{
+	double now = Scheduler::instance().clock();
+	int n = 0, k = 0;
+
+	if (grid_ == NULL)
+		buildGrid(mn, radius);
+	else if (now - sweep_time_ > XLIST_POSITION_UPDATE_INTERVAL)
+		gridSweep();
+
+	double xmin = mn->X() - radius;
+	double xmax = mn->X() + radius;
+	double ymin = mn->Y() - radius;
+	double ymax = mn->Y() + radius;
+
+	// every node which may be in range by now
+	double slack = max_speed_ * (now - sweep_time_);
+	int c0 = gridCell(xmin - slack, ymin - slack);
+	int c1 = gridCell(xmax + slack, ymax + slack);
+	for (int cy = c0 / grid_nx_; cy <= c1 / grid_nx_; cy++)
+		for (int cx = c0 % grid_nx_; cx <= c1 % grid_nx_; cx++)
+			for (MobileNode *tmp = grid_[cy * grid_nx_ + cx];
+			     tmp != NULL; tmp = tmp->nextCell_)
+				affected_[n++] = tmp;
+
+	// updating a position may move the node to another cell
+	for (int i = 0; i < n; i++) {
+		MobileNode *tmp = affected_[i];
+		if (tmp->speed() != 0.0)
+			tmp->update_position();
+		if (tmp->X() >= xmin && tmp->X() <= xmax &&
+		    tmp->Y() >= ymin && tmp->Y() <= ymax)
+			affected_[k++] = tmp;
+	}
+	return k;
 }
  
 
@@ -48,6 +48,7 @@
 
 class Trace;
 class Node;
+class WirelessPhy;
 /*=================================================================
 Channel:  a shared medium that supports contention and collision
         This class is used to represent the physical media to which
@@ -108,6 +109,8 @@ public:
 	WirelessChannel(void);
 	virtual int command(int argc, const char*const* argv);
         inline double gethighestAntennaZ() { return highestAntennaZ_; }
+	// an attached interface was retuned, see WirelessPhy::setFreq()
+	void freqChanged(WirelessPhy *wifp, double old_lambda);
 
 private:
 	void sendUp(Packet* p, Phy *txif);
@@ -123,6 +126,48 @@ private:
 	void sortLists(void);
 	void updateNodesList(class MobileNode *mn, double oldX);
 	MobileNode **getAffectedNodes(MobileNode *mn, double radius, int *numAffectedNodes);
+
+	/* Frequency index: number of frequency selective interfaces tuned
+	   to each wavelength. With freq_partition_ set, frames are only
+	   copied to interfaces which can receive them. */
+	int freq_partition_;
+	double *freq_lambda_;
+	int *freq_count_;
+	int num_freqs_;
+	int num_nonselective_;	// interfaces that hear every frequency
+	int freqIndex(double lambda);
+	void addToFreqIndex(double lambda, int n);
+	inline int receives(Phy *rifp, double lambda);
+
+	/* With shared_rx_ set, receivers get a Packet::sharedcopy() of the
+	   frame instead of a full copy. The MAC has to leave everything but
+	   the common header alone, LL::recv() unshares the packet. */
+	int shared_rx_;
+
+	/* Spatial index for getAffectedNodes(). With grid_index_ set, nodes
+	   are kept in a uniform grid over the topography with cells of the
+	   query radius instead of the x-sorted list, and only the nodes in
+	   the cells around the transmitter get their position updated.
+	   Between two sweeps of all moving nodes, no node is further than
+	   max_speed_ * (now - sweep_time_) from the cell it is kept in. */
+	int grid_index_;
+	MobileNode **grid_;		// first node of each cell
+	int grid_nx_;
+	int grid_ny_;
+	double cell_size_;
+	double max_speed_;
+	double sweep_time_;
+	void buildGrid(MobileNode *mn, double cell_size);
+	int gridCell(double x, double y);
+	void gridInsert(MobileNode *mn);
+	void gridRemove(MobileNode *mn);
+	void gridSweep(void);
+	int gridAffectedNodes(MobileNode *mn, double radius);
+
+	/* result of getAffectedNodes(), valid until the next call */
+	MobileNode **affected_;
+	int affected_size_;
+	void growAffected(void);
 	
 protected:
 	static double distCST_;        
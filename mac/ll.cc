@@ -156,6 +156,8 @@ void LL::recv(Packet* p, Handler* /*h*/)
 	// If direction = UP, then pass it up the stack
 	// Otherwise, set direction to DOWN and pass it down the stack
 	if(ch->direction() == hdr_cmn::UP) {
+		// the upper layers may modify any header
+		p->unshare();
 		//if(mac_->hdr_type(mh) == ETHERTYPE_ARP)
 
 		if(ch->ptype_ == PT_ARP) {
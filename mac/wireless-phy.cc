@@ -74,7 +74,8 @@ public:
 } class_WirelessPhy;
 
 
-WirelessPhy::WirelessPhy() : Phy(), sleep_timer_(this), status_(IDLE)
+WirelessPhy::WirelessPhy() : Phy(), sleep_timer_(this), status_(IDLE),
+	skip_next_(0), skip_period_(0), skip_left_(0)
 {
 	/*
 	 *  It sounds like 10db should be the capture threshold.
@@ -100,6 +101,7 @@ WirelessPhy::WirelessPhy() : Phy(), sleep_timer_(this), status_(IDLE)
 	bind("L_", &L_);
 
 	lambda_ = SPEED_OF_LIGHT / freq_;
+	freq_selective_ = 1;
 
 	node_ = 0;
 	ant_ = 0;
@@ -214,6 +216,7 @@ WirelessPhy::sendDown(Packet *p)
 	assert(initialized());
 
 	if (em()) {
+			catch_up();
 			//node is off here...
 			if (Is_node_on() != true ) {
 			Packet::free(p);
@@ -339,6 +342,7 @@ WirelessPhy::sendUp(Packet *p)
 
 	// if the node is in sleeping mode, drop the packet simply
 	if (em()) {
+			catch_up();
 			if (Is_node_on()!= true){
 			pkt_recvd = 0;
 			goto DONE;
@@ -360,7 +364,7 @@ WirelessPhy::sendUp(Packet *p)
 
 	if(propagation_) {
 		s.stamp((MobileNode*)node(), ant_, 0, lambda_);
-		Pr = propagation_->Pr(&p->txinfo_, &s, this);
+		Pr = propagation_->cachedPr(&p->txinfo_, &s, this);
 		//printf("Receive Power %e\n",Pr);
 		if (Pr < CSThresh_) {
 			pkt_recvd = 0;
@@ -459,14 +463,21 @@ DONE:
 void
 WirelessPhy::setFreq(double new_freq)
 {
+	double old_lambda = lambda_;
+
 	freq_ = new_freq;
 	lambda_ = SPEED_OF_LIGHT / freq_;
+	// keep the channel's frequency index in step
+	WirelessChannel *wchan = dynamic_cast<WirelessChannel*>(channel_);
+	if (wchan)
+		wchan->freqChanged(this, old_lambda);
 	//printf("Radio is changed to new frequency %f\n",freq_);
 }
 void
 WirelessPhy::node_on()
 {
 
+	catch_up();
         node_on_= TRUE;
 	status_ = IDLE;
 
@@ -481,6 +492,7 @@ void
 WirelessPhy::node_off()
 {
 
+	catch_up();
         node_on_= FALSE;
 	status_ = SLEEP;
 
@@ -496,6 +508,7 @@ WirelessPhy::node_off()
 void
 WirelessPhy::node_wakeup()
 {
+	catch_up();
 
 	if (status_== IDLE)
 		return;
@@ -528,6 +541,7 @@ WirelessPhy::node_sleep()
 //        node_on_= FALSE;
 //
     //printf("turn node to sleep\n");
+	catch_up();
 	if (status_== SLEEP)
 		return;
 
@@ -551,6 +565,66 @@ WirelessPhy::node_sleep()
 	        }
 	}
 }
+
+void
+WirelessPhy::skip_ticks(double first, double period, int n)
+{
+	catch_up();
+	if (em() == NULL)
+		return;
+	skip_next_ = first;
+	skip_period_ = period;
+	skip_left_ = n;
+}
+
+void
+WirelessPhy::end_skip()
+{
+	catch_up();
+	skip_left_ = 0;
+}
+
+/*
+ * Charge the skipped ticks due by now, a tick counting as before anything
+ * else at its time. Each does what node_sleep() and node_wakeup() at its
+ * time would, i.e. it flips IDLE and SLEEP unless the energy is up to date
+ * already, but the energy model is charged once for all of them.
+ */
+void
+WirelessPhy::apply_ticks()
+{
+	double idle = 0, sleep = 0;
+	int transitions = 0;
+
+	while (skip_left_ > 0 && skip_next_ <= NOW) {
+		double t = skip_next_;
+		if (t > update_energy_time_ &&
+		    (status_ == IDLE || status_ == SLEEP)) {
+			if (status_ == IDLE) {
+				idle += t - update_energy_time_;
+				status_ = SLEEP;
+			} else {
+				sleep += t - update_energy_time_;
+				status_ = IDLE;
+			}
+			update_energy_time_ = t;
+			transitions++;
+		}
+		skip_next_ += skip_period_;
+		skip_left_--;
+	}
+	if (transitions == 0 || em() == NULL)
+		return;
+	em()->DecrTransitionEnergy(transitions * T_transition_, P_transition_);
+	em()->DecrIdleEnergy(idle, P_idle_);
+	em()->DecrSleepEnergy(sleep, P_sleep_);
+	if (em()->energy() > 0) {
+		((MobileNode *)node_)->log_energy(1);
+	} else {
+		((MobileNode *)node_)->log_energy(0);
+	}
+}
+
 //
 void
 WirelessPhy::dump(void) const
@@ -569,6 +643,7 @@ void WirelessPhy::UpdateIdleEnergy()
 	if (em() == NULL) {
 		return;
 	}
+	catch_up();
 	if (NOW > update_energy_time_ && (Is_node_on()==TRUE && status_ == IDLE ) ) {
 		  em()-> DecrIdleEnergy(NOW-update_energy_time_,
 					P_idle_);
@@ -601,6 +676,7 @@ void WirelessPhy::UpdateSleepEnergy()
 	if (em() == NULL) {
 		return;
 	}
+	catch_up();
 	if (NOW > update_energy_time_ && ( Is_node_on()==TRUE  && Is_sleeping() == true) ) {
 		  em()-> DecrSleepEnergy(NOW-update_energy_time_,
 					P_sleep_);
@@ -91,11 +91,19 @@ public:
         inline double getCSThresh() { return CSThresh_; }
         inline double getFreq() { return freq_; }
         /* End -NEW- */
+        // 1 if sendUp() drops every frame sent on another frequency
+        inline int freqSelective() const { return freq_selective_; }
         
         void setFreq(double new_freq);
 
 	void node_sleep();
 	void node_wakeup();
+	// A TDMA MAC leaves out its next n slot ticks, the first at time
+	// first and then period apart. Each of them would call node_sleep()
+	// and node_wakeup(), they are charged when the energy is next used.
+	void skip_ticks(double first, double period, int n);
+	// charge the skipped ticks up to now and drop the others
+	void end_skip();
 	inline bool& Is_node_on() { return node_on_; }
 	inline bool Is_sleeping() { if (status_==SLEEP) return(1); else return(0); }
 	double T_sleep_;	// 2.31 change: Time at which sleeping is to be enabled (sec)
@@ -116,6 +124,7 @@ protected:
 
 	double freq_;           // frequency
 	double lambda_;		// wavelength (m)
+	int freq_selective_;	// frames on other frequencies are dropped
 	double L_;		// system loss factor
   
 	double RXThresh_;	// receive power threshold (W)
@@ -134,12 +143,21 @@ protected:
 	Sleep_Timer sleep_timer_;
 	int status_;
 
+	double skip_next_;	// time of the next skipped tick
+	double skip_period_;
+	int skip_left_;		// skipped ticks not charged yet
+
 private:
 	inline int initialized() {
 		return (node_ && uptarget_ && downtarget_ && propagation_);
 	}
 	void UpdateIdleEnergy();
 	void UpdateSleepEnergy();
+	inline void catch_up() {
+		if (skip_left_ > 0)
+			apply_ticks();
+	}
+	void apply_ticks();
 
 	// Convenience method
 	EnergyModel* em() { return node()->energy_model(); }
@@ -102,6 +102,8 @@ WirelessPhyExt::WirelessPhyExt() :
 	bind("PowerMonitorThresh_", &PowerMonitorThresh_);
 
 	lambda_ = SPEED_OF_LIGHT / freq_;
+	// frames on other frequencies still add to the interference
+	freq_selective_ = 0;
 	node_ = 0;
 	ant_ = 0;
 	propagation_ = 0;
@@ -200,7 +202,7 @@ int WirelessPhyExt::sendUp(Packet *p) {
 	if (propagation_) {
 		s.stamp((MobileNode*)node(), ant_, 0, lambda_);
 		// pass the packet to RF model for the calculation of Pr
-		Pr = propagation_->Pr(&p->txinfo_, &s, this);
+		Pr = propagation_->cachedPr(&p->txinfo_, &s, this);
 		powerMonitor->recordPowerLevel(Pr, cmh->txtime());
 
 		if (PHY_DBG) {
@@ -40,6 +40,9 @@ class PropRicean : public TwoRayGround {
 public:
 	PropRicean();
 	virtual double Pr(PacketStamp *tx, PacketStamp *rx, WirelessPhy *ifp);
+	// the Ricean fading is computed in Pr(), not cached
+	virtual int pathLoss(PacketStamp *, PacketStamp *, WirelessPhy *,
+			     double *) { return 0; }
 	virtual int command(int argc, const char*const* argv);
 	~PropRicean();
 
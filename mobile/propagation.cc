@@ -40,13 +40,43 @@
 #include <topography.h>
 #include <propagation.h>
 #include <wireless-phy.h>
+#include <omni-antenna.h>
 
 class PacketStamp;
+
+Propagation::Propagation() : name(NULL), topo(NULL), cache_(NULL),
+			     cache_hits_(0), cache_misses_(0)
+{
+  bind("cache_size_", &cache_size_);
+}
+
+Propagation::~Propagation()
+{
+  delete [] cache_;
+}
+
 int
 Propagation::command(int argc, const char*const* argv)
 {
   TclObject *obj;  
 
+  if(argc == 2)
+    {
+      Tcl& tcl = Tcl::instance();
+      // hits and misses of the path loss cache
+      if (strcasecmp(argv[1], "cache-stats") == 0)
+	{
+	  tcl.resultf("%lu %lu", cache_hits_, cache_misses_);
+	  return TCL_OK;
+	}
+      // needed after changing antenna gains from a script
+      if (strcasecmp(argv[1], "cache-clear") == 0)
+	{
+	  clearCache();
+	  return TCL_OK;
+	}
+    }
+
   if(argc == 3) 
     {
       if( (obj = TclObject::lookup(argv[2])) == 0) 
@@ -66,6 +96,70 @@ Propagation::command(int argc, const char*const* argv)
 }
  
 
+void
+Propagation::clearCache()
+{
+  if (cache_ == NULL)
+    return;
+  for (int i = 0; i < cache_size_; i++)
+    cache_[i].tnode = NULL;
+}
+
+double
+Propagation::cachedPr(PacketStamp *t, PacketStamp *r, WirelessPhy *ifp)
+{
+  // only omni antennas have gains which do not change with time
+  if (cache_size_ <= 0 ||
+      dynamic_cast<OmniAntenna*>(t->getAntenna()) == NULL ||
+      dynamic_cast<OmniAntenna*>(r->getAntenna()) == NULL)
+    return Pr(t, r, ifp);
+
+  if (cache_ == NULL)
+    {
+      cache_ = new PrCacheEntry[cache_size_];
+      for (int i = 0; i < cache_size_; i++)
+	cache_[i].tnode = NULL;
+    }
+
+  MobileNode *tn = t->getNode();
+  MobileNode *rn = r->getNode();
+  double tX, tY, tZ, rX, rY, rZ;
+  tn->getLoc(&tX, &tY, &tZ);
+  rn->getLoc(&rX, &rY, &rZ);
+  double lambda = ifp->getLambda();
+
+  unsigned long h = (unsigned long) tn->nodeid() * 31 +
+    (unsigned long) rn->nodeid();
+  PrCacheEntry *e = &cache_[h % cache_size_];
+
+  if (e->tnode == tn && e->rnode == rn && e->lambda == lambda &&
+      e->tant == t->getAntenna() && e->rant == r->getAntenna() &&
+      e->tX == tX && e->tY == tY && e->tZ == tZ &&
+      e->rX == rX && e->rY == rY && e->rZ == rZ &&
+      e->Pt == t->getTxPr() && e->L == ifp->getL())
+    {
+      cache_hits_++;
+      return fade(e->path, t, r, ifp);
+    }
+
+  cache_misses_++;
+  if (!pathLoss(t, r, ifp, e->path))
+    {
+      e->tnode = NULL;
+      return Pr(t, r, ifp);
+    }
+  e->tnode = tn;
+  e->rnode = rn;
+  e->tant = t->getAntenna();
+  e->rant = r->getAntenna();
+  e->tX = tX; e->tY = tY; e->tZ = tZ;
+  e->rX = rX; e->rY = rY; e->rZ = rZ;
+  e->lambda = lambda;
+  e->Pt = t->getTxPr();
+  e->L = ifp->getL();
+  return fade(e->path, t, r, ifp);
+}
+
 /* As new network-intefaces are added, add a default method here */
 
 double
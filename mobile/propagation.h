@@ -51,6 +51,26 @@
 
 class PacketStamp;
 class WirelessPhy;
+class MobileNode;
+class Antenna;
+
+/*
+ * Entry of the path loss cache, the deterministic part of Pr() for one
+ * (transmitter, receiver, wavelength) and the state it was computed from.
+ */
+struct PrCacheEntry {
+	MobileNode	*tnode;
+	MobileNode	*rnode;
+	Antenna		*tant;
+	Antenna		*rant;
+	double		tX, tY, tZ;
+	double		rX, rY, rZ;
+	double		lambda;
+	double		Pt;
+	double		L;
+	double		path[2];	// see Propagation::pathLoss()
+};
+
 /*======================================================================
    Progpagation Models
 
@@ -67,7 +87,8 @@ class WirelessPhy;
 class Propagation : public TclObject {
 
 public:
-  Propagation() : name(NULL), topo(NULL) {}
+  Propagation();
+  ~Propagation();
 
   // calculate the Pr by which the receiver will get a packet sent by
   // the node that applied the tx PacketStamp for a given inteface 
@@ -76,6 +97,19 @@ public:
   virtual double Pr(PacketStamp *tx, PacketStamp *rx, WirelessPhy *);
   virtual int command(int argc, const char*const* argv);
 
+  // Pr() through the path loss cache. A cached result is used as long as
+  // both nodes stay where they are and the wavelength, transmit power,
+  // system loss and antennas are the same, only fade() is applied again.
+  double cachedPr(PacketStamp *tx, PacketStamp *rx, WirelessPhy *);
+
+  // Split of Pr() into the deterministic path loss, which may be cached,
+  // and the random fading applied on top of it. pathLoss() returns 0 for
+  // models that do not support the split, they are never cached.
+  virtual int pathLoss(PacketStamp *, PacketStamp *, WirelessPhy *,
+		       double * /*path*/) { return 0; }
+  virtual double fade(double *path, PacketStamp *, PacketStamp *,
+		      WirelessPhy *) { return path[0]; }
+
   // get interference distance
   virtual double getDist(double Pr, double Pt, double Gt, double Gr,
 			 double hr, double ht, double L, double lambda);
@@ -94,6 +128,13 @@ public:
 protected:
   char *name;
   Topography *topo;
+
+  // direct-mapped path loss cache of cache_size_ entries, 0 disables it
+  int cache_size_;
+  PrCacheEntry *cache_;
+  unsigned long cache_hits_;
+  unsigned long cache_misses_;
+  void clearCache();
 };
 
 
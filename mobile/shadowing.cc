@@ -93,6 +93,16 @@ Shadowing::~Shadowing()
 
 
 double Shadowing::Pr(PacketStamp *t, PacketStamp *r, WirelessPhy *ifp)
+{
+	double path[2];
+
+	pathLoss(t, r, ifp, path);
+	return fade(path, t, r, ifp);
+}
+
+
+int Shadowing::pathLoss(PacketStamp *t, PacketStamp *r, WirelessPhy *ifp,
+			double *path)
 {
 	double L = ifp->getL();		// system loss
 	double lambda = ifp->getLambda();   // wavelength
@@ -130,6 +140,18 @@ double Shadowing::Pr(PacketStamp *t, PacketStamp *r, WirelessPhy *ifp)
         } else {
             avg_db = 0.0;
         }
+
+	path[0] = Pr0;
+	path[1] = avg_db;
+	return 1;
+}
+
+
+double Shadowing::fade(double *path, PacketStamp *, PacketStamp *,
+		       WirelessPhy *)
+{
+	double Pr0 = path[0];
+	double avg_db = path[1];
    
 	// get power loss by adding a log-normal random variable (shadowing)
 	// the power loss is relative to that at reference distance dist0_
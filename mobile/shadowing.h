@@ -66,6 +66,11 @@ public:
 	Shadowing();
 	~Shadowing();
 	virtual double Pr(PacketStamp *tx, PacketStamp *rx, WirelessPhy *ifp);
+	// path[0] is the power at dist0_, path[1] the average loss in dB
+	virtual int pathLoss(PacketStamp *tx, PacketStamp *rx, WirelessPhy *ifp,
+			     double *path);
+	virtual double fade(double *path, PacketStamp *tx, PacketStamp *rx,
+			    WirelessPhy *ifp);
 	virtual double getDist(double Pr, double Pt, double Gt, double Gr,
 			       double hr, double ht, double L, double lambda) {
 		return DBL_MAX;
@@ -48,6 +48,12 @@ class TwoRayGround : public Propagation {
 public:
   TwoRayGround();
   virtual double Pr(PacketStamp *tx, PacketStamp *rx, WirelessPhy *ifp);
+  // no fading, the whole result is cached
+  virtual int pathLoss(PacketStamp *tx, PacketStamp *rx, WirelessPhy *ifp,
+		       double *path) {
+    path[0] = TwoRayGround::Pr(tx, rx, ifp);
+    return 1;
+  }
   virtual double getDist(double Pr, double Pt, double Gt, double Gr,
 			 double hr, double ht, double L, double lambda);
 
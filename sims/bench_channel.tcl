@@ -0,0 +1,97 @@
+#Benchmark: receiver lookup of Channel/WirelessChannel
+#
+#Usage: ns bench_channel.tcl ?nodes? ?grid_index? ?duration?
+#
+# nodes        number of mobile nodes, default 1000
+# grid_index   0 uses the x-sorted node list, 1 the grid index
+# duration     simulated seconds, default 10
+#
+# Mobile nodes move at 1-20 m/s over a square area sized so that about 30
+# nodes are within carrier sense range of each other, every node broadcasts
+# one packet per second. Compare the wall clock time of both lookups with
+# e.g.
+#   for n in 1000 10000; do for g in 0 1; do ns bench_channel.tcl $n $g; done; done
+
+set val(nn)		1000
+set val(grid)		0
+set val(stop)		10.0
+if { $argc > 0 } { set val(nn) [lindex $argv 0] }
+if { $argc > 1 } { set val(grid) [lindex $argv 1] }
+if { $argc > 2 } { set val(stop) [lindex $argv 2] }
+
+#only the headers needed to broadcast
+remove-all-packet-headers
+add-packet-header IP LL Mac ARP
+
+set val(chan)           Channel/WirelessChannel    ;# channel type
+set val(prop)           Propagation/TwoRayGround   ;# radio-propagation model
+set val(netif)          Phy/WirelessPhy            ;# network interface type
+set val(mac)            Mac/Simple                 ;# MAC type
+set val(ifq)            Queue/DropTail/PriQueue    ;# interface queue type
+set val(ll)             LL                         ;# link layer type
+set val(ant)            Antenna/OmniAntenna        ;# antenna model
+set val(ifqlen)         50                         ;# max packet in ifq
+set val(rp)             DumbAgent                  ;# routing protocol
+
+#default WirelessPhy thresholds give about 550 m carrier sense range
+set density [expr 30.0 / (3.1415926535 * 550.0 * 550.0)]
+set val(x) [expr int(sqrt($val(nn) / $density))]
+set val(y) $val(x)
+
+Channel/WirelessChannel set grid_index_ $val(grid)
+
+set ns_ [new Simulator]
+set topo [new Topography]
+$topo load_flatgrid $val(x) $val(y)
+create-god $val(nn)
+
+set chan_ [new $val(chan)]
+$ns_ node-config -adhocRouting $val(rp) \
+		 -llType $val(ll) \
+		 -macType $val(mac) \
+		 -ifqType $val(ifq) \
+		 -ifqLen $val(ifqlen) \
+		 -antType $val(ant) \
+		 -propType $val(prop) \
+		 -phyType $val(netif) \
+		 -channel $chan_ \
+		 -topoInstance $topo \
+		 -agentTrace OFF \
+		 -routerTrace OFF \
+		 -macTrace OFF \
+		 -movementTrace OFF
+
+set rng [new RNG]
+$rng seed 1
+
+for {set i 0} {$i < $val(nn)} {incr i} {
+	set node_($i) [$ns_ node]
+	$node_($i) random-motion 0
+	$node_($i) set X_ [expr 1 + [$rng uniform 0 [expr $val(x) - 2]]]
+	$node_($i) set Y_ [expr 1 + [$rng uniform 0 [expr $val(y) - 2]]]
+	$node_($i) set Z_ 0.0
+
+	set dx [expr 1 + [$rng uniform 0 [expr $val(x) - 2]]]
+	set dy [expr 1 + [$rng uniform 0 [expr $val(y) - 2]]]
+	$ns_ at 0.0 "$node_($i) setdest $dx $dy [$rng uniform 1 20]"
+
+	set udp_($i) [new Agent/UDP]
+	$udp_($i) set dst_addr_ -1
+	$ns_ attach-agent $node_($i) $udp_($i)
+	set cbr_($i) [new Application/Traffic/CBR]
+	$cbr_($i) set packetSize_ 64
+	$cbr_($i) set interval_ 1.0
+	$cbr_($i) attach-agent $udp_($i)
+	$ns_ at [$rng uniform 0 1.0] "$cbr_($i) start"
+}
+
+proc finish {} {
+	global ns_ val start_
+	set wall [expr [clock clicks -milliseconds] - $start_]
+	puts "nodes $val(nn) grid_index $val(grid) duration $val(stop) wall ${wall} ms"
+	$ns_ halt
+}
+
+set start_ [clock clicks -milliseconds]
+$ns_ at $val(stop) "finish"
+$ns_ run
@@ -0,0 +1,46 @@
+#Benchmark: replay a recorded event stream against the schedulers
+#
+#Usage: ns bench_sched.tcl stream ?scheduler ...?
+#
+# stream       insert/cancel/deque stream of a run, written by
+#              "$ns_ record-scheduler stream" right after new Simulator,
+#              e.g. ns bench_tdl.tcl dyn 16 1 3 5e4 120 tdl.sched
+# scheduler    Scheduler/<scheduler> to replay it against, default
+#              List Heap Calendar Splay Ladder. List is O(n) per insert,
+#              leave it out for streams with long queues.
+#
+# Prints one line of key=value pairs per scheduler:
+#   sched            the scheduler
+#   ops inserts cancels deques   operations replayed
+#   ns_per_op        wall clock time per operation
+#   cache_misses     cache misses per operation, -1 without perf counters
+#                    (see /proc/sys/kernel/perf_event_paranoid)
+#   q_mean q_max     queue size over the operations, the same for all
+#
+# The stream holds the delays only, so the replay costs the same for
+# every scheduler but the queue itself. Pick the one with the lowest
+# ns_per_op for the scenario.
+
+if { $argc < 1 } {
+	puts stderr "usage: ns bench_sched.tcl stream ?scheduler ...?"
+	exit 1
+}
+set stream [lindex $argv 0]
+set types {List Heap Calendar Splay Ladder}
+if { $argc > 1 } { set types [lrange $argv 1 end] }
+
+set bench [new SchedBench]
+puts "stream=$stream ops=[$bench load $stream]"
+foreach type $types {
+	if { [catch {new Scheduler/$type} s] } {
+		puts stderr "no Scheduler/$type"
+		continue
+	}
+	set line "sched=$type"
+	foreach {key val} [$bench run $s] {
+		append line " $key=$val"
+	}
+	puts $line
+	delete $s
+}
+exit 0
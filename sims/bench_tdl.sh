@@ -0,0 +1,47 @@
+#!/bin/sh
+#Benchmark sweep of bench_tdl.tcl
+#
+#Usage: sh bench_tdl.sh ?output? ?duration?
+#
+# Runs every configuration below with the ns in PATH (or $NS) and writes
+# one CSV row per run to output, default bench_tdl.csv. Run it from sims/,
+# Mac/FixTdma reads ./tdma_table. Override the sweep with the MACS, NODES,
+# NETS, MIXES and BWS variables, e.g.
+#   NODES="16 64" MIXES="3" sh bench_tdl.sh
+
+NS=${NS:-ns}
+OUT=${1:-bench_tdl.csv}
+DURATION=${2:-120}
+MACS=${MACS:-"dyn fix"}
+NODES=${NODES:-"8 16 32 64"}
+NETS=${NETS:-"1 4"}
+MIXES=${MIXES:-"3 1,2,3"}
+BWS=${BWS:-"5e4 1e6"}
+
+COLS="mac nodes nets mix bw duration wall_ms events rss_kb pkt_alloc pkt_new ne_nodes ne_last ne_max slot_util"
+
+echo $COLS | tr ' ' ',' > $OUT
+for mac in $MACS; do
+for nn in $NODES; do
+for nets in $NETS; do
+for mix in $MIXES; do
+for bw in $BWS; do
+	line=`$NS bench_tdl.tcl $mac $nn $nets $mix $bw $DURATION | grep '^mac='`
+	if [ -z "$line" ]; then
+		echo "run failed: $mac $nn $nets $mix $bw" 1>&2
+		continue
+	fi
+	echo "$line"
+	# key=value pairs to a CSV row, mix is quoted as it may hold commas
+	row=""
+	for col in $COLS; do
+		val=`echo "$line" | tr ' ' '\n' | grep "^$col=" | cut -d= -f2`
+		[ $col = mix ] && val="\"$val\""
+		row="$row${row:+,}$val"
+	done
+	echo "$row" >> $OUT
+done
+done
+done
+done
+done
@@ -0,0 +1,192 @@
+#Benchmark: simulator cost of the TDL MACs
+#
+#Usage: ns bench_tdl.tcl ?mac? ?nodes? ?nets? ?mix? ?bandwidth? ?duration? ?record?
+#
+# mac          dyn for Mac/DynamicTdma, fix for Mac/FixTdma, default dyn
+# nodes        number of mobile nodes, default 16
+# nets         nodes are spread round robin over nets 1..nets, default 1
+# mix          message types handed out round robin, e.g. 3 or 1,2,3
+# bandwidth    Mac bandwidth_ in bit/s, default 5e4
+# duration     simulated seconds, default 120
+# record       file to record the scheduler stream to, for bench_sched.tcl
+#
+# All nodes are within range of each other and start their application
+# one every second. The run ends with one line of key=value pairs:
+#   mac nodes nets mix bw duration   the configuration
+#   wall_ms       wall clock time of "$ns_ run"
+#   events        events dispatched by the scheduler
+#   rss_kb        peak resident set size (VmHWM, Linux only, else -1)
+#   pkt_alloc     packets allocated, pkt_new of them not from the free list
+#   ne_nodes      nodes which completed net entry (dyn only)
+#   ne_last       simulated time the last of them completed it
+#   ne_max        longest single net entry
+#   slot_util     data slots used over data slots reserved, last record
+#
+# Mac/FixTdma reads its schedule from ./tdma_table, so run it from sims/.
+# bench_tdl.sh sweeps a set of configurations.
+
+set val(mac)		dyn
+set val(nn)		16
+set val(nets)		1
+set val(mix)		3
+set val(bw)		5e4
+set val(stop)		120.0
+if { $argc > 0 } { set val(mac) [lindex $argv 0] }
+if { $argc > 1 } { set val(nn) [lindex $argv 1] }
+if { $argc > 2 } { set val(nets) [lindex $argv 2] }
+if { $argc > 3 } { set val(mix) [lindex $argv 3] }
+if { $argc > 4 } { set val(bw) [lindex $argv 4] }
+if { $argc > 5 } { set val(stop) [lindex $argv 5] }
+if { $argc > 6 } { set val(record) [lindex $argv 6] }
+
+remove-all-packet-headers
+add-packet-header IP ARP LL Mac TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
+
+if { $val(mac) == "fix" } {
+	set val(macType) Mac/FixTdma
+} else {
+	set val(macType) Mac/DynamicTdma
+}
+set types [split $val(mix) ,]
+
+Mac set bandwidth_ $val(bw)
+$val(macType) set is_active_ 1
+
+# radio setup of sim_netEntry.tcl, every node hears every other one
+set RxT_ 1e-13
+set Frequency_ [expr (300e+6) + 2500*2]
+Phy/WirelessPhy set CPThresh_ 10.0
+Phy/WirelessPhy set CSThresh_ 1e-13
+Phy/WirelessPhy set RXThresh_ $RxT_
+Phy/WirelessPhy set freq_ $Frequency_
+Phy/WirelessPhy set L_ 1.0
+Antenna/OmniAntenna set Z_ 100.0
+set d4 [expr 300000.0*300000.0*300000.0*300000.0]
+set hr2ht2 [expr 100.0*100.0*100.0*100.0]
+Phy/WirelessPhy set Pt_ [expr $d4*$RxT_/$hr2ht2]
+
+set ns_ [new Simulator]
+if { [info exists val(record)] } {
+	$ns_ record-scheduler $val(record)
+}
+set topo [new Topography]
+$topo load_flatgrid 2000 2000
+create-god $val(nn)
+
+$ns_ node-config -adhocRouting NOAH \
+		 -llType LL \
+		 -macType $val(macType) \
+		 -ifqType Queue/DropTail/PriQueue \
+		 -ifqLen 100 \
+		 -antType Antenna/OmniAntenna \
+		 -propType Propagation/TwoRayGround \
+		 -phyType Phy/WirelessPhy \
+		 -channelType Channel/WirelessChannel \
+		 -topoInstance $topo \
+		 -agentTrace OFF \
+		 -routerTrace OFF \
+		 -macTrace OFF \
+		 -movementTrace OFF
+
+# metrics sent to the record procs, the others are dropped
+set ne(nodes) 0
+set ne(last) 0.0
+set ne(max) 0.0
+proc recordNETime {node_id num_node ne_time} {
+	global ns_ ne
+	incr ne(nodes)
+	set ne(last) [$ns_ now]
+	if { $ne_time > $ne(max) } { set ne(max) $ne_time }
+}
+proc recordSlotUtil {node_id record_time slots_reserved slots_used} {
+	global util
+	set util($node_id) [list $slots_reserved $slots_used]
+}
+foreach p {recordPktArrTime recordNLTime recordResolveTime recordMsgUpdateTime
+	   recordPacketDelay recordAvgPacketDelay recordThroughput recordRAP
+	   recordPosReport recordRadarTrack} {
+	proc $p args {}
+}
+
+set rng [new RNG]
+$rng seed 1
+
+for {set i 0} {$i < $val(nn)} {incr i} {
+	set net [expr $i % $val(nets) + 1]
+	Mac/DynamicTdma set assigned_Net_ $net
+	Application/TdlDataApp set netID_ $net
+	Application/TdlDataApp set msgType_ [lindex $types [expr $i % [llength $types]]]
+
+	set node_($i) [$ns_ node]
+	$node_($i) random-motion 0
+	$node_($i) set X_ [$rng uniform 0 1000]
+	$node_($i) set Y_ [$rng uniform 0 1000]
+	$node_($i) set Z_ 0.0
+
+	set tdludp_($i) [new Agent/UDP/TdlDataUDP]
+	$ns_ attach-agent $node_($i) $tdludp_($i)
+	set sink_($i) [new Agent/UDP/TdlDataUDP]
+	$ns_ attach-agent $node_($i) $sink_($i)
+	set tdldata_($i) [new Application/TdlDataApp]
+	$tdldata_($i) attach-agent $tdludp_($i)
+	set sinkdata_($i) [new Application/TdlDataApp]
+	$sinkdata_($i) attach-agent $sink_($i)
+}
+
+# every node sends to the next node of its net
+for {set i 0} {$i < $val(nn)} {incr i} {
+	set j [expr ($i + $val(nets)) % $val(nn)]
+	if { $j != $i } {
+		$ns_ connect $tdludp_($i) $sink_($j)
+	}
+	$ns_ at [expr 1.0 + $i] "$tdldata_($i) start"
+}
+
+proc peakRSS {} {
+	if { [catch {open /proc/self/status r} f] } {
+		return -1
+	}
+	set rss -1
+	while { [gets $f line] >= 0 } {
+		if { [lindex $line 0] == "VmHWM:" } {
+			set rss [lindex $line 1]
+		}
+	}
+	close $f
+	return $rss
+}
+
+proc finish {} {
+	global ns_ val start_ ne util
+	set wall [expr [clock clicks -milliseconds] - $start_]
+	set pm [$ns_ set packetManager_]
+
+	set reserved 0
+	set used 0
+	foreach id [array names util] {
+		incr reserved [lindex $util($id) 0]
+		incr used [lindex $util($id) 1]
+	}
+	if { $reserved > 0 } {
+		set slot_util [format %.4f [expr double($used) / $reserved]]
+	} else {
+		set slot_util 0
+	}
+	if { $val(mac) == "fix" } {
+		set ne(nodes) -
+		set ne(last) -
+		set ne(max) -
+	}
+
+	puts "mac=$val(mac) nodes=$val(nn) nets=$val(nets) mix=$val(mix)\
+	      bw=$val(bw) duration=$val(stop) wall_ms=$wall\
+	      events=[[$ns_ set scheduler_] dispatched] rss_kb=[peakRSS]\
+	      pkt_alloc=[$pm set num_alloc_] pkt_new=[$pm set num_new_]\
+	      ne_nodes=$ne(nodes) ne_last=$ne(last) ne_max=$ne(max)\
+	      slot_util=$slot_util"
+	$ns_ halt
+}
+
+set start_ [clock clicks -milliseconds]
+$ns_ at $val(stop) "finish"
+$ns_ run
@@ -8,7 +8,7 @@
 #remove unnescessary headers 
 remove-all-packet-headers
 #add require header i.e. IP
-add-packet-header IP RTP ARP LL Mac HdrNbInfo TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
+add-packet-header IP RTP ARP LL Mac TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
 
 # ======================================================================
 
@@ -51,6 +51,11 @@ Mac set bandwidth_ 5e4
 #Mac/FixTdma set active_node_ 	16
 #Mac/FixTdma set-table "tdma_table.txt"
 
+# "ns sim_netEntry.tcl nopool" allocates a packet for every control frame
+if {[lindex $argv 0] == "nopool"} {
+	Mac/DynamicTdma set pool_ctrl_ 0
+}
+
 #set net id 
 Mac/DynamicTdma set assigned_Net_ 2		;# support net 1-8, default is net 1
 Application/TdlDataApp set netID_ 2
@@ -111,8 +116,21 @@ $ns_ namtrace-all-wireless $nf2 $val(x) $val(y)
 
 #define procedure to be executed after simulation is finished
 proc stop {} {
-	global ns_ nf1 nf2 f1 f2 f3 f4 f5 f6 f7 f8 f9 f10 f11 f12
+	global ns_ nf1 nf2 f1 f2 f3 f4 f5 f6 f7 f8 f9 f10 f11 f12 node_ val
         $ns_ flush-trace
+        # Packet::alloc() calls of the whole run and those of the MACs for
+        # control frames, compare with "ns sim_netEntry.tcl nopool"
+        set alloc 0
+        set ctrl 0
+        set data 0
+        for {set i 0} {$i < $val(nn)} {incr i} {
+        	set st [[$node_($i) set mac_(0)] alloc-stats]
+        	incr alloc [lindex $st 1]
+        	incr ctrl [lindex $st 3]
+        	incr data [lindex $st 5]
+        }
+        set pm [$ns_ set packetManager_]
+        puts "pool_ctrl [Mac/DynamicTdma set pool_ctrl_]: Packet::alloc [$pm set num_alloc_], new [$pm set num_new_], MAC control frame allocs $alloc, control frames $ctrl, data frames $data"
         close $nf1
         close $nf2
         close $f1
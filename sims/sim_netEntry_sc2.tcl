@@ -8,7 +8,7 @@
 #remove unnescessary headers 
 remove-all-packet-headers
 #add require header i.e. IP
-add-packet-header IP RTP ARP LL Mac HdrNbInfo TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
+add-packet-header IP RTP ARP LL Mac TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
 
 # ======================================================================
 
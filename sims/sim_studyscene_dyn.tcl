@@ -8,7 +8,7 @@
 #remove unnescessary headers 
 remove-all-packet-headers
 #add require header i.e. IP
-add-packet-header IP ARP LL Mac HdrNbInfo TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
+add-packet-header IP ARP LL Mac TdlData TdlMsgUpdate TdlNetUpdate NetEntryMsg PollingMsg ControlMsg
 
 # ======================================================================
 
@@ -87,6 +87,27 @@ puts "tx power is $TP_"
 
 #Create simulator object
 set ns_ [new Simulator]
+
+# "ns sim_studyscene_dyn.tcl save <file> <time>" saves the net state at
+# time, "ns sim_studyscene_dyn.tcl restore <file>" goes on from there
+source tdl_checkpoint.tcl
+set ckpt_op [lindex $argv 0]
+set ckpt_file [lindex $argv 1]
+set start_ 0
+if {$ckpt_op == "restore"} {
+	set start_ [tdl-restore-clock $ckpt_file]
+}
+
+# $ns_ at, a restored run gives the commands due before its start at
+# the start, in order: applications start and nodes head for their
+# destinations from the restored positions again
+proc at-run {time cmd} {
+	global ns_ start_
+	if {$time < $start_} {
+		set time $start_
+	}
+	$ns_ at $time $cmd
+}
 #Create file pointer object for write
 set nf1 [open sim2.tr w]
 
@@ -327,24 +348,34 @@ for {set i 0} {$i < $val(nn) } {incr i} {
 
 #}
 
-$ns_ at 1.0 "$tdldata_(0) start"
-$ns_ at 1.0 "$tdldata_(1) start"
-$ns_ at 1.0 "$tdldata_(2) start"
-$ns_ at 16.0 "$tdldata_(3) start"
-$ns_ at 26.0 "$tdldata_(4) start"
-$ns_ at 36.0 "$tdldata_(5) start"
-$ns_ at 46.0 "$tdldata_(6) start"
+set nodes {}
+for {set i 0} {$i < $val(nn) } {incr i} {
+	lappend nodes $node_($i)
+}
+if {$ckpt_op == "restore"} {
+	tdl-restore $ckpt_file $nodes
+} elseif {$ckpt_op == "save"} {
+	$ns_ at [lindex $argv 2] "tdl-checkpoint $ckpt_file {$nodes}"
+}
+
+at-run 1.0 "$tdldata_(0) start"
+at-run 1.0 "$tdldata_(1) start"
+at-run 1.0 "$tdldata_(2) start"
+at-run 16.0 "$tdldata_(3) start"
+at-run 26.0 "$tdldata_(4) start"
+at-run 36.0 "$tdldata_(5) start"
+at-run 46.0 "$tdldata_(6) start"
 #create some movement
-$ns_ at 60.0 "$node_(5) setdest 500200.0 500300.0 550.0"
-$ns_ at 62.0 "$node_(6) setdest 500201.0 500440.0 550.0"
-$ns_ at 65.0 "$node_(3) setdest 500350.0 500500.0 550.0"
-$ns_ at 67.0 "$node_(4) setdest 500500.0 500600.0 550.0"
+at-run 60.0 "$node_(5) setdest 500200.0 500300.0 550.0"
+at-run 62.0 "$node_(6) setdest 500201.0 500440.0 550.0"
+at-run 65.0 "$node_(3) setdest 500350.0 500500.0 550.0"
+at-run 67.0 "$node_(4) setdest 500500.0 500600.0 550.0"
 
 
-$ns_ at 1000.0 "$node_(3) setdest 2000.0 2300.0 550.0"
-$ns_ at 1000.0 "$node_(4) setdest 902001.0 500440.0 550.0"
-$ns_ at 1000.0 "$node_(5) setdest 901635.0 500500.0 550.0"
-$ns_ at 1000.0 "$node_(6) setdest 902550.0 500600.0 550.0"
+at-run 1000.0 "$node_(3) setdest 2000.0 2300.0 550.0"
+at-run 1000.0 "$node_(4) setdest 902001.0 500440.0 550.0"
+at-run 1000.0 "$node_(5) setdest 901635.0 500500.0 550.0"
+at-run 1000.0 "$node_(6) setdest 902550.0 500600.0 550.0"
 
 #$ns_ at 1500.0 "$node_(3) setdest 2000.0 2300.0 550.0"
 #$ns_ at 1500.0 "$node_(4) setdest 902001.0 500440.0 550.0"
@@ -355,22 +386,22 @@ $ns_ at 1000.0 "$node_(6) setdest 902550.0 500600.0 550.0"
 
 
 #change message
-$ns_ at 1640.0 "$tdldata_(5) change-message 2 400"
-$ns_ at 1650.0 "$tdldata_(6) change-message 2 400"
+at-run 1640.0 "$tdldata_(5) change-message 2 400"
+at-run 1650.0 "$tdldata_(6) change-message 2 400"
 
 
-$ns_ at 1846.0 "$tdldata_(5) change-message 2 1000"
-$ns_ at 1853.0 "$tdldata_(6) change-message 2 1000"
+at-run 1846.0 "$tdldata_(5) change-message 2 1000"
+at-run 1853.0 "$tdldata_(6) change-message 2 1000"
 
 
-$ns_ at 2224.0 "$tdldata_(5) change-message 2 1200"
-$ns_ at 2235.0 "$tdldata_(6) change-message 2 1200"
+at-run 2224.0 "$tdldata_(5) change-message 2 1200"
+at-run 2235.0 "$tdldata_(6) change-message 2 1200"
 
-$ns_ at 2644.0 "$tdldata_(5) change-message 2 1500"
-$ns_ at 2665.0 "$tdldata_(6) change-message 2 1500"
+at-run 2644.0 "$tdldata_(5) change-message 2 1500"
+at-run 2665.0 "$tdldata_(6) change-message 2 1500"
 
-$ns_ at 3034.0 "$tdldata_(5) change-message 2 1800"
-$ns_ at 3067.0 "$tdldata_(6) change-message 2 1800"
+at-run 3034.0 "$tdldata_(5) change-message 2 1800"
+at-run 3067.0 "$tdldata_(6) change-message 2 1800"
 
 $ns_ at 4000.5 "puts \"stop...\" ;"
 $ns_ at 4000.5 "stop"
@@ -0,0 +1,76 @@
+#Checkpoint and restore of the Mac/DynamicTdma net state
+#
+#Usage: source tdl_checkpoint.tcl
+#
+# tdl-checkpoint file nodes
+#	saves the simulator clock, the position of the nodes and the net
+#	state of their Mac/DynamicTdma with its pending timers, e.g.
+#	$ns_ at 600.05 "tdl-checkpoint net.ckpt $nodes".
+#	Call it within a slot, not at a slot boundary.
+# tdl-restore-clock file
+#	lets the run start at the checkpoint time, right after new
+#	Simulator and before anything is scheduled. Returns that time,
+#	events of the script are scheduled after it.
+# tdl-restore file nodes
+#	loads the state into the nodes of the run, after they are created
+#	and before $ns_ run.
+#
+# Both runs must create the same nodes in the same order with the same
+# Mac/DynamicTdma max_slot_num_, TdlFrame geometry and packet headers.
+# Movement, packets queued for sending and the applications are not
+# saved, the restored run starts its applications (and measurements)
+# again.
+
+proc tdl-checkpoint {file nodes} {
+	set f [open $file w]
+	close $f
+	foreach node $nodes {
+		[$node set mac_(0)] checkpoint $file
+	}
+	set now [[Simulator instance] now]
+	set f [open $file a]
+	puts $f "time $now"
+	set i 0
+	foreach node $nodes {
+		puts $f "node $i [$node set X_] [$node set Y_] [$node set Z_]"
+		incr i
+	}
+	close $f
+	return $now
+}
+
+proc tdl-restore-clock {file} {
+	set time 0
+	set f [open $file r]
+	while { [gets $f line] >= 0 } {
+		if { [lindex $line 0] == "time" } {
+			set time [lindex $line 1]
+		}
+	}
+	close $f
+	[Simulator instance] clock-set $time
+	return $time
+}
+
+proc tdl-restore {file nodes} {
+	set pos {}
+	set f [open $file r]
+	while { [gets $f line] >= 0 } {
+		if { [lindex $line 0] == "node" } {
+			lappend pos [lrange $line 2 4]
+		}
+	}
+	close $f
+
+	set i 0
+	foreach node $nodes {
+		[$node set mac_(0)] restore $file
+		if { $i < [llength $pos] } {
+			set p [lindex $pos $i]
+			$node set X_ [lindex $p 0]
+			$node set Y_ [lindex $p 1]
+			$node set Z_ [lindex $p 2]
+		}
+		incr i
+	}
+}
@@ -74,6 +74,7 @@ Scheduler/RealTime set maxslop_ 0.010; # max allowed slop b4 error (sec)
 
 Scheduler/Calendar set adjust_new_width_interval_ 10;	# the interval (in unit of resize times) we recalculate bin width. 0 means disable dynamic adjustment
 Scheduler/Calendar set min_bin_width_ 1e-18;		# the lower bound for the bin_width
+Scheduler/Ladder set threshold_ 50;		# buckets with more events are spread over a new rung
 
 #
 # Queues and associated
@@ -767,6 +768,12 @@ Antenna/DirAntenna set Type_ 0
 
 Phy set debug_ false
 
+# Only copy frames to interfaces tuned to the transmit frequency,
+# set to 0 to hand every frame to every interface in range
+Channel/WirelessChannel set freq_partition_ 1
+Channel/WirelessChannel set shared_rx_ 0
+Channel/WirelessChannel set grid_index_ 0
+
 # Initialize the SharedMedia interface with parameters to make
 # it work like the 914MHz Lucent WaveLAN DSSS radio interface
 Phy/WirelessPhy set CPThresh_ 10.0
@@ -797,6 +804,7 @@ Phy/WirelessPhyExt set RXThresh_ 0 ;# not used by WirelessPhyExt, but available
 Phy/WiredPhy set bandwidth_ 10e6
 
 # Shadowing propagation model
+Propagation set cache_size_ 4096
 Propagation/Shadowing set pathlossExp_ 2.0
 Propagation/Shadowing set std_db_ 4.0
 Propagation/Shadowing set dist0_ 1.0
@@ -1481,12 +1489,50 @@ Agent/PBC set modulationScheme 0
 Application/TdlDataApp set pktsize_ 50
 Application/TdlDataApp set msgType_ 3
 Application/TdlDataApp set netID_ 1
+Application/TdlDataApp set log_level_ 0
+Application/TdlDataApp set log_cats_ 63
 
 Agent/UDP/TdlDataUDP set packetSize_ 216
+Agent/UDP/TdlDataUDP set log_level_ 0
+Agent/UDP/TdlDataUDP set log_cats_ 63
+# re-assembly state of a source idle for this long is dropped
+Agent/UDP/TdlDataUDP set asm_timeout_ 30.0
 
 
 Mac/FixTdma set max_slot_num_	200
+Mac/FixTdma set log_level_	0
+Mac/FixTdma set log_cats_	63
 
 Mac/DynamicTdma set max_slot_num_	200
 #Mac/DynamicTdma set control_channel_	300e6
 Mac/DynamicTdma set assigned_Net_	1
+# pack as many queued segments as fit into one data slot
+Mac/DynamicTdma set aggregate_	0
+# let the slot clock skip slots in which a listening node would do nothing
+Mac/DynamicTdma set skip_idle_slots_	0
+# build control frames in packets kept by the MAC, 0 allocates one each
+Mac/DynamicTdma set pool_ctrl_	1
+# skip whole frames while every node of the slot clock is idle, the
+# polling of the skipped frames is not simulated
+Mac/DynamicTdma set fast_forward_	0
+# seeds and net entry draws: substream rng_key_ (-1: node ID - 'A') of the
+# MRG32k3a stream of replication rng_run_, set both before creating a node
+Mac/DynamicTdma set rng_run_	0
+Mac/DynamicTdma set rng_key_	-1
+# TDL debug output, only printed when built with -DTDL_LOGGING
+# level 0 off, 1 err, 2 info, 3 debug; categories see tdl/tdl_log.h
+Mac/DynamicTdma set log_level_	0
+Mac/DynamicTdma set log_cats_	63
+
+# frame geometry of a Mac/DynamicTdma net, see tdl/tdl_frame.h
+TdlFrame set slot_time_		0.050
+TdlFrame set guard_time_	0.002
+TdlFrame set block_len_		20
+TdlFrame set num_vslots_	5
+TdlFrame set poll_size_		3
+TdlFrame set payload_size_	516
+TdlFrame set guarantee_period_	40
+TdlFrame set guarantee_count_	5
+TdlFrame set pos_stride_	16
+
+TdlStats set tcl_compat_	1
@@ -282,6 +282,184 @@ Simulator instproc use-scheduler type {
 	$scheduler_ now
 }
 
+#
+# Record the insert, cancel and deque stream of the scheduler to file,
+# for sims/bench_sched.tcl.  Call it right after new Simulator, a later
+# use-scheduler drops the recording.
+#
+Simulator instproc record-scheduler file {
+	$self instvar scheduler_
+	set rec [new Scheduler/Record]
+	$rec record $scheduler_ $file
+	set scheduler_ $rec
+}
+
+#
+# Start the run at time t instead of 0, e.g. to continue from a
+# checkpoint.  Call it right after new Simulator, before anything is
+# scheduled.
+#
+Simulator instproc clock-set t {
+	$self instvar scheduler_
+	$scheduler_ clock-set $t
+}
+
+#
+# Per handler profile of the dispatched events, see
+# common/scheduler-profile.h.  "$ns profile on" starts it, off stops it
+# and reset clears the counts. profile-report prints them,
+# "profile-dump file" writes them as CSV.
+#
+Simulator instproc profile op {
+	$self instvar scheduler_
+	$scheduler_ profile $op
+}
+
+Simulator instproc profile-report {} {
+	$self instvar scheduler_
+	$scheduler_ profile-report
+}
+
+Simulator instproc profile-dump file {
+	$self instvar scheduler_
+	$scheduler_ profile-dump $file
+}
+
+#
+# Parameter sweep: call "$ns sweep runs ?options?" instead of "$ns run"
+# once the simulation is set up.  It is set up only once, every run is
+# a fork()ed copy of it which
+#	- changes to the directory <dir>/run<i>, i counts from 0,
+#	- sends its stdout to the file stdout there, the channels of
+#	  -outputs to the given files there and every TdlStats metric
+#	  file to a file of the same name there,
+#	- applies the overrides of the run, each {class var value} sets
+#	  the default and the variable of every existing object of class
+#	  and its subclasses, e.g. {Mac bandwidth_ 1e6}, except for
+#	  {rng k} which picks the RNG substream, default i,
+#	- moves every RNG, also those the C++ objects own, to substream k
+#	  and every Mac/DynamicTdma to run rng_run_ + k,
+#	- and does "$ns run".
+# Variables which objects only read when they are created are not
+# changed by an override.  At most -jobs runs (default: the number of
+# cpus) run at once.  Returns the exit codes of the runs, in order.
+#
+#	$ns sweep {{{Mac bandwidth_ 5e4}} {{Mac bandwidth_ 1e6}}} \
+#		-dir bw -outputs [list $tracefd out.tr]
+#
+Simulator instproc sweep {runs args} {
+	$self instvar sweep_code_
+	set jobs [$self ncpus]
+	set dir sweep
+	set outputs {}
+	foreach {opt val} $args {
+		switch -- $opt {
+			-jobs { set jobs $val }
+			-dir { set dir $val }
+			-outputs { set outputs $val }
+			default { error "sweep: unknown option $opt" }
+		}
+	}
+
+	# the children must not write out what is buffered here again
+	foreach ch [file channels] {
+		catch { flush $ch }
+	}
+	if { [info commands TdlStats] != "" } {
+		foreach st [TdlStats info instances] {
+			$st flush
+		}
+	}
+	set i 0
+	set running 0
+	foreach run $runs {
+		if { $running >= $jobs } {
+			$self sweep-wait
+			incr running -1
+		}
+		set rundir [file join $dir run$i]
+		file mkdir $rundir
+		set pid [$self fork]
+		if { $pid == 0 } {
+			$self sweep-child $i $run $rundir $outputs
+		}
+		$self set sweep_pid_($pid) $i
+		incr running
+		incr i
+	}
+	while { $running > 0 } {
+		$self sweep-wait
+		incr running -1
+	}
+
+	set codes {}
+	for {set j 0} {$j < $i} {incr j} {
+		lappend codes $sweep_code_($j)
+	}
+	array unset sweep_code_
+	return $codes
+}
+
+Simulator instproc sweep-wait {} {
+	$self instvar sweep_pid_ sweep_code_
+	set w [$self wait]
+	set i $sweep_pid_([lindex $w 0])
+	unset sweep_pid_([lindex $w 0])
+	set sweep_code_($i) [lindex $w 1]
+	if { [lindex $w 1] != 0 } {
+		puts stderr "sweep: run $i exited with [lindex $w 1]"
+	}
+}
+
+Simulator instproc sweep-child {i run dir outputs} {
+	cd $dir
+	$self redirect stdout stdout
+	foreach {ch file} $outputs {
+		$self redirect $ch $file
+	}
+	if { [info commands TdlStats] != "" } {
+		foreach st [TdlStats info instances] {
+			$st reopen .
+		}
+	}
+	set sub $i
+	foreach o $run {
+		if { [lindex $o 0] == "rng" } {
+			set sub [lindex $o 1]
+		} else {
+			$self sweep-set [lindex $o 0] [lindex $o 1] [lindex $o 2]
+		}
+	}
+	global defaultRNG
+	$defaultRNG next-substream-all $sub
+	if { [info commands Mac/DynamicTdma] != "" } {
+		foreach mac [$self sweep-instances Mac/DynamicTdma] {
+			$mac rng-run [expr [$mac set rng_run_] + $sub]
+		}
+	}
+	if { [catch { $self run } err] } {
+		puts stderr "sweep: run $i: $err"
+		exit 1
+	}
+	exit 0
+}
+
+Simulator instproc sweep-set {cls var val} {
+	$cls set $var $val
+	foreach obj [$self sweep-instances $cls] {
+		$obj set $var $val
+	}
+}
+
+# the objects of cls and of its subclasses
+Simulator instproc sweep-instances cls {
+	set objs [$cls info instances]
+	foreach sub [$cls info subclass] {
+		eval lappend objs [$self sweep-instances $sub]
+	}
+	return $objs
+}
+
 Simulator instproc delay_parse { spec } {
 	return [time_parse $spec]
 }
@@ -70,6 +70,9 @@
 #
 
 PacketHeaderManager set hdrlen_ 0
+# packet allocation counts, read only
+PacketHeaderManager set num_alloc_ 0
+PacketHeaderManager set num_new_ 0
 
 # XXX Common header should ALWAYS be present
 PacketHeaderManager set tab_(Common) 1
@@ -179,7 +182,6 @@ foreach prot {
 	NetEntryMsg  	# TDL NET Entryh
 	ControlMsg
 	PollingMsg 	# TDL polling Message
-	HdrNbInfo	# Neighbor Info header
 	TdlMsgUpdate 
 	TdlNetUpdate
 } {
@@ -257,6 +257,66 @@ Test/drr instproc run {} {
 	$self runDetailed
 }
 
+#
+# The tests above again with Scheduler/Ladder instead of the default
+# Scheduler/Calendar.  Both dequeue events with the same time in the
+# order they were inserted in, so the traces must be the same, and the
+# reference output of <test>-ladder is that of <test>.
+#
+Class Test/fifo-droptail-ladder -superclass Test/fifo-droptail
+Test/fifo-droptail-ladder instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ use-scheduler Ladder
+}
+
+Class Test/fifo-red-ladder -superclass Test/fifo-red
+Test/fifo-red-ladder instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ use-scheduler Ladder
+}
+
+Class Test/sfq-ladder -superclass Test/sfq
+Test/sfq-ladder instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ use-scheduler Ladder
+}
+
+Class Test/fq-ladder -superclass Test/fq
+Test/fq-ladder instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ use-scheduler Ladder
+}
+
+Class Test/fq_small_queue-ladder -superclass Test/fq_small_queue
+Test/fq_small_queue-ladder instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ use-scheduler Ladder
+}
+
+Class Test/drr-ladder -superclass Test/drr
+Test/drr-ladder instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ use-scheduler Ladder
+}
+
+#
+# drr with the dispatched events profiled and the profile reset by an
+# event, which must neither crash nor change the trace.
+#
+Class Test/drr-profile -superclass Test/drr
+Test/drr-profile instproc init {} {
+        $self instvar ns_
+        $self next
+        $ns_ profile on
+        $ns_ at 5.0 "$ns_ profile reset"
+}
+
 
 TestSuite runTest
 
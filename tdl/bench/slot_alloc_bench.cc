@@ -0,0 +1,262 @@
+/*
+slot_alloc_bench.cc
+Note: micro-benchmark for TdmaSlotAllocator
+Usage: compares the full frame rebuild done by Mac/DynamicTdma before
+       TdmaSlotAllocator with the incremental allocator, and checks that
+       both give the same schedule after every frame.
+
+       slot_alloc_bench [frames] [seed]
+*/
+
+#include "tdl_slot_alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#define NUM_SLOTS	200
+#define SLOT_TIME	0.050
+
+/* ======================================================================
+   Reference allocator, the algorithm of MacDynamicTdma::allocateDataSlots
+   before TdmaSlotAllocator: wipe the frame, bubble sort, place everybody.
+   ====================================================================== */
+static int ref_schedule[NUM_SLOTS];
+
+static void refBubbleSort(int *arr1, int *arr2, int len)
+{
+	int i, j, flag = 1;
+	int temp1, temp2;
+
+	for(i = 1; (i <= len) && flag; i++) {
+		flag = 0;
+		for (j=0; j < (len -1); j++) {
+			if (arr1[j+1] < arr1[j] || (arr1[j+1]==arr1[j] && arr2[j+1]<arr2[j])) {
+				temp1 = arr1[j];
+				temp2 = arr2[j];
+				arr1[j] = arr1[j+1];
+				arr2[j] = arr2[j+1];
+				arr1[j+1] = temp1;
+				arr2[j+1] = temp2;
+				flag = 1;
+			}
+		}
+	}
+}
+
+static int refAssignSlots(int id, int msg_t, int rate)
+{
+	int slotPeriod = 0;
+	int max_msg_size = 0;
+	switch(msg_t) {
+		case 1:
+			slotPeriod = (int) (rate/SLOT_TIME);
+			max_msg_size = 10005;
+			break;
+		case 2:
+			slotPeriod = (int) (rate/SLOT_TIME);
+			max_msg_size = 2005;
+			break;
+		case 3:
+			slotPeriod = (int) (rate/SLOT_TIME);
+			max_msg_size = 55;
+			break;
+		default:
+			return 1;
+	}
+	int slotPayloadSize = 516;
+	int slotsReq = (int) ceil((double) (max_msg_size/slotPayloadSize)+0.5);
+	if(slotsReq<1)
+		slotsReq=1;
+	int periodCount = (int) (NUM_SLOTS/slotPeriod);
+	int blockCount = (int) (slotPeriod/20);
+
+	int is_assigned_in_frame = 0;
+	int g_idx = id-NODE_ID_BASE;
+	int g_pos = (g_idx % DATA_SLOTS_PER_BLOCK)+1;
+	for(int g = 0;g<=160;g=g+40) {
+		if(g_idx < DATA_SLOTS_PER_BLOCK || ref_schedule[g_pos+g]==-1)
+			ref_schedule[g_pos+g] = id;
+	}
+	for(int i = 0;i<periodCount;i++) {
+		int current_block = 0;
+		int slotPointer = 1;
+		int slotsAssigned = 0;
+		int is_period_full = 0;
+		for(int n = 0;n<slotPeriod;n++) {
+			if(ref_schedule[i*slotPeriod+n]==id)
+				slotsAssigned++;
+		}
+		int f_pos = (id-NODE_ID_BASE) % 16;
+		slotPointer = f_pos;
+		while(slotsAssigned<slotsReq && !is_period_full) {
+			if(ref_schedule[i*slotPeriod+20*current_block+slotPointer+1]>0) {
+				int cnt_blk = 0;
+				for(int l=1;l<20;l++) {
+					if(ref_schedule[i*slotPeriod+20*current_block+l]==-1)
+						cnt_blk++;
+				}
+				if(cnt_blk==0) {
+					if(current_block<blockCount-1)
+						current_block++;
+					else
+						current_block = 0;
+					slotPointer = f_pos;
+				} else {
+					slotPointer = (slotPointer+16) % 19;
+				}
+			} else {
+				ref_schedule[i*slotPeriod+20*current_block+slotPointer+1] = id;
+				slotsAssigned++;
+				is_assigned_in_frame = 1;
+				if(current_block<blockCount-1)
+					current_block++;
+				else
+					current_block = 0;
+				slotPointer = f_pos;
+			}
+
+			int cnt = 0;
+			for(int n = 0;n<slotPeriod;n++) {
+				if(ref_schedule[i*slotPeriod+n]==-1)
+					cnt++;
+			}
+			if(cnt==0)
+				is_period_full = 1;
+		}
+	}
+	return is_assigned_in_frame;
+}
+
+static int refAllocate(tdma_member *m, int cnt)
+{
+	int *members = new int[cnt];
+	int *memberMsgT = new int[cnt];
+	for(int i = 0;i<cnt;i++) {
+		members[i] = m[i].id;
+		memberMsgT[i] = m[i].msg_t;
+	}
+	refBubbleSort(memberMsgT, members, cnt);
+
+	for(int i = 0;i<NUM_SLOTS;i++) {
+		if(i % 20 != 0)
+			ref_schedule[i] = -1;
+	}
+	int num_alloc = 0;
+	for(int i = 0;i<cnt;i++) {
+		int rate = (memberMsgT[i] == 1) ? 10 : (memberMsgT[i] == 0 ? 0 : 2);
+		num_alloc += refAssignSlots(members[i], memberMsgT[i], rate);
+	}
+	delete [] members;
+	delete [] memberMsgT;
+	return num_alloc;
+}
+
+/* ======================================================================
+   Workload: a net of cnt members, every frame one member may change its
+   message type, join or leave. Members are listed in discovery order like
+   the neighbor table of the MAC.
+   ====================================================================== */
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static int randomType()
+{
+	// mostly position reports, some tracks, few RAP
+	int r = rand() % 10;
+	if(r < 6)
+		return 3;
+	if(r < 9)
+		return 2;
+	return 1;
+}
+
+static int run(int cnt, int frames)
+{
+	tdma_member *net = new tdma_member[cnt];
+	int *active = new int[cnt];
+	tdma_member *list = new tdma_member[cnt];
+	int schedule[NUM_SLOTS];
+
+	for(int i = 0;i<cnt;i++) {
+		net[i].id = NODE_ID_BASE + i;
+		net[i].msg_t = randomType();
+		active[i] = 1;
+	}
+	for(int i = 0;i<NUM_SLOTS;i++) {
+		schedule[i] = (i % 20 == 0) ? -2 : -1;
+		ref_schedule[i] = schedule[i];
+	}
+
+	tdma_frame frame;
+	tdmaDefaultFrame(&frame);
+	TdmaSlotAllocator alloc;
+	alloc.init(schedule, NUM_SLOTS, frame);
+
+	double t_ref = 0, t_inc = 0;
+	long replaced = 0;
+	int mismatch = 0;
+	for(int f = 0;f<frames;f++) {
+		// churn: about one change every fourth frame
+		if(rand() % 4 == 0) {
+			int m = rand() % cnt;
+			if(rand() % 3 == 0)
+				active[m] = !active[m];
+			else
+				net[m].msg_t = randomType();
+		}
+		int n = 0;
+		for(int i = 0;i<cnt;i++) {
+			if(active[i])
+				list[n++] = net[i];
+		}
+
+		double t0 = now();
+		int a1 = refAllocate(list, n);
+		double t1 = now();
+		// the allocator sorts in place, hand it the discovery order again
+		n = 0;
+		for(int i = 0;i<cnt;i++) {
+			if(active[i])
+				list[n++] = net[i];
+		}
+		double t2 = now();
+		int a2 = alloc.update(list, n);
+		double t3 = now();
+
+		t_ref += t1 - t0;
+		t_inc += t3 - t2;
+		replaced += alloc.replaced();
+		if(a1 != a2 || memcmp(schedule, ref_schedule, sizeof(schedule)) != 0)
+			mismatch++;
+	}
+
+	printf("%8d %8d %14.1f %14.1f %8.1fx %10.2f %9d\n", cnt, frames,
+	       t_ref / frames * 1e9, t_inc / frames * 1e9,
+	       t_inc > 0 ? t_ref / t_inc : 0.0,
+	       (double) replaced / frames, mismatch);
+
+	delete [] net;
+	delete [] active;
+	delete [] list;
+	return mismatch;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = (argc > 1) ? atoi(argv[1]) : 2000;
+	int seed = (argc > 2) ? atoi(argv[2]) : 1;
+	srand(seed);
+
+	printf("# members   frames   full(ns/frm)    inc(ns/frm)  speedup   replaced  mismatch\n");
+	int sizes[] = { 16, 64, 256 };
+	int failed = 0;
+	for(int i = 0;i<3;i++)
+		failed += run(sizes[i], frames);
+	return failed ? 1 : 0;
+}
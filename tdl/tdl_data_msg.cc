@@ -4,6 +4,7 @@ Note: constructure and function definition for tdl_data_msg class
 Usage: generator of TDL messages
 */
 #include "tdl_data_msg.h"
+#include "tdl_stats.h"
 #include <string.h>
 #include "tclcl.h"
 #include <stddef.h>
@@ -37,6 +38,8 @@ TdlDataApp::TdlDataApp() : running_(0), snd_timer_(this)
   bind("pktsize_", &pktsize_);
   bind("msgType_", &msgType_);
   bind("netID_", &netID_);
+  bind("log_level_", &log_.level_);
+  bind("log_cats_", &log_.cats_);
 
 }
 
@@ -45,6 +48,9 @@ int TdlDataApp::command(int argc, const char*const* argv)
 {
   Tcl& tcl = Tcl::instance();
 
+  if (argc >= 3 && strcmp(argv[1], "log") == 0)
+    return log_.command(argc, argv);
+
   if (argc == 3) {
     if (strcmp(argv[1], "attach-agent") == 0) {
         agent_ = (Agent*) TclObject::lookup(argv[2]);
@@ -161,7 +167,7 @@ void TdlDataApp::send_msgupdate_msg()
         tdlh.newtype = MSG_0;
 
     tdlh.newbytes = pktsize_;
-    printf("#### A node with app ID %i change message to type %i and size %i\n",appIdx_,msgType_,pktsize_);
+    TDL_LOG(log_, TDL_LOG_APP, TDL_LOG_INFO, "#### A node with app ID %i change message to type %i and size %i\n",appIdx_,msgType_,pktsize_);
     agent_->sendcontrol(1,TDL_UPDATE_MSG_LEN,(char*) &tdlh); //call send control message function in transport class
     start();                        // resume transmission
 
@@ -176,7 +182,7 @@ void TdlDataApp::send_netupdate_msg()
 
     tdlh.type = MSG_5;
     tdlh.newnet = netID_;
-    printf("#### A node with app ID %i change net to %i\n",appIdx_,netID_);
+    TDL_LOG(log_, TDL_LOG_APP, TDL_LOG_INFO, "#### A node with app ID %i change net to %i\n",appIdx_,netID_);
     agent_->sendcontrol(2,TDL_UPDATE_NET_LEN,(char*) &tdlh);
     start();
 
@@ -190,7 +196,7 @@ void TdlDataApp::recv_msg(int nbytes, const char *msg)
   // print out received message information
   if(msg) {
     hdr_tdldata* tdlh = (hdr_tdldata*) msg;
-      printf("A node with app ID %i receive tdl message size %i from node with app ID %i at time %f\n", appIdx_, tdlh->messagesize,tdlh->appID,s.clock());
+      TDL_LOG(log_, TDL_LOG_APP, TDL_LOG_DEBUG, "A node with app ID %i receive tdl message size %i from node with app ID %i at time %f\n", appIdx_, tdlh->messagesize,tdlh->appID,s.clock());
       account_recv_pkt_info(tdlh);  // record received message
 
     }
@@ -216,20 +222,11 @@ void TdlDataApp::account_recv_pkt_info(const hdr_tdldata *tdlh)
 
     // record to trace files
 	if((MsgType)tdlh->type == MSG_1) {
-        char out[100];
-        sprintf(out, "recordRAP %i %f %i %i %i", appIdx_,Scheduler::instance().clock(),tdlh->appID,tdlh->seq,tdlh->nbytes);
-        Tcl& tcl = Tcl::instance();
-        tcl.eval(out);
+        TdlStats::record(TDL_RAP, "%i %f %i %i %i", appIdx_,Scheduler::instance().clock(),tdlh->appID,tdlh->seq,tdlh->nbytes);
 	} else if((MsgType)tdlh->type == MSG_2) {
-        char out[100];
-        sprintf(out, "recordRadarTrack %i %f %i %i %i", appIdx_,Scheduler::instance().clock(),tdlh->appID,tdlh->seq,tdlh->nbytes);
-        Tcl& tcl = Tcl::instance();
-        tcl.eval(out);
+        TdlStats::record(TDL_RADAR_TRACK, "%i %f %i %i %i", appIdx_,Scheduler::instance().clock(),tdlh->appID,tdlh->seq,tdlh->nbytes);
 	} else if((MsgType)tdlh->type == MSG_3) {
-        char out[100];
-        sprintf(out, "recordPosReport %i %f %i %i %i", appIdx_,Scheduler::instance().clock(),tdlh->appID,tdlh->seq,tdlh->nbytes);
-        Tcl& tcl = Tcl::instance();
-        tcl.eval(out);
+        TdlStats::record(TDL_POS_REPORT, "%i %f %i %i %i", appIdx_,Scheduler::instance().clock(),tdlh->appID,tdlh->seq,tdlh->nbytes);
 	}
 }
 
@@ -53,6 +53,7 @@ class TdlDataApp : public Application {
  	int msgType_;           // TDL message type
  	int pktsize_;           // message size
  	int netID_;             // net ID
+ 	TdlLog log_;            // debug output of this app
 	int seq_;	            // message sequence number
 	int running_;           // If 1 application is running
 	recv_pkt_info recv_p_info;
@@ -54,10 +54,11 @@ public:
 TdlDataUdpAgent::TdlDataUdpAgent() : Agent(PT_TDLDATA)
 {
 	bind("packetSize_", &size_);
+	bind("log_level_", &log_.level_);
+	bind("log_cats_", &log_.cats_);
+	bind("asm_timeout_", &asm_timeout_);
 	support_tdldata_ = 0;
-	for(int i=0;i<16;i++) {
-        asm_info[i].seq = -1;
-	}
+	init();
 	seqno_ = -1;
     ctrlMsgCnt_ = 0;
 }
@@ -65,14 +66,45 @@ TdlDataUdpAgent::TdlDataUdpAgent() : Agent(PT_TDLDATA)
 TdlDataUdpAgent::TdlDataUdpAgent(packet_t type) : Agent(type)
 {
 	bind("packetSize_", &size_);
+	bind("log_level_", &log_.level_);
+	bind("log_cats_", &log_.cats_);
+	bind("asm_timeout_", &asm_timeout_);
 	support_tdldata_ = 0;
-	for(int i=0;i<16;i++) {
-        asm_info[i].seq = -1;
-	}
+	init();
 	seqno_ = -1;
 	ctrlMsgCnt_ = 0;
 }
 
+TdlDataUdpAgent::~TdlDataUdpAgent()
+{
+	for(int b = 0;b<asm_buckets_;b++) {
+		while(asm_tab_[b]) {
+			asm_tdldata *a = asm_tab_[b];
+			asm_tab_[b] = a->next;
+			delete a;
+		}
+	}
+	delete [] asm_tab_;
+}
+
+void TdlDataUdpAgent::init()
+{
+	asm_buckets_ = ASM_INIT_BUCKETS;
+	asm_tab_ = new asm_tdldata*[asm_buckets_];
+	for(int i=0;i<asm_buckets_;i++)
+		asm_tab_[i] = 0;
+	asm_num_ = 0;
+	asm_sweep_ = 0;
+}
+
+// OTcl command interpreter
+int TdlDataUdpAgent::command(int argc, const char*const* argv)
+{
+	if (argc >= 3 && strcmp(argv[1], "log") == 0)
+		return log_.command(argc, argv);
+	return Agent::command(argc, argv);
+}
+
 // Add Support of TDL data Application to UdpAgent::sendmsg
 void TdlDataUdpAgent::sendmsg(int nbytes, const char* flags)
 {
@@ -91,7 +123,6 @@ void TdlDataUdpAgent::sendmsg(int nbytes, const char* flags)
 		printf("Error:  sendmsg() for UDP should not be -1\n");
 		return;
 	}
-	double local_time =Scheduler::instance().clock();
 	while (n-- > 0) {
 		p = allocpkt();
 		hdr_tdldata* tdlh = hdr_tdldata::access(p);
@@ -206,18 +237,22 @@ void TdlDataUdpAgent::recv(Packet* p, Handler*)
 			// re-assemble tdl Application packet if segmented
 
 			hdr_tdldata* tdlh = hdr_tdldata::access(p);
-			//printf("UDP receive packet %d with data part size %i and total msg size is %i from node with app ID %i\n",hdr_cmn::access(p)->uid(),tdlh->datasize,tdlh->messagesize,tdlh->appID);
-			u_int8_t aIdx = tdlh->appID;
-			if(tdlh->seq == asm_info[aIdx].seq)
-				asm_info[aIdx].rbytes += tdlh->datasize;
+			TDL_LOG(log_, TDL_LOG_APP, TDL_LOG_DEBUG, "UDP receive packet %d with data part size %i and total msg size is %i from node with app ID %i\n",hdr_cmn::access(p)->uid(),tdlh->datasize,tdlh->messagesize,tdlh->appID);
+			double now = Scheduler::instance().clock();
+			if(now >= asm_sweep_)
+				asmEvict(now);
+			asm_tdldata *a = asmLookup(tdlh->appID);
+			a->last = now;
+			if(tdlh->seq == a->seq)
+				a->rbytes += tdlh->datasize;
 			else {
-				asm_info[aIdx].seq = tdlh->seq;
-				asm_info[aIdx].tbytes = tdlh->messagesize;
-				asm_info[aIdx].rbytes = bytes_to_deliver;
+				a->seq = tdlh->seq;
+				a->tbytes = tdlh->messagesize;
+				a->rbytes = bytes_to_deliver;
 			}
 			// if fully reassembled, pass the packet to application
-			if(asm_info[aIdx].tbytes <= asm_info[aIdx].rbytes) {
-				//printf("receive message type %d\n",tdlh->type);
+			if(a->tbytes <= a->rbytes) {
+				TDL_LOG(log_, TDL_LOG_APP, TDL_LOG_DEBUG, "receive message type %d\n",tdlh->type);
 				hdr_tdldata tdlh_buf;
 
 				memcpy(&tdlh_buf, tdlh, sizeof(hdr_tdldata));
@@ -233,3 +268,66 @@ void TdlDataUdpAgent::recv(Packet* p, Handler*)
 	}
 }
 
+// Re-assembly state of the messages of app appID, created if unknown
+asm_tdldata* TdlDataUdpAgent::asmLookup(u_int8_t appID)
+{
+	int b = appID % asm_buckets_;
+	for(asm_tdldata *a = asm_tab_[b];a;a = a->next) {
+		if(a->appID == appID)
+			return a;
+	}
+	if(asm_num_ >= 2*asm_buckets_) {
+		asmGrow();
+		b = appID % asm_buckets_;
+	}
+	asm_tdldata *a = new asm_tdldata;
+	a->appID = appID;
+	a->seq = -1;
+	a->rbytes = 0;
+	a->tbytes = 0;
+	a->next = asm_tab_[b];
+	asm_tab_[b] = a;
+	asm_num_++;
+	return a;
+}
+
+// Drop the state of apps idle for asm_timeout_, at most once per asm_timeout_
+void TdlDataUdpAgent::asmEvict(double now)
+{
+	asm_sweep_ = now + asm_timeout_;
+	if(asm_timeout_ <= 0)
+		return;
+	for(int b = 0;b<asm_buckets_;b++) {
+		asm_tdldata **pa = &asm_tab_[b];
+		while(*pa) {
+			asm_tdldata *a = *pa;
+			if(now - a->last >= asm_timeout_) {
+				*pa = a->next;
+				delete a;
+				asm_num_--;
+			} else
+				pa = &a->next;
+		}
+	}
+}
+
+void TdlDataUdpAgent::asmGrow()
+{
+	int buckets = 2*asm_buckets_;
+	asm_tdldata **tab = new asm_tdldata*[buckets];
+	for(int b = 0;b<buckets;b++)
+		tab[b] = 0;
+	for(int b = 0;b<asm_buckets_;b++) {
+		asm_tdldata *a = asm_tab_[b];
+		while(a) {
+			asm_tdldata *next = a->next;
+			int nb = a->appID % buckets;
+			a->next = tab[nb];
+			tab[nb] = a;
+			a = next;
+		}
+	}
+	delete [] asm_tab_;
+	asm_tab_ = tab;
+	asm_buckets_ = buckets;
+}
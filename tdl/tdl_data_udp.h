@@ -9,6 +9,9 @@ Usage: transport agent for TDL application
 #include "agent.h"
 #include "trafgen.h"
 #include "packet.h"
+#include "ns-process.h"
+#include "tdl_log.h"
+#include <string.h>
 
 
 enum MsgType {
@@ -71,31 +74,50 @@ struct hdr_tdlnetupdate {
 #define TDL_UPDATE_MSG_LEN 5    // TDL message update header length
 #define TDL_UPDATE_NET_LEN 2    // TDL net update header length
 #define TDL_UDP_HDR_LEN 13      // UDP header is 13 bytes
+
 // Used for Re-assemble segmented (by UDP) tdl packet
 struct asm_tdldata {
     u_int8_t appID;
 	int seq;     // tdl message sequence number
 	int rbytes;  // currently received bytes
 	int tbytes;  // total bytes to receive for tdl packet
+	double last; // time the last segment was received
+	asm_tdldata *next;
 };
 
+// Initial number of buckets of the re-assembly table
+#define ASM_INIT_BUCKETS 16
+
 // TdlDataUdpAgent Class definition
 class TdlDataUdpAgent : public Agent {
 public:
 	TdlDataUdpAgent();
 	TdlDataUdpAgent(packet_t);
+	~TdlDataUdpAgent();
 	virtual int supportTdlData() { return 1; }
 	virtual void enableTdlData() { support_tdldata_ = 1; }
 	virtual void sendmsg(int nbytes, const char *flags = 0);
 	virtual void sendcontrol(int ctype, int nbytes, const char *flags = 0);
 	void recv(Packet*, Handler*);
 protected:
+	int command(int argc, const char*const* argv);
 	int support_tdldata_; // set to 1 if above is TdlDataApp
 	int seqno_;
 	int ctrlMsgCnt_;
 	u_int8_t agent_ID_;
+	TdlLog log_;          // debug output of this agent
+	double asm_timeout_;  // drop re-assembly state idle for this long
 private:
-	asm_tdldata asm_info[16]; // packet re-assembly information
+	void init();
+	asm_tdldata* asmLookup(u_int8_t appID);
+	void asmEvict(double now);
+	void asmGrow();
+
+	// packet re-assembly information, hashed by source app ID
+	asm_tdldata **asm_tab_;
+	int asm_buckets_;
+	int asm_num_;
+	double asm_sweep_;    // time of the next eviction sweep
 };
 
 #endif
@@ -170,8 +170,6 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
 	node_ID_ = nodeID++;
 	node_seed_ = assignSeed();
 
-	printf("MAC created for node %i with seed %i\n",node_ID_,node_seed_);
-
 	// Setup the phy specs.
 	phymib_ = p;
 
@@ -180,6 +178,10 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
 	bind("max_slot_num_", &max_slot_num_);
 	bind("control_channel_", &control_channel_);
 	bind("assigned_Net_",&assigned_Net_);
+	bind("log_level_",&log_.level_);
+	bind("log_cats_",&log_.cats_);
+
+	TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_INFO, "MAC created for node %i with seed %i\n",node_ID_,node_seed_);
 
 
 
@@ -285,11 +287,13 @@ u_int8_t MacDynamicTdma::assignSeed()
     // Assign seed
 	u_int8_t val = (rand() % 256);
 	//unsigned char* vall = ((unsigned char*) val) & 0xFF;
-	printf("New Seed for Node %i: init seed is %i and random seed is %i\n",node_ID_,INIT_SEED,val);
+	TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_INFO, "New Seed for Node %i: init seed is %i and random seed is %i\n",node_ID_,INIT_SEED,val);
 	return (INIT_SEED + val);
 }
 int MacDynamicTdma::command(int argc, const char*const* argv)
 {
+	if (argc >= 3 && strcmp(argv[1], "log") == 0)
+		return log_.command(argc, argv);
 	if (argc == 3) {
 		if (strcmp(argv[1], "log-target") == 0) {
 			logtarget_ = (NsObject*) TclObject::lookup(argv[2]);
@@ -366,14 +370,14 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
 		// we just discard the packet.
         //printf("MAC %i in node %i receive incoming packet %i\n",index_,node_ID_,ch->uid());
 		if (!radio_active_) {
-		    printf("node %i receive incoming packet with radio off. Discard packet\n",node_ID_);
+		    TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_DEBUG, "node %i receive incoming packet with radio off. Discard packet\n",node_ID_);
 			free(p);
 			//printf("<%d>, %f, I am sleeping...\n", index_, NOW);
 			return;
 		}
 		if (ch->ptype() == PT_TDLNETCTRL) {
 		   struct net_control_info *nc = net_control_info::access(p);
-		   printf("node %i receive net control message with netID %i\n",node_ID_,nc->net_ID);
+		   TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "node %i receive net control message with netID %i\n",node_ID_,nc->net_ID);
            updateNetTable(p);
            updateNetNeighborTable(p,nc->net_ID);
            // check if a node should update neighbor table in current net or switch net.
@@ -392,13 +396,13 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
 		    struct net_entry_msg *ne = net_entry_msg::access(p);
 		    struct hdr_mac_dynamic_tdma *mh = HDR_MAC_DYNAMIC_TDMA(p);
 		    if(ne->entry_msg == 1) {
-                printf("$$$$ Node %i receive net entry request from %i\n",node_ID_,mh->srcID);
+                TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "$$$$ Node %i receive net entry request from %i\n",node_ID_,mh->srcID);
 
                 // Add ne to queue, and wait for next available control slot to create and send ACK and also update neighbor
                 nePkt_ = p;
 		    } else {
 		        if(ne->entry_ID==node_ID_) {
-                    printf("$$$$**** Node %i receive net entry ACK from %i at time %f\n",node_ID_,mh->srcID,Scheduler::instance().clock());
+                    TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "$$$$**** Node %i receive net entry ACK from %i at time %f\n",node_ID_,mh->srcID,Scheduler::instance().clock());
                     is_net_entry = 0;
                     is_ack_waiting = 0;
                     is_in_net = 1;
@@ -443,7 +447,7 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
                 //update neighbor
                 updateNeighborTable(p);
                 sendUp(p);
-                printf("Node %i receive TDL data packet %i\n", node_ID_, hdr_cmn::access(p)->uid());
+                TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_DEBUG, "Node %i receive TDL data packet %i\n", node_ID_, hdr_cmn::access(p)->uid());
                 return;
             } else {
                 // if a node dose not operate in the net, discard packet
@@ -468,14 +472,14 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
     //That is datalink radio is turned on first but neither tx or rx
     //until the tdl application starts, then it can tx or rx in the slot
 
-    printf("MAC in %i receive packet %i size %d from Upper Layer at time %f\n",node_ID_,ch->uid(),ch->size(),Scheduler::instance().clock());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_DEBUG, "MAC in %i receive packet %i size %d from Upper Layer at time %f\n",node_ID_,ch->uid(),ch->size(),Scheduler::instance().clock());
     if(!is_app_start)
         is_app_start = 1;
     // Check if control message needed to be sent when
     if((MsgType) tdlh->type != node_msg_type_) {
         if(is_in_net) {
             // control message is required to be sent before sending any data
-            printf("****** require control message\n");
+            TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "****** require control message\n");
             is_control_msg_required = 1;
         }
     }
@@ -499,7 +503,7 @@ void MacDynamicTdma::sendUp(Packet* p)
 
 	/* Can't receive while transmitting. Should not happen...?*/
 	if (tx_state_ && ch->error() == 0) {
-		printf("<%d>, can't receive while transmitting!\n", index_);
+		TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_ERR, "<%d>, can't receive while transmitting!\n", index_);
 		ch->error() = 1;
 	};
 
@@ -523,7 +527,7 @@ void MacDynamicTdma::sendUp(Packet* p)
 		*/
 		Phy *ph;
 		ph = netif_;
-		printf("Node %i, receiving packet %i, but the channel in %f in slot %i is not idle....???\n", node_ID_,ch->uid(),((WirelessPhy *)ph)->getFreq(), slot_count_);
+		TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_ERR, "Node %i, receiving packet %i, but the channel in %f in slot %i is not idle....???\n", node_ID_,ch->uid(),((WirelessPhy *)ph)->getFreq(), slot_count_);
 	}
 }
 
@@ -568,7 +572,7 @@ void MacDynamicTdma::sendDown(Packet* p) {
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    printf("Node %i add header src seed %i\n", node_ID_,mh->srcSeed);
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_DEBUG, "Node %i add header src seed %i\n", node_ID_,mh->srcSeed);
     nb->nrNB = 0;
     for(int i=0;i<MAX_NODE_NUM-1;i++) {
         if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
@@ -606,7 +610,7 @@ void MacDynamicTdma::send()
 
 	/* Check if there is any packet buffered. */
 	if (!pktTx_) {
-		printf("<%d>, %f, no packet buffered.\n", index_, NOW);
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_ERR, "<%d>, %f, no packet buffered.\n", index_, NOW);
 		return;
 	}
 
@@ -615,7 +619,7 @@ void MacDynamicTdma::send()
 		/* Note: we don't take the channel status into account, ie. no collision,
 		   as collision should not happen...
 		*/
-		printf("<%d>, %f, transmitting, but the channel is not idle...???\n", index_, NOW);
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_ERR, "<%d>, %f, transmitting, but the channel is not idle...???\n", index_, NOW);
 		return;
 	}
 
@@ -637,7 +641,7 @@ void MacDynamicTdma::send()
 	/* Start a timer that expires when the packet transmission is complete. */
     Phy *ph;
     ph = netif_;
-	printf("Node %i send packet %i size %d bytes in slot %d with freqency %f at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,((WirelessPhy *)ph)->getFreq(),Scheduler::instance().clock());
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_DEBUG, "Node %i send packet %i size %d bytes in slot %d with freqency %f at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,((WirelessPhy *)ph)->getFreq(),Scheduler::instance().clock());
 	mhTxPkt_.start(pktTx_->copy(), stime);
 	downtarget_->recv(pktTx_, this);
     is_seed_sent = 1;
@@ -694,7 +698,7 @@ void MacDynamicTdma::switchToNetChannel() {
 }
 
 void MacDynamicTdma::listenForNC() {
-    printf("Node %i Listen for NC\n", node_ID_);
+    TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i Listen for NC\n", node_ID_);
 	radioSwitch(ON);	//Turn on radio
 	return;
 }
@@ -704,7 +708,7 @@ void MacDynamicTdma::accessNCToTxRx() {
     findHashAndSort(slot_count_,3);
     char winning_node_ = findWinningNode(0);
     nc_winner[nc_slot_count] = winning_node_;
-    printf("#######Winner is %i in net %i at time %f\n",winning_node_,net_ID_,Scheduler::instance().clock());
+    TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "#######Winner is %i in net %i at time %f\n",winning_node_,net_ID_,Scheduler::instance().clock());
     if(winning_node_==node_ID_)
         sendNetControl();
     else
@@ -769,7 +773,7 @@ void MacDynamicTdma::sendNetControl() {
 	/* Turn on the radio and transmit! */
 	SET_TX_STATE(MAC_SEND);
 	radioSwitch(ON);
-    printf("Node %i send net control packet(%i) %i with size %i bytes for net %i with vslot %i at time %f\n",node_ID_,ch->ptype(),ch->uid(),ch->size(),net_control_info::access(p)->net_ID,net_control_info::access(p)->vslot_seed[0],ch->timestamp());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send net control packet(%i) %i with size %i bytes for net %i with vslot %i at time %f\n",node_ID_,ch->ptype(),ch->uid(),ch->size(),net_control_info::access(p)->net_ID,net_control_info::access(p)->vslot_seed[0],ch->timestamp());
 
 
 	/* Start a timer that expires when the packet transmission is complete. */
@@ -831,7 +835,7 @@ void MacDynamicTdma::sendNetEntry() {
 	/* Turn on the radio and transmit! */
 	SET_TX_STATE(MAC_SEND);
 	radioSwitch(ON);
-    printf("***Node %i send net entry packet(%i) %i with size %i bytes in slot %i at time %f\n",node_ID_,ch->ptype(),ch->uid(),ch->size(),slot_count_,ch->timestamp());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "***Node %i send net entry packet(%i) %i with size %i bytes in slot %i at time %f\n",node_ID_,ch->ptype(),ch->uid(),ch->size(),slot_count_,ch->timestamp());
 
 
 	/* Start a timer that expires when the packet transmission is complete. */
@@ -897,8 +901,8 @@ void MacDynamicTdma::sendNetEntryACK() {
 
 
 
-	printf("***Node %i include %i neighbors in ACK message",node_ID_,nb->nrNB);
-    printf("Node %i send net entry ACK packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "***Node %i include %i neighbors in ACK message",node_ID_,nb->nrNB);
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send net entry ACK packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
     mhTxPkt_.start(p->copy(), stime);
@@ -961,7 +965,7 @@ void MacDynamicTdma::sendControl() {
 
 
 	//printf("***Node %i include %i neighbors in ACK message",node_ID_,mh->nrNB);
-    printf("Node %i send update control packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send update control packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
     mhTxPkt_.start(p->copy(), stime);
@@ -1030,7 +1034,7 @@ void MacDynamicTdma::sendPolling() {
 
 
 	//printf("***Node %i include %i neighbors in ACK message",node_ID_,mh->nrNB);
-    printf("Node %i send polling packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send polling packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
     mhTxPkt_.start(p->copy(), stime);
@@ -1095,8 +1099,10 @@ void MacDynamicTdma::findHashAndSort(int slot_num, int vslot_num) {
     }
 
     bubbleSort2(hashValue,hashID,idx+1);
-    for(int i=0;i<vslot_num;i++) {
+    if(TDL_LOG_ON(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG)) {
+        for(int i=0;i<vslot_num;i++) {
             printf("vslot %i seed %i, ",i+1,vslots[i]);
+        }
     }
 //    for(int i=0;i<MAX_NODE_NUM;i++) {
 //        printf("node %i hash %i\n",hashID[i],hashValue[i]);
@@ -1147,7 +1153,7 @@ char MacDynamicTdma::findWinningNode(int pos) {
 //    }
 
     //int count_winners = checkSlotsWinner(winner,slot_type);
-    printf("Node %i with seed %i found node %i as %i winning node for slot %i\n",node_ID_,node_seed_,hashID[pos],pos,slot_count_);
+    TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i with seed %i found node %i as %i winning node for slot %i\n",node_ID_,node_seed_,hashID[pos],pos,slot_count_);
 //    for(int i=0;i<MAX_NODE_NUM;i++) {
 //        printf("node %i hash %i, ",hashID[i],hashValue[i]);
 //    }
@@ -1247,14 +1253,14 @@ void MacDynamicTdma::selectNet() {
         //select vslot to use for NE randomly
         idx = (rand() % NUM_VSLOTS);
         ne_vslot = vslotIDs[idx];
-        printf("Node %i try to enter net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
-        printf("----- Node %i select vslot %i as entry slot \n",node_ID_,ne_vslot);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i try to enter net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "----- Node %i select vslot %i as entry slot \n",node_ID_,ne_vslot);
     } else {
         // If no net exist, start new net
         int idx = (rand() % MAX_NET_NO);
         net_ID_ = net_IDs[idx];
         net_freq_ = control_channel_ + net_ID_*CHANNEL_SPACING; //Compute channel frequency
-        printf("assign %i vslot seed\n",NUM_VSLOTS);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_DEBUG, "assign %i vslot seed\n",NUM_VSLOTS);
         for(int i=0;i<NUM_VSLOTS;i++) {
             vslots[i] = assignSeed();
         }
@@ -1265,7 +1271,7 @@ void MacDynamicTdma::selectNet() {
             table_nb_seed[i] = 0;
             table_nb_hops[i] = 3;
         }
-        printf("Node %i start net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i start net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
     }
     //is_in_net = 1;
 
@@ -1319,15 +1325,15 @@ void MacDynamicTdma::getNet() {
         //select vslot to use for NE randomly
         int idx = (rand() % NUM_VSLOTS);
         ne_vslot = vslotIDs[idx];
-        printf("Node %i try to enter net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
-        printf("----- Node %i select vslot %i as entry slot \n",node_ID_,ne_vslot);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i try to enter net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "----- Node %i select vslot %i as entry slot \n",node_ID_,ne_vslot);
     } else {
         // If no assigned net exist, start new net
         //int idx = (rand() % MAX_NET_NO);
         //net_ID_ = net_IDs[idx];
         net_ID_ = (u_int8_t) assigned_Net_;
         net_freq_ = control_channel_ + net_ID_*CHANNEL_SPACING; //Compute channel frequency
-        printf("assign %i vslot seed\n",NUM_VSLOTS);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_DEBUG, "assign %i vslot seed\n",NUM_VSLOTS);
         for(int i=0;i<NUM_VSLOTS;i++) {
             vslots[i] = assignSeed();
         }
@@ -1338,7 +1344,7 @@ void MacDynamicTdma::getNet() {
             table_nb_seed[i] = 0;
             table_nb_hops[i] = 3;
         }
-        printf("Node %i start net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
+        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i start net %i with freq %f \n",node_ID_,net_ID_,net_freq_);
     }
     //is_in_net = 1;
 
@@ -1576,29 +1582,29 @@ void MacDynamicTdma::bubbleSort2(int *arr1,char *arr2, int len)
 int MacDynamicTdma::assignSlots(int id,int msg_t,int rate) {
     int slotPeriod = 0;
     int max_msg_size = 0;
-    printf("***Do data slot assignment at %f for node %i with rate %i\n",Scheduler::instance().clock(),id,rate);
+    TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_DEBUG, "***Do data slot assignment at %f for node %i with rate %i\n",Scheduler::instance().clock(),id,rate);
     switch(msg_t) {
         case 1:
             // Message Type 1 RAP message require 1/10 s update rate with highest priority
-            printf("Current message is type 1\n");
+            TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_DEBUG, "Current message is type 1\n");
             slotPeriod = (int) (rate/slot_time_);
             max_msg_size = 5000;
             break;
         case 2:
             // Message Type 2 target track message require 1/2 s update rate with second highest priority
-            printf("Current message is type 2\n");
+            TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_DEBUG, "Current message is type 2\n");
             slotPeriod = (int) (rate/slot_time_);
             max_msg_size = 1200;
             break;
         case 3:
             // Message Type 3 position report message require 1/2 s update rate with lowest priority
-            printf("Current message is type 3\n");
+            TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_DEBUG, "Current message is type 3\n");
             slotPeriod = (int) (rate/slot_time_);
             max_msg_size = 50;
             break;
 
         case 0:
-            printf("invalid message type\n");
+            TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_ERR, "invalid message type\n");
             return 0;
             break;
     }
@@ -1869,7 +1875,7 @@ void MacDynamicTdma::allocateDataSlots() {
                                 tdma_schedule_[k] = -1;
                         }
                         nrAlloc--;
-                        printf("rate adjust %i \n",memberRateAdj[idx]);
+                        TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_DEBUG, "rate adjust %i \n",memberRateAdj[idx]);
                         if(memberRateAdj[idx]==0) {
                             memberReqRate[idx] = 2*memberReqRate[idx];
                             memberRateAdj[idx]++;
@@ -1919,7 +1925,7 @@ void MacDynamicTdma::accessControlSlots() {
             }
 
         } else if(is_net_entry && is_ack_waiting) {
-            printf("****Node %i is waiting ACK message for %i slot\n",node_ID_,waiting_slot_count);
+            TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "****Node %i is waiting ACK message for %i slot\n",node_ID_,waiting_slot_count);
         }
     } else {
         // if a node is already in the net
@@ -1942,14 +1948,14 @@ void MacDynamicTdma::accessControlSlots() {
             }
             if(is_control_msg_required) {
                 // send control message
-                printf("Node %i win control slot %i and have something to send\n",node_ID_,slot_count_);
+                TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i win control slot %i and have something to send\n",node_ID_,slot_count_);
                 sendControl();
                 is_control_msg_required = 0;
                 //reallocate data slot
                 allocateDataSlots();
             } else {
                 // send polling message
-                printf("Node %i win control slot %i but have nothing to send\n",node_ID_,slot_count_);
+                TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i win control slot %i but have nothing to send\n",node_ID_,slot_count_);
                 sendPolling();
             }
         } else {
@@ -2076,7 +2082,7 @@ void MacDynamicTdma::slotHandler(Event *e)
         waiting_slot_count++;
     // waiting for ack message for 199 slots
     if(waiting_slot_count==199) {
-            printf("*****Waiting time for ACK for Node %i has ended.\n",node_ID_);
+            TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "*****Waiting time for ACK for Node %i has ended.\n",node_ID_);
             net_ID_ = 0;
             is_net_entry = 0;
             is_ack_waiting = 0;
@@ -2208,7 +2214,7 @@ void MacDynamicTdma::backoffHandler(Event *e)
     //if(is_control_msg_required) {
                 // send control message
                 if(!is_rec_in_back_off) {
-                    printf("Back off time for node %i has ended and it will send control message in slot %i at time %f\n",node_ID_,slot_count_,Scheduler::instance().clock());
+                    TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Back off time for node %i has ended and it will send control message in slot %i at time %f\n",node_ID_,slot_count_,Scheduler::instance().clock());
                     sendControl();
                     is_control_msg_required = 0;
 
@@ -234,6 +234,8 @@ public:
 
 protected:
 	PHY_MIB		*phymib_;
+	// debug output of this node
+	TdlLog		log_;
 
 	// max slot num can be configured
 	int		    max_slot_num_;
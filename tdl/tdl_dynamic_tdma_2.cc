@@ -13,10 +13,13 @@ Usage: self-organized TDMA protocol
 #include "ll.h"
 #include "mac.h"
 #include "tdl_dynamic_tdma_2.h"
+#include "tdl_stats.h"
 #include "wireless-phy.h"
 #include "cmu-trace.h"
 #include "tclcl.h"
 #include <stddef.h>
+#include <string.h>
+#include <strings.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -36,15 +39,6 @@ Usage: self-organized TDMA protocol
 static PHY_MIB PMIB = {
 	Phy_SlotTime, Phy_GuardTime, Phy_RxTxTurnaround
 };
-int hdr_nb_info::offset_;
-static class HdrNbInfoClass : public PacketHeaderClass {
-public:
-	HdrNbInfoClass() : PacketHeaderClass("PacketHeader/HdrNbInfo",
-						    sizeof(hdr_nb_info)) {
-		bind_offset(&hdr_nb_info::offset_);
-	}
-} class_hdrnbinfo;
-
 // Control message Class
 int control_msg::offset_;
 static class ControlMsgClass : public PacketHeaderClass {
@@ -113,15 +107,18 @@ void MacDynamicTdmaTimer::stop(Packet *p)
 	rtime = 0.0;    //reset ramaining time
 }
 
-/* Slot timer for TDMA scheduling. */
-void SlotDynamicTdmaTimer::handle(Event *e)
+void MacDynamicTdmaTimer::restart(double time)
 {
-	busy_ = 0;
+	Scheduler &s = Scheduler::instance();
+	assert(busy_ == 0);
+
+	busy_ = 1;
 	paused_ = 0;
-	stime = 0.0;
-	rtime = 0.0;
+	stime = s.clock();
+	rtime = time;
+	assert(rtime >= 0.0);
 
-	mac->slotHandler(e);  //mac is MacFixTdma object
+	s.schedule(this, &intr, rtime);
 }
 
 /* Receive Timer */
@@ -136,14 +133,29 @@ void RxPktDynamicTdmaTimer::handle(Event *e)
 }
 
 /* Send Timer */
-void TxPktDynamicTdmaTimer::handle(Event *e)
+void TxPktDynamicTdmaTimer::start(int frame_type, double time)
+{
+	Scheduler &s = Scheduler::instance();
+	assert(busy_ == 0);
+
+	busy_ = 1;
+	paused_ = 0;
+	stime = s.clock();
+	rtime = time;
+	assert(rtime >= 0.0);
+	frame_type_ = frame_type;
+
+	s.schedule(this, &intr, rtime);
+}
+
+void TxPktDynamicTdmaTimer::handle(Event *)
 {
 	busy_ = 0;
 	paused_ = 0;
 	stime = 0.0;
 	rtime = 0.0;
 
-	mac->sendHandler(e);
+	mac->sendHandler(frame_type_);
 }
 
 /* Back Off Timer */
@@ -173,18 +185,52 @@ public:
 	}
 } class_mac_dynamic_tdma;
 
-static char nodeID = 0x41;
+static int nodeID = NODE_ID_BASE;
 static int ctrlPktCnt = 0;
 static int nodeInNetCnt = 0;
 static int activeNodes = 0;
 
+// MACs by node ID, for the seeds carried by skipped frames
+static MacDynamicTdma **macTable = 0;
+static int macTableSize = 0;
+
+static void registerMac(MacDynamicTdma *m, int id)
+{
+    int idx = id - NODE_ID_BASE;
+    if(idx >= macTableSize) {
+        int size = (macTableSize > 0) ? 2*macTableSize : 64;
+        while(size <= idx)
+            size *= 2;
+        MacDynamicTdma **table = new MacDynamicTdma*[size];
+        for(int i=0;i<size;i++)
+            table[i] = (i < macTableSize) ? macTable[i] : 0;
+        delete [] macTable;
+        macTable = table;
+        macTableSize = size;
+    }
+    macTable[idx] = m;
+}
+
+static void unregisterMac(MacDynamicTdma *m, int id)
+{
+    int idx = id - NODE_ID_BASE;
+    if(idx >= 0 && idx < macTableSize && macTable[idx] == m)
+        macTable[idx] = 0;
+}
+
+static inline MacDynamicTdma* macOf(int id)
+{
+    int idx = id - NODE_ID_BASE;
+    return (idx >= 0 && idx < macTableSize) ? macTable[idx] : 0;
+}
+
 MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
-	Mac(), ctrlPkt_(0), nePkt_(0), mhSlot_(this), mhTxPkt_(this), mhRxPkt_(this), mhBkOff_(this), recT_(this) {
+	Mac(), ctrlPkt_(0), nePkt_(0), mhTxPkt_(this), mhRxPkt_(this), mhBkOff_(this), recT_(this) {
 	/* Global variables setting. */
 	// Assign Node ID
 	node_ID_ = nodeID++;
 	activeNodes++;
-	node_seed_ = assignSeed();
+	registerMac(this, node_ID_);
 
 	// Setup the phy specs.
 	phymib_ = p;
@@ -194,12 +240,28 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
 	bind("max_slot_num_", &max_slot_num_);
 	bind("assigned_Net_",&assigned_Net_);
     bind("is_active_",&is_active_);
+	bind("aggregate_",&aggregate_);
+	bind("skip_idle_slots_",&skip_idle_slots_);
+	bind("pool_ctrl_",&pool_ctrl_);
+	bind("fast_forward_",&fast_forward_);
+	bind("rng_run_",&rng_run_);
+	bind("rng_key_",&rng_key_);
+	bind("log_level_",&log_.level_);
+	bind("log_cats_",&log_.cats_);
+
+	// the draws of this node only depend on its run and key
+	if(rng_run_ < 0)
+		rng_run_ = 0;
+	rng_ = new RNG(TDL_RNG_STREAM_BASE + rng_run_,
+	               (rng_key_ >= 0) ? rng_key_ : node_ID_ - NODE_ID_BASE);
+	node_seed_ = assignSeed();
 
 
 
-	// Calculate the slot time based on the MAX allowed data length exclude guard time on physical layer.
-	slot_time_ = Phy_SlotTime;
-	data_time_ = Phy_SlotTime - Phy_GuardTime;
+	// Frame geometry of the assigned net, the slot time excludes the guard time for data.
+	TdlFrame::lookup(assigned_Net_, &frame_);
+	slot_time_ = frame_.slot_time;
+	data_time_ = frame_.slot_time - frame_.guard_time;
 
 
 	/* Much simplified centralized scheduling algorithm for single hop
@@ -207,10 +269,21 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
 	*/
 	// Initualize the tdma schedule and preamble data structure.
 	tdma_schedule_ = new int[max_slot_num_];  //store time slot table with node id
-	table_nb_id = new char[MAX_NODE_NUM-1];
-	table_nb_msg_type = new MsgType[MAX_NODE_NUM-1];
-	table_nb_seed = new u_int8_t[MAX_NODE_NUM-1];
-	table_nb_hops = new u_int8_t[MAX_NODE_NUM-1];
+	nb_table_size_ = 0;
+	num_nb_ = 0;
+	table_nb_id = 0;
+	table_nb_known = 0;
+	table_nb_msg_type = 0;
+	table_nb_seed = 0;
+	table_nb_hops = 0;
+	nb_words_ = 0;
+	onehop_set_ = 0;
+	twohop_set_ = 0;
+	known_set_ = 0;
+	hop1_set_ = 0;
+	reach_set_ = 0;
+	left_set_ = 0;
+	hash_len_ = 0;
 
 	// flag slots for different type
 	// -1 is free data slot
@@ -223,25 +296,32 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
     }
 
 
-    // assign control slots
-    for(int i=0;i<max_slot_num_;i=i+20){
-        tdma_schedule_[i] = -2;
-    }
+    // the allocator assigns the control slots, one every block_len slots
+    slot_alloc_.init(tdma_schedule_,max_slot_num_,frame_);
 
-    //initialize neighbor table
-    for(int i=0;i<MAX_NODE_NUM-1;i++){
-        table_nb_id[i] = 0x00;          // initially no neighbor in table
-        table_nb_msg_type[i] = MSG_0;
-        table_nb_hops[i] = 3;           // initially all neighbor are over 2 hops
-    }
+    // election table, rebuilt row by row on first use
+    elect_rows_ = slot_alloc_.numBlocks();
+    elect_k_ = 1 + frame_.poll_size + frame_.num_vslots;
+    elect_id_ = new int[elect_rows_*elect_k_];
+    elect_value_ = new int[elect_rows_*elect_k_];
+    elect_len_ = new int[elect_rows_];
+    elect_row_gen_ = new int[elect_rows_];
+    elect_gen_ = 0;
+    for(int r=0;r<elect_rows_;r++)
+        elect_row_gen_[r] = -1;
+    members_ = 0;
+    members_size_ = 0;
 
+    //initialize neighbor table, initially no neighbor in table
+    growNeighborTable(NODE_ID_BASE + NB_TABLE_INIT_SIZE - 1);
 
 
-    // Assign ID to VSLOTs
-    char init_vslot_ID = 0x61;
-    for(int i=0;i<NUM_VSLOTS;i++) {
-        vslotIDs[i] = init_vslot_ID++;
-        vslots[i] = (assigned_Net_*i+(int) vslotIDs[i]) % 256;
+
+    // Assign ID to VSLOTs. Seeds are still derived from 'a', 'b', ...
+    int init_vslot_seed = 0x61;
+    for(int i=0;i<frame_.num_vslots;i++) {
+        vslotIDs[i] = -(i+1);
+        vslots[i] = (assigned_Net_*i+init_vslot_seed++) % 256;
     }
 
 
@@ -270,9 +350,20 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
 
 	slot_count_ = FIRST_ROUND;
 
+	agg_pull_ = 0;
+	agg_next_ = 0;
+	nb_stable_ = 0;
+
+	for(int i=0;i<NUM_CTRL_KINDS;i++)
+		ctrl_pool_[i] = 0;
+	num_pkt_alloc_ = 0;
+	num_ctrl_frames_ = 0;
+	num_data_frames_ = 0;
+
 
 	//Start the Slot timer..
-	mhSlot_.start((Packet *) (& intr_), 0);
+	slot_clock_ = TdmaSlotClock::attach(this, slot_time_, 0);
+	last_tick_ = slot_clock_->tick();
 
 	//Start record
 	if(is_active_) {
@@ -281,23 +372,50 @@ MacDynamicTdma::MacDynamicTdma(PHY_MIB* p) :
 	}
 }
 
+// A MAC deleted while the simulation goes on, e.g. with its node, must
+// not be ticked or handed seeds any more.
+MacDynamicTdma::~MacDynamicTdma()
+{
+    unregisterMac(this, node_ID_);
+    slot_clock_->detach(this);
+    if(recT_.status() == TIMER_PENDING)
+        recT_.cancel();
+    for(int i=0;i<NUM_CTRL_KINDS;i++) {
+        if(ctrl_pool_[i])
+            Packet::free(ctrl_pool_[i]);
+    }
+    delete rng_;
+    delete [] tdma_schedule_;
+    delete [] elect_id_;
+    delete [] elect_value_;
+    delete [] elect_len_;
+    delete [] elect_row_gen_;
+    delete [] members_;
+    delete [] table_nb_id;
+    delete [] table_nb_known;
+    delete [] table_nb_msg_type;
+    delete [] table_nb_seed;
+    delete [] table_nb_hops;
+    delete [] onehop_set_;
+    delete [] twohop_set_;
+    delete [] known_set_;
+    delete [] hop1_set_;
+    delete [] reach_set_;
+    delete [] left_set_;
+}
+
 void MacDynamicTdma::recordHandler()
 {
+    // counters of the frames skipped so far
+    slot_clock_->sync();
     //record momentary avg delay
-    char out[100];
-    sprintf(out, "recordAvgPacketDelay %i %i %f", node_ID_,record_time,avg_delay);
-    Tcl& tcl = Tcl::instance();
-    tcl.eval(out);
+    TdlStats::record(TDL_AVG_PACKET_DELAY, "%i %i %f", node_ID_,record_time,avg_delay);
 
     //record individual throughput
-    char out2[100];
-    sprintf(out2, "recordThroughput %i %i %i %i %i", node_ID_,record_time,num_packets_sent,num_bytes_sent,num_tbytes_sent);
-    tcl.eval(out2);
+    TdlStats::record(TDL_THROUGHPUT, "%i %i %i %i %i", node_ID_,record_time,num_packets_sent,num_bytes_sent,num_tbytes_sent);
 
     //record individual time slot utilization
-    char out3[100];
-    sprintf(out3, "recordSlotUtil %i %i %i %i", node_ID_,record_time,num_slots_reserved,num_slots_used);
-    tcl.eval(out3);
+    TdlStats::record(TDL_SLOT_UTIL, "%i %i %i %i", node_ID_,record_time,num_slots_reserved,num_slots_used);
 
     record_time++;
     recT_.resched(1);
@@ -306,11 +424,21 @@ void MacDynamicTdma::recordHandler()
 u_int8_t MacDynamicTdma::assignSeed()
 {
     // Assign seed
-	u_int8_t val = (rand() % 256);
+	u_int8_t val = rng_->uniform(256);
 	return (INIT_SEED + val);
 }
 int MacDynamicTdma::command(int argc, const char*const* argv)
 {
+	if (argc >= 3 && strcmp(argv[1], "log") == 0)
+		return log_.command(argc, argv);
+	if (argc == 2) {
+		// packets allocated for the frames sent by this MAC
+		if (strcmp(argv[1], "alloc-stats") == 0) {
+			Tcl::instance().resultf("alloc %d ctrl %d data %d",
+			    num_pkt_alloc_, num_ctrl_frames_, num_data_frames_);
+			return TCL_OK;
+		}
+	}
 	if (argc == 3) {
 		if (strcmp(argv[1], "log-target") == 0) {
 			logtarget_ = (NsObject*) TclObject::lookup(argv[2]);
@@ -318,6 +446,47 @@ int MacDynamicTdma::command(int argc, const char*const* argv)
 				return TCL_ERROR;
 			return TCL_OK;
 		}
+		// checkpoint <file>, append the net state, return the next slot time
+		if (strcmp(argv[1], "checkpoint") == 0) {
+			FILE *f = fopen(argv[2], "a");
+			if(f == 0) {
+				Tcl::instance().resultf("cannot open %s", argv[2]);
+				return TCL_ERROR;
+			}
+			slot_clock_->sync();
+			if(skip_idle_slots_)
+				syncSlotCount();
+			saveState(f);
+			fclose(f);
+			Tcl::instance().resultf("%.17g", slot_clock_->next());
+			return TCL_OK;
+		}
+		// rng-run <k>, move to the stream of run k and draw the seed
+		// again, before the first slot of the run
+		if (strcmp(argv[1], "rng-run") == 0) {
+			rng_run_ = atoi(argv[2]);
+			if(rng_run_ < 0)
+				rng_run_ = 0;
+			rng_->set_stream(TDL_RNG_STREAM_BASE + rng_run_,
+			    (rng_key_ >= 0) ? rng_key_ : node_ID_ - NODE_ID_BASE);
+			node_seed_ = assignSeed();
+			return TCL_OK;
+		}
+		// restore <file>, before the run, its clock set to the checkpoint
+		if (strcmp(argv[1], "restore") == 0) {
+			FILE *f = fopen(argv[2], "r");
+			if(f == 0) {
+				Tcl::instance().resultf("cannot open %s", argv[2]);
+				return TCL_ERROR;
+			}
+			int ok = loadState(f);
+			fclose(f);
+			if(!ok) {
+				Tcl::instance().resultf("no state of node %d in %s", node_ID_, argv[2]);
+				return TCL_ERROR;
+			}
+			return TCL_OK;
+		}
 
 	}
 	return Mac::command(argc, argv);
@@ -372,11 +541,15 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
 	/* Incoming packets from phy layer, send UP to ll layer.
 	   Now, it is in receiving mode.
 	*/
+    slot_clock_->resume();
+    if(skip_idle_slots_)
+        syncSlotCount();
+
     if (ch->direction() == hdr_cmn::UP) {
 		// Since we can't really turn the radio off at lower level,
 		// we just discard the packet.
         if (!radio_active_) {
-		    printf("node %i receive incoming packet with radio off in slot %i. Discard packet\n",node_ID_,slot_count_);
+		    TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_DEBUG, "node %i receive incoming packet with radio off in slot %i. Discard packet\n",node_ID_,slot_count_);
 			free(p);
 			return;
 		}
@@ -385,16 +558,16 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
         return;
 	}
 
+    // packets from the upper layers may start the app or change the net
+    wakeSlots();
+
     //Node remain silence until the application start to send its first message
     //That is datalink radio is turned on first but neither tx or rx
     //until the tdl application starts, then it can tx or rx in the slot
     if(ch->ptype() == PT_TDLDATA) {
     packet_arr_time =  Scheduler::instance().clock();
     //printf("MAC in %i receive packet %i size %d from Upper Layer at time %f\n",node_ID_,ch->uid(),ch->size(),Scheduler::instance().clock());
-    char out[100];
-    sprintf(out, "recordPktArrTime %i %f", ch->uid(),Scheduler::instance().clock());
-    Tcl& tcl = Tcl::instance();
-    tcl.eval(out);
+    TdlStats::record(TDL_PKT_ARR_TIME, "%i %f", ch->uid(),Scheduler::instance().clock());
     // if it is first packet
     if(!is_app_start) {
         is_app_start = 1;
@@ -410,6 +583,11 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
     callback_ = h;
     state(MAC_SEND);
 
+    // pulled by aggregate(), it decides whether the segment still fits
+    if(agg_pull_) {
+        agg_next_ = p;
+        return;
+    }
     sendDown(p);
     return;
     }
@@ -420,7 +598,7 @@ void MacDynamicTdma::recv(Packet* p, Handler* h) {
         node_msg_size_ = tdlh->newbytes;
         if(is_in_net) {
             // control message is required to be sent before sending any data
-            printf("****** require control message\n");
+            TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "****** require control message\n");
             is_control_msg_required = 1;
             update_msg_arr_time = Scheduler::instance().clock();
         }
@@ -450,7 +628,7 @@ void MacDynamicTdma::sendUp(Packet* p)
     //struct hdr_mac_dynamic_tdma *mh = HDR_MAC_DYNAMIC_TDMA(p);
 	/* Can't receive while transmitting. Should not happen...?*/
 	if (tx_state_ && ch->error() == 0) {
-		printf("Node %i can't receive while transmitting!\n", node_ID_);
+		TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_ERR, "Node %i can't receive while transmitting!\n", node_ID_);
 		ch->error() = 1;
 		if(ch->ptype() == PT_TDLDATA) {
             is_conflict_in_frame = 1;
@@ -475,7 +653,7 @@ void MacDynamicTdma::sendUp(Packet* p)
 		SET_RX_STATE(MAC_COLL);
 		Phy *ph;
 		ph = netif_;
-		printf("Node %i, receiving packet %i, but the channel in %f in slot %i is not idle....???\n", node_ID_,ch->uid(),((WirelessPhy *)ph)->getFreq(), slot_count_);
+		TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_ERR, "Node %i, receiving packet %i, but the channel in %f in slot %i is not idle....???\n", node_ID_,ch->uid(),((WirelessPhy *)ph)->getFreq(), slot_count_);
 		if(ch->ptype() == PT_TDLDATA) {
             is_conflict_in_frame = 1;
             num_conflicts++;
@@ -499,11 +677,93 @@ void MacDynamicTdma::sendUp(Packet* p)
 void MacDynamicTdma::recvDATA(Packet *p){
 	/*Adjust the MAC packet size: strip off the mac header.*/
 	struct hdr_cmn *ch = HDR_CMN(p);
+	TdlAggData *agg = 0;
+	Packet *seg[AGG_MAX_SEGMENTS];
+	int num_seg = 0;
+
+	// Give the frame its own data back, the neighbor list has been read
+	if(p->userdata() && p->userdata()->type() == TDL_NB_DATA) {
+        TdlNbData *nb = (TdlNbData *) p->takedata();
+        p->setdata(nb->data_);
+        nb->data_ = 0;
+        delete nb;
+	}
+
+	// De-aggregate: take the packed segments off the first packet
+	if(p->userdata() && p->userdata()->type() == TDL_AGG_DATA) {
+        p->unshare();
+        agg = (TdlAggData *) p->userdata();
+        num_seg = agg->num_;
+        for(int i=0;i<num_seg;i++)
+            seg[i] = agg->seg_[i];
+        agg->num_ = 0;
+        ch->size() = agg->head_size_ + DYNAMIC_MAC_HDR_LEN;
+        AppData *head_data = agg->head_data_;
+        agg->head_data_ = 0;
+        p->setdata(head_data);
+	}
+
 	ch->size() -= DYNAMIC_MAC_HDR_LEN;
     ch->num_forwards() += 1;
 	/* Pass the packet up to the link-layer.*/
 	uptarget_->recv(p, (Handler*) 0);
 
+	// segments never had a MAC header of their own
+	for(int i=0;i<num_seg;i++) {
+        struct hdr_cmn *sch = HDR_CMN(seg[i]);
+        sch->direction() = hdr_cmn::UP;
+        sch->num_forwards() += 1;
+        uptarget_->recv(seg[i], (Handler*) 0);
+	}
+}
+
+TdlAggData::TdlAggData(TdlAggData& d) : AppData(d)
+{
+	num_ = d.num_;
+	head_size_ = d.head_size_;
+	head_data_ = d.head_data_ ? d.head_data_->copy() : 0;
+	for(int i=0;i<num_;i++)
+		seg_[i] = d.seg_[i]->copy();
+}
+
+TdlAggData::~TdlAggData()
+{
+	delete head_data_;
+	for(int i=0;i<num_;i++)
+		Packet::free(seg_[i]);
+}
+
+TdlNbData::TdlNbData(TdlNbData& d) : AppData(d), nbSet_(0), nbInfo_(0),
+	words_(0), nrNB_(0), data_(0), max_words_(0), max_nb_(0)
+{
+	reset(d.words_, d.nrNB_);
+	memcpy(nbSet_, d.nbSet_, words_*sizeof(u_int32_t));
+	memcpy(nbInfo_, d.nbInfo_, nrNB_*sizeof(u_int32_t));
+	data_ = d.data_ ? d.data_->copy() : 0;
+}
+
+TdlNbData::~TdlNbData()
+{
+	delete data_;
+	delete [] nbSet_;
+	delete [] nbInfo_;
+}
+
+void TdlNbData::reset(int words, int nb)
+{
+	if(words > max_words_) {
+		delete [] nbSet_;
+		nbSet_ = new u_int32_t[words];
+		max_words_ = words;
+	}
+	if(nb > max_nb_) {
+		delete [] nbInfo_;
+		nbInfo_ = new u_int32_t[nb];
+		max_nb_ = nb;
+	}
+	words_ = words;
+	nrNB_ = nb;
+	memset(nbSet_, 0, words*sizeof(u_int32_t));
 }
 
 
@@ -516,7 +776,7 @@ void MacDynamicTdma::sendDown(Packet* p) {
     struct hdr_cmn *ch = HDR_CMN(p);
     if(pktTx_) {
         struct hdr_cmn *ch2 = HDR_CMN(pktTx_);
-        printf("Packet %i is arriving at MAC and packet %i is dropped\n",ch->uid(),ch2->uid());
+        TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Packet %i is arriving at MAC and packet %i is dropped\n",ch->uid(),ch2->uid());
     }
 
 	pktTx_ = p;
@@ -531,12 +791,11 @@ void MacDynamicTdma::send()
 	u_int32_t size;
 	struct hdr_cmn* ch;
 	struct hdr_mac_dynamic_tdma* mh;
-	struct hdr_nb_info* nb;
 	double stime;
 
 	/* Check if there is any packet buffered. */
 	if (!pktTx_) {
-		printf("<%d>, %f, no packet buffered.\n", index_, NOW);
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_ERR, "<%d>, %f, no packet buffered.\n", index_, NOW);
 		return;
 	}
 
@@ -545,15 +804,21 @@ void MacDynamicTdma::send()
 		/* Note: we don't take the channel status into account, ie. no collision,
 		   as collision should not happen...
 		*/
-		printf("<%d>, %f, transmitting, but the channel is not idle...???\n", index_, NOW);
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_ERR, "<%d>, %f, transmitting, but the channel is not idle...???\n", index_, NOW);
 		return;
 	}
 
 
+	/* Pack more queued segments behind pktTx_, the arrival time
+	   of pktTx_ is overwritten by the segments pulled. */
+	double head_arr_time = packet_arr_time;
+	TdlAggData *agg = 0;
+	if(aggregate_)
+		agg = aggregate();
+
 	/* Update the MAC header */
 	ch = HDR_CMN(pktTx_);
 	mh = HDR_MAC_DYNAMIC_TDMA(pktTx_);
-	nb = hdr_nb_info::access(pktTx_);
     int pId;
 
 	size = ch->size();
@@ -563,27 +828,7 @@ void MacDynamicTdma::send()
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    nb->nrNB = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
-            nb->nbID[i] = table_nb_id[i];
-            nb->nbMsgType[i] = table_nb_msg_type[i];
-            nb->nbSeed[i] = table_nb_seed[i];
-            nb->nrNB++;
-            int nr_hops = 2;
-            if(checkOneHop(table_nb_id[i])) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(table_nb_id[i]);
-                table_nb_hops[i] = nr_hops;
-            }
-        } else {
-            nb->nbID[i] = 0x00;
-            nb->nbMsgType[i] = MSG_0;
-            nb->nbSeed[i] = 0;
-
-        }
-    }
+    fillNeighborInfo(pktTx_);
 
 
     ch->size() = size + DYNAMIC_MAC_HDR_LEN;
@@ -599,33 +844,86 @@ void MacDynamicTdma::send()
 	/* Start a timer that expires when the packet transmission is complete. */
     Phy *ph;
     ph = netif_;
-	printf("Node %i send packet %i size %d bytes in slot %d with freqency %f at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,((WirelessPhy *)ph)->getFreq(),Scheduler::instance().clock());
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_DEBUG, "Node %i send packet %i size %d bytes in slot %d with freqency %f at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,((WirelessPhy *)ph)->getFreq(),Scheduler::instance().clock());
 	//record delay
 	num_packets_sent++;
-	num_bytes_sent += ch->size()-DYNAMIC_MAC_HDR_LEN;
 	num_tbytes_sent += ch->size();
     double send_packet_time = Scheduler::instance().clock();
-    double pkt_delay = send_packet_time-packet_arr_time;
+    double pkt_delay = send_packet_time-head_arr_time;
     cumulative_delay += pkt_delay;
     avg_delay = cumulative_delay/num_packets_sent;
-    char out[100];
-    sprintf(out, "recordPacketDelay %i %i %f", node_ID_,ch->uid(),pkt_delay);
-    Tcl& tcl = Tcl::instance();
-    tcl.eval(out);
+    TdlStats::record(TDL_PACKET_DELAY, "%i %i %f", node_ID_,ch->uid(),pkt_delay);
+    if(agg) {
+        // segments were pulled from the IFQ just now
+        num_bytes_sent += agg->head_size_;
+        for(int i=0;i<agg->num_;i++) {
+            struct hdr_cmn *sch = HDR_CMN(agg->seg_[i]);
+            num_packets_sent++;
+            num_bytes_sent += sch->size();
+            avg_delay = cumulative_delay/num_packets_sent;
+            TdlStats::record(TDL_PACKET_DELAY, "%i %i %f", node_ID_,sch->uid(),0.0);
+        }
+    } else {
+        num_bytes_sent += ch->size()-DYNAMIC_MAC_HDR_LEN;
+    }
 
     num_slots_used++;
-	mhTxPkt_.start(pktTx_->copy(), stime);
+    num_data_frames_++;
+	mhTxPkt_.start(DATA_FRAME, stime);
 	downtarget_->recv(pktTx_, this);
     is_seed_sent = 1;
-	pktTx_ = 0;
-
+	// a segment that did not fit waits for the next reserved slot
+	pktTx_ = agg_next_;
+	agg_next_ = 0;
+}
 
+/* Pull segments from the IFQ and pack them behind pktTx_ as long as the
+   whole frame can be sent within data_time_. Returns the packed segments,
+   or 0 if nothing could be added. */
+TdlAggData* MacDynamicTdma::aggregate()
+{
+	int max_len = (int) (data_time_ * bandwidth_ / 8);
+	int len = HDR_CMN(pktTx_)->size() + DYNAMIC_MAC_HDR_LEN;
+	TdlAggData *agg = 0;
+
+	while(callback_ && (agg == 0 || agg->num_ < AGG_MAX_SEGMENTS)) {
+        // let the IFQ hand over its next packet, recv() keeps it in agg_next_
+        Handler *h = callback_;
+        callback_ = 0;
+        agg_pull_ = 1;
+        h->handle((Event*) 0);
+        agg_pull_ = 0;
+        if(agg_next_ == 0)
+            break;      // IFQ is empty
+
+        int seg_len = HDR_CMN(agg_next_)->size() + AGG_SUBHDR_LEN;
+        if(len + seg_len > max_len)
+            break;      // leave it in agg_next_ for the next slot
+
+        if(agg == 0) {
+            agg = new TdlAggData;
+            agg->head_size_ = HDR_CMN(pktTx_)->size();
+            // the data of the first packet is restored after de-aggregation
+            if(pktTx_->userdata())
+                agg->head_data_ = pktTx_->userdata()->copy();
+        }
+        agg->seg_[agg->num_++] = agg_next_;
+        agg_next_ = 0;
+        len += seg_len;
+	}
 
+	if(agg) {
+        HDR_CMN(pktTx_)->size() = len - DYNAMIC_MAC_HDR_LEN;
+        pktTx_->setdata(agg);
+	}
+	return agg;
 }
 
 // Turn on / off the radio
 void MacDynamicTdma::radioSwitch(int i)
 {
+	if(i != radio_active_)
+		wakeSlots();
 	radio_active_ = i;
 	if (i == ON) {
 		Phy *p;
@@ -653,10 +951,43 @@ void MacDynamicTdma::switchToNetChannel() {
 
 
 
+/* Packet for a control frame of the given kind. The packet of the kind is
+   used again if nobody holds it any more, a receiver still sharing its
+   header bits (Channel/WirelessChannel shared_rx_) gets a new one.
+   Every sender writes all fields of its headers, only the common header
+   is cleared here, as it is passed on to the copies of the receivers.
+   Without pool_ctrl_ every frame gets a new packet, as it used to. */
+Packet* MacDynamicTdma::allocCtrl(int kind)
+{
+    Packet *p = ctrl_pool_[kind];
+    if(!pool_ctrl_) {
+        num_pkt_alloc_++;
+        num_ctrl_frames_++;
+        return Packet::alloc();
+    }
+    if(p && p->ref_count() == 0) {
+        hdr_cmn* ch = HDR_CMN(p);
+        memset(ch, 0, sizeof(hdr_cmn));
+        ch->next_hop_ = -2;
+        ch->last_hop_ = -2;
+        ch->direction() = hdr_cmn::DOWN;
+    } else {
+        // replace the packet still in use, the channel frees it later
+        if(p)
+            Packet::free(p);
+        p = Packet::alloc();
+        num_pkt_alloc_++;
+        ctrl_pool_[kind] = p;
+    }
+    num_ctrl_frames_++;
+    // the reference handed down is dropped when the channel frees it
+    return p->refcopy();
+}
+
 void MacDynamicTdma::sendNetEntry() {
     Packet* p;
     double stime;
-    p = Packet::alloc();
+    p = allocCtrl(CTRL_NETENTRY);
 
     net_entry_msg::access(p)->entry_msg = 1;
     net_entry_msg::access(p)->entry_ID = node_ID_;
@@ -669,28 +1000,7 @@ void MacDynamicTdma::sendNetEntry() {
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    hdr_nb_info* nb = hdr_nb_info::access(p);
-    nb->nrNB = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
-            nb->nbID[i] = table_nb_id[i];
-            nb->nbMsgType[i] = table_nb_msg_type[i];
-            nb->nbSeed[i] = table_nb_seed[i];
-            nb->nrNB++;
-            int nr_hops = 2;
-            if(checkOneHop(table_nb_id[i])) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(table_nb_id[i]);
-                table_nb_hops[i] = nr_hops;
-            }
-        } else {
-            nb->nbID[i] = 0x00;
-            nb->nbMsgType[i] = MSG_0;
-            nb->nbSeed[i] = 0;
-
-        }
-    }
+    fillNeighborInfo(p);
 
     hdr_cmn* ch = hdr_cmn::access(p);
     ch->direction() = hdr_cmn::DOWN;
@@ -709,11 +1019,11 @@ void MacDynamicTdma::sendNetEntry() {
 	/* Turn on the radio and transmit! */
 	SET_TX_STATE(MAC_SEND);
 	radioSwitch(ON);
-    printf("***Node %i send net entry packet(%i) %i with size %i bytes in slot %i at time %f\n",node_ID_,ch->ptype(),ch->uid(),ch->size(),slot_count_,ch->timestamp());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "***Node %i send net entry packet(%i) %i with size %i bytes in slot %i at time %f\n",node_ID_,ch->ptype(),ch->uid(),ch->size(),slot_count_,ch->timestamp());
 
 
 	/* Start a timer that expires when the packet transmission is complete. */
-    mhTxPkt_.start(p->copy(), stime);
+    mhTxPkt_.start(NETENTRY_FRAME, stime);
 	downtarget_->recv(p, this);
 
 }
@@ -721,7 +1031,7 @@ void MacDynamicTdma::sendNetEntry() {
 void MacDynamicTdma::sendNetEntryACK() {
     Packet* p;
     double stime;
-    p = Packet::alloc();
+    p = allocCtrl(CTRL_NETENTRY_ACK);
     struct net_entry_msg *ne = net_entry_msg::access(nePkt_);
     net_entry_msg::access(p)->entry_msg = 2;
     net_entry_msg::access(p)->entry_ID = ne->entry_ID;
@@ -734,28 +1044,7 @@ void MacDynamicTdma::sendNetEntryACK() {
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    hdr_nb_info* nb = hdr_nb_info::access(p);
-    nb->nrNB = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
-            nb->nbID[i] = table_nb_id[i];
-            nb->nbMsgType[i] = table_nb_msg_type[i];
-            nb->nbSeed[i] = table_nb_seed[i];
-            nb->nrNB++;
-            int nr_hops = 2;
-            if(checkOneHop(table_nb_id[i])) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(table_nb_id[i]);
-                table_nb_hops[i] = nr_hops;
-            }
-        } else {
-            nb->nbID[i] = 0x00;
-            nb->nbMsgType[i] = MSG_0;
-            nb->nbSeed[i] = 0;
-
-        }
-    }
+    fillNeighborInfo(p);
 
     hdr_cmn* ch = hdr_cmn::access(p);
     ch->direction() = hdr_cmn::DOWN;
@@ -779,10 +1068,10 @@ void MacDynamicTdma::sendNetEntryACK() {
 
 
 	//printf("***Node %i include %i neighbors in ACK message",node_ID_,nb->nrNB);
-    printf("Node %i send net entry ACK packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
+    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send net entry ACK packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
-    mhTxPkt_.start(p->copy(), stime);
+    mhTxPkt_.start(NETENTRY_FRAME, stime);
 	downtarget_->recv(p, this);
 
     is_seed_sent = 1;
@@ -794,7 +1083,7 @@ void MacDynamicTdma::sendNetEntryACK() {
 void MacDynamicTdma::sendControl() {
     Packet* p;
     double stime;
-    p = Packet::alloc();
+    p = allocCtrl(CTRL_CONTROL);
 
     struct hdr_mac_dynamic_tdma* mh = HDR_MAC_DYNAMIC_TDMA(p);
     struct control_msg* cm = control_msg::access(p);
@@ -809,28 +1098,7 @@ void MacDynamicTdma::sendControl() {
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    hdr_nb_info* nb = hdr_nb_info::access(p);
-    nb->nrNB = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
-            nb->nbID[i] = table_nb_id[i];
-            nb->nbMsgType[i] = table_nb_msg_type[i];
-            nb->nbSeed[i] = table_nb_seed[i];
-            nb->nrNB++;
-            int nr_hops = 2;
-            if(checkOneHop(table_nb_id[i])) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(table_nb_id[i]);
-                table_nb_hops[i] = nr_hops;
-            }
-        } else {
-            nb->nbID[i] = 0x00;
-            nb->nbMsgType[i] = MSG_0;
-            nb->nbSeed[i] = 0;
-
-        }
-    }
+    fillNeighborInfo(p);
 
     hdr_cmn* ch = hdr_cmn::access(p);
     ch->direction() = hdr_cmn::DOWN;
@@ -853,10 +1121,10 @@ void MacDynamicTdma::sendControl() {
 
 
 
-	printf("Node %i send update control packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send update control packet %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
-    mhTxPkt_.start(p->copy(), stime);
+    mhTxPkt_.start(CONTROL_FRAME, stime);
 	downtarget_->recv(p, this);
     is_seed_sent = 1;
     is_cack_waiting = 1;
@@ -866,7 +1134,7 @@ void MacDynamicTdma::sendControl() {
 void MacDynamicTdma::sendControlACK() {
     Packet* p;
     double stime;
-    p = Packet::alloc();
+    p = allocCtrl(CTRL_CONTROL_ACK);
 
     struct hdr_mac_dynamic_tdma* mh = HDR_MAC_DYNAMIC_TDMA(p);
     struct control_msg* cm = control_msg::access(p);
@@ -882,28 +1150,7 @@ void MacDynamicTdma::sendControlACK() {
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    hdr_nb_info* nb = hdr_nb_info::access(p);
-    nb->nrNB = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
-            nb->nbID[i] = table_nb_id[i];
-            nb->nbMsgType[i] = table_nb_msg_type[i];
-            nb->nbSeed[i] = table_nb_seed[i];
-            nb->nrNB++;
-            int nr_hops = 2;
-            if(checkOneHop(table_nb_id[i])) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(table_nb_id[i]);
-                table_nb_hops[i] = nr_hops;
-            }
-        } else {
-            nb->nbID[i] = 0x00;
-            nb->nbMsgType[i] = MSG_0;
-            nb->nbSeed[i] = 0;
-
-        }
-    }
+    fillNeighborInfo(p);
 
     hdr_cmn* ch = hdr_cmn::access(p);
     ch->direction() = hdr_cmn::DOWN;
@@ -926,10 +1173,10 @@ void MacDynamicTdma::sendControlACK() {
 
 
 
-	printf("Node %i send update control packet ACK %i for node %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),cm2->control_ID,ch->size(),slot_count_,Scheduler::instance().clock());
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send update control packet ACK %i for node %i size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),cm2->control_ID,ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
-    mhTxPkt_.start(p->copy(), stime);
+    mhTxPkt_.start(CONTROL_FRAME, stime);
 	downtarget_->recv(p, this);
     is_seed_sent = 1;
     ctrlPkt_ = 0;
@@ -941,29 +1188,19 @@ void MacDynamicTdma::sendControlACK() {
 void MacDynamicTdma::sendPolling() {
     Packet* p;
     double stime;
-    p = Packet::alloc();
+    p = allocCtrl(CTRL_POLLING);
     struct polling_msg* ph = polling_msg::access(p);
 
-    char firstRunner = 0x00;
-
-    char secondRunner = 0x00;
-
-    char thirdRunner = 0x00;
-
-
     //reset poll list
-    for(int i=0;i<POLL_SIZE;i++) {
+    for(int i=0;i<MAX_POLL_SIZE;i++) {
         poll_list_[i] = 0x00;
+        ph->runner_ups[i] = 0x00;
+    }
+    // each runner up is found among the nodes not polled yet
+    for(int i=0;i<frame_.poll_size;i++) {
+        poll_list_[i] = findRunnerUpNode(i+1);
+        ph->runner_ups[i] = poll_list_[i];
     }
-    firstRunner = findRunnerUpNode(1);
-    poll_list_[0] = firstRunner;
-    secondRunner = findRunnerUpNode(2);
-    poll_list_[1] = secondRunner;
-    thirdRunner = findRunnerUpNode(3);
-    poll_list_[2] = thirdRunner;
-    ph->runner_ups[0] = firstRunner;
-    ph->runner_ups[1] = secondRunner;
-    ph->runner_ups[2] = thirdRunner;
 
 
     struct hdr_mac_dynamic_tdma* mh = HDR_MAC_DYNAMIC_TDMA(p);
@@ -975,29 +1212,7 @@ void MacDynamicTdma::sendPolling() {
     mh->srcID = node_ID_;
     mh->srcMsgType = node_msg_type_;
     mh->srcSeed = node_seed_;
-    hdr_nb_info* nb = hdr_nb_info::access(p);
-    nb->nrNB = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]==1) {
-            nb->nbID[i] = table_nb_id[i];
-            nb->nbMsgType[i] = table_nb_msg_type[i];
-            nb->nbSeed[i] = table_nb_seed[i];
-            nb->nrNB++;
-            int nr_hops = 2;
-            if(checkOneHop(table_nb_id[i])) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(table_nb_id[i]);
-                table_nb_hops[i] = nr_hops;
-            }
-            //printf("attach nb %i\n",table_nb_id[i]);
-        } else {
-            nb->nbID[i] = 0x00;
-            nb->nbMsgType[i] = MSG_0;
-            nb->nbSeed[i] = 0;
-
-        }
-    }
+    fillNeighborInfo(p);
 
     hdr_cmn* ch = hdr_cmn::access(p);
     ch->direction() = hdr_cmn::DOWN;
@@ -1005,7 +1220,7 @@ void MacDynamicTdma::sendPolling() {
     ch->ptype() = PT_TDLPOLL;
 	ch->timestamp() = Scheduler::instance().clock();
 	ch->iface() = UNKN_IFACE.value();
-	ch->size() = DYNAMIC_MAC_HDR_LEN + POLLING_PAYLOAD_SIZE;
+	ch->size() = DYNAMIC_MAC_HDR_LEN + frame_.poll_size*POLLING_ENTRY_SIZE;
 
 
     stime = TX_Time(p);
@@ -1020,10 +1235,10 @@ void MacDynamicTdma::sendPolling() {
 
 
 
-	printf("Node %i send polling packet %i (%i,%i,%i) size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ph->runner_ups[0],ph->runner_ups[1],ph->runner_ups[2],ch->size(),slot_count_,Scheduler::instance().clock());
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "Node %i send polling packet %i (%i,%i,%i) size %d bytes in slot %d at time %f\n",node_ID_,ch->uid(),ph->runner_ups[0],ph->runner_ups[1],ph->runner_ups[2],ch->size(),slot_count_,Scheduler::instance().clock());
 
 	/* Start a timer that expires when the packet transmission is complete. */
-    mhTxPkt_.start(p->copy(), stime);
+    mhTxPkt_.start(POLLING_FRAME, stime);
 	downtarget_->recv(p, this);
     is_seed_sent = 1;
 
@@ -1032,89 +1247,134 @@ void MacDynamicTdma::sendPolling() {
 
 int MacDynamicTdma::checkPollList(Packet *p) {
     struct polling_msg *ph = polling_msg::access(p);
-    char firstRunner = ph->runner_ups[0];
-    char secondRunner = ph->runner_ups[1];
-    char thirdRunner = ph->runner_ups[2];
-
-    if(node_ID_==firstRunner)
-        return 1;
-    else if(node_ID_==secondRunner)
-        return 2;
-    else if(node_ID_==thirdRunner)
-        return 3;
-    else
-        return 0;
+    for(int i=0;i<frame_.poll_size;i++) {
+        if(node_ID_==ph->runner_ups[i])
+            return i+1;
+    }
+    return 0;
 }
+// Order this node, its neighbors and the vslots by hash, high to low. Ties
+// keep the order this node, neighbors in discovery order, vslots.
 void MacDynamicTdma::findHashAndSort(int slot_num, int vslot_num) {
-    int nodeHash;
-    // reset hash table
-    for(int i=0;i<MAX_NODE_NUM+NUM_VSLOTS;i++) {
-        hashID[i] = 0x00;
-        hashValue[i] = 0;
+    int row = -1;
+    if(slot_num >= 0 && slot_num < max_slot_num_ && vslot_num == frame_.num_vslots)
+        row = slot_alloc_.controlBlock(slot_num);
+    if(row < 0) {
+        // not a control slot of the frame, use a scratch row
+        row = -1;
+    } else if(elect_row_gen_[row] != elect_gen_) {
+        buildElectionRow(row,slot_num,vslot_num);
+        elect_row_gen_[row] = elect_gen_;
     }
-    if(is_seed_sent)
-        nodeHash = hashSeed(slot_num,node_seed_);
-    else
-        nodeHash = hashSeed(slot_num,node_last_seed_);
 
-    int idx = 0;
-    if(is_in_net) {
-        hashID[idx] = node_ID_;
-        hashValue[idx] = nodeHash;
+    int id[MAX_ELECT_TOP_K];
+    int value[MAX_ELECT_TOP_K];
+    int len;
+    if(row < 0) {
+        // built in place of row 0, which is then stale
+        buildElectionRow(0,slot_num,vslot_num);
+        elect_row_gen_[0] = -1;
+        row = 0;
     }
-
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && table_nb_hops[i]<3) {
-            idx++;
-            //if(is_seed_sent)
-            //    printf("****************node %i with new seed %i found nb %i with seed %i\n",node_ID_,node_seed_,table_nb_id[i],table_nb_seed[i]);
-            //else
-            //    printf("****************node %i with last seed %i found nb %i with seed %i\n",node_ID_,node_last_seed_,table_nb_id[i],table_nb_seed[i]);
-            int nbHash = hashSeed(slot_num,table_nb_seed[i]);
-            hashID[idx] = table_nb_id[i];
-            hashValue[idx] = nbHash;
-        }
-
-
+    len = elect_len_[row];
+    for(int k=0;k<len;k++) {
+        id[k] = elect_id_[row*elect_k_+k];
+        value[k] = elect_value_[row*elect_k_+k];
     }
 
-    // find winning vslot
-    for(int i=0;i<vslot_num;i++) {
-            idx++;
-            int vslotHash = hashSeed(slot_num,vslots[i]);
+    // entry for this node, left empty (ID 0) while it is not in the net.
+    // Its seed changes within a frame, so it is merged in on every lookup.
+    int nodeID = 0x00;
+    int nodeHash = 0;
+    if(is_in_net) {
+        nodeID = node_ID_;
+        if(is_seed_sent)
+            nodeHash = hashSeed(slot_num,node_seed_);
+        else
+            nodeHash = hashSeed(slot_num,node_last_seed_);
+    }
 
-            hashID[idx] = vslotIDs[i];
-            hashValue[idx] = vslotHash;
+    // this node goes before every entry with an equal hash
+    int pos = 0;
+    while(pos < len && value[pos] > nodeHash)
+        pos++;
+    hash_len_ = 0;
+    for(int k=0;k<pos;k++) {
+        hashID[hash_len_] = id[k];
+        hashValue[hash_len_++] = value[k];
+    }
+    hashID[hash_len_] = nodeID;
+    hashValue[hash_len_++] = nodeHash;
+    for(int k=pos;k<len;k++) {
+        hashID[hash_len_] = id[k];
+        hashValue[hash_len_++] = value[k];
     }
+}
 
-    bubbleSort2(hashValue,hashID,idx+1);
+// Keep the elect_k_ highest hashes of the neighbors and vslots for one
+// control slot, by insertion into a short sorted list.
+void MacDynamicTdma::buildElectionRow(int row, int slot_num, int vslot_num) {
+    int *id = &elect_id_[row*elect_k_];
+    int *value = &elect_value_[row*elect_k_];
+    int len = 0;
+
+    for(int i=0;i<num_nb_+vslot_num;i++) {
+        int cand_id, cand_hash;
+        if(i < num_nb_) {
+            int n = nbIndex(table_nb_id[i]);
+            if(table_nb_hops[n]>=3)
+                continue;
+            cand_id = table_nb_id[i];
+            cand_hash = hashSeed(slot_num,table_nb_seed[n]);
+        } else {
+            cand_id = vslotIDs[i-num_nb_];
+            cand_hash = hashSeed(slot_num,vslots[i-num_nb_]);
+        }
 
+        // later candidates go after earlier ones with an equal hash
+        int pos = len;
+        while(pos > 0 && value[pos-1] < cand_hash)
+            pos--;
+        if(pos >= elect_k_)
+            continue;
+        if(len < elect_k_)
+            len++;
+        for(int k=len-1;k>pos;k--) {
+            id[k] = id[k-1];
+            value[k] = value[k-1];
+        }
+        id[pos] = cand_id;
+        value[pos] = cand_hash;
+    }
+    elect_len_[row] = len;
 }
-char MacDynamicTdma::findRunnerUpNode(int pos) {
+int MacDynamicTdma::findRunnerUpNode(int pos) {
     int is_vslot, is_in_poll;
     is_vslot = 0;
     is_in_poll = 0;
-    for(int i=0;i<NUM_VSLOTS;i++) {
-        if(vslotIDs[i]==hashID[pos])
-            is_vslot = 1;
-    }
-    for(int i=0;i<POLL_SIZE;i++) {
-        if(poll_list_[i]==hashID[pos])
-            is_in_poll = 1;
+    if(pos < hash_len_) {
+        for(int i=0;i<frame_.num_vslots;i++) {
+            if(vslotIDs[i]==hashID[pos])
+                is_vslot = 1;
+        }
+        for(int i=0;i<frame_.poll_size;i++) {
+            if(poll_list_[i]==hashID[pos])
+                is_in_poll = 1;
+        }
+        if(!is_vslot && !is_in_poll)
+            return hashID[pos];
     }
-    if(!is_vslot && !is_in_poll)
-        return hashID[pos];
 
     pos=1;
 
-    while(pos < MAX_NODE_NUM+NUM_VSLOTS) {
+    while(pos < hash_len_) {
         is_vslot = 0;
         is_in_poll = 0;
-        for(int i=0;i<NUM_VSLOTS;i++) {
+        for(int i=0;i<frame_.num_vslots;i++) {
             if(vslotIDs[i]==hashID[pos])
                 is_vslot = 1;
         }
-        for(int i=0;i<POLL_SIZE;i++) {
+        for(int i=0;i<frame_.poll_size;i++) {
             if(poll_list_[i]==hashID[pos])
                 is_in_poll = 1;
         }
@@ -1157,51 +1417,158 @@ int MacDynamicTdma::hashSeed(int slot_num, int seed) {
 void MacDynamicTdma::updateNeighborTable(Packet* p) {
     //printf("$$$$ Node %i is updating neighbor at time %f\n",node_ID_,Scheduler::instance().clock());
     struct hdr_mac_dynamic_tdma *mh = HDR_MAC_DYNAMIC_TDMA(p);
-    struct hdr_nb_info* nb = hdr_nb_info::access(p);
-    char s_id = (char) mh->srcID;
+    int s_id = mh->srcID;
     MsgType s_msg = (MsgType) mh->srcMsgType;
     u_int8_t s_seed = (u_int8_t) mh->srcSeed;
     recordOneHop(s_id);
 
     updateNeighbor(s_id,s_msg,s_seed,1);
 
-    // access frame header for Tx node's neighbors info
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(nb->nbID[i] != 0x00 && nb->nbID[i] != node_ID_) {
-            char nb_id = (char) nb->nbID[i];
-            MsgType nb_msg = (MsgType) nb->nbMsgType[i];
-            u_int8_t nb_seed = (u_int8_t) nb->nbSeed[i];
-            int nr_hops = 2;
-            if(checkOneHop(nb_id)) {
-                nr_hops = 1;
-            } else {
-                recordTwoHop(nb_id);
-                updateNeighbor(nb_id,nb_msg,nb_seed,nr_hops);
-            }
+    AppData *d = p->userdata();
+    if(d == 0 || d->type() != TDL_NB_DATA)
+        return;
+    TdlNbData *nb = (TdlNbData *) d;
+
+    // access frame Tx node's neighbors info, in the sender's order
+    for(int k=0;k<nb->nrNB_;k++) {
+        u_int32_t info = nb->nbInfo_[k];
+        int nb_id = NODE_ID_BASE + (int) (info >> 16);
+        if(nb_id != node_ID_ && !checkOneHop(nb_id)) {
+            MsgType nb_msg = (MsgType) ((info >> 8) & 0xff);
+            u_int8_t nb_seed = (u_int8_t) (info & 0xff);
+            recordTwoHop(nb_id);
+            updateNeighbor(nb_id,nb_msg,nb_seed,2);
         }
     }
 
     return;
 }
-void MacDynamicTdma::updateNeighbor(char id,MsgType msg_t,u_int8_t seed,u_int8_t hops) {
-    int idx = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]==id) {
-            idx = i;
-            break;
+
+// Attach this node's 1-hop neighbors to an outgoing frame, in order of
+// discovery, which is the order receivers add them in.
+// 1-hop neighbors not heard in this frame are 2-hop neighbors from now on.
+// A pooled control packet keeps its list from the last time it was sent.
+void MacDynamicTdma::fillNeighborInfo(Packet *p) {
+    TdlNbData *nb;
+    AppData *d = p->userdata();
+    if(d && d->type() == TDL_NB_DATA && !p->shared()) {
+        nb = (TdlNbData *) d;
+    } else {
+        nb = new TdlNbData;
+        nb->data_ = p->takedata();
+        p->setdata(nb);
+    }
+
+    // the list ends with the last word holding a neighbor
+    int count = 0;
+    int words = 0;
+    for(int w=0;w<nb_words_;w++) {
+        if(hop1_set_[w])
+            words = w + 1;
+        for(u_int32_t bits = hop1_set_[w];bits;bits &= bits - 1)
+            count++;
+    }
+    nb->reset(words, count);
+    int k = 0;
+    for(int i=0;i<num_nb_ && k<count;i++) {
+        int n = nbIndex(table_nb_id[i]);
+        if(hop1_set_[NB_WORD(n)] & NB_BIT(n))
+            nb->nbInfo_[k++] = table_nb_seed[n] |
+                (table_nb_msg_type[n] << 8) | ((u_int32_t) n << 16);
+    }
+    nb->nrNB_ = k;
+    for(int w=0;w<nb_words_;w++) {
+        if(w < words)
+            nb->nbSet_[w] = hop1_set_[w];
+        u_int32_t demote = hop1_set_[w] & ~onehop_set_[w];
+        twohop_set_[w] |= demote;
+        while(demote) {
+            int n = 32*w + ffs(demote) - 1;
+            demote &= demote - 1;
+            setHops(n, 2);
         }
-        if(table_nb_id[i]!=0x00) {
-            idx = i+1;
+    }
+}
+
+void MacDynamicTdma::growNeighborTable(int id) {
+    int need = id - NODE_ID_BASE + 1;
+    if(need <= nb_table_size_)
+        return;
+    int size = (nb_table_size_ > 0) ? nb_table_size_ : NB_TABLE_INIT_SIZE;
+    while(size < need)
+        size *= 2;
+
+    int *nb_id = new int[size];
+    u_int8_t *nb_known = new u_int8_t[size];
+    MsgType *nb_msg_type = new MsgType[size];
+    u_int8_t *nb_seed = new u_int8_t[size];
+    u_int8_t *nb_hops = new u_int8_t[size];
+    for(int i=0;i<size;i++) {
+        if(i < nb_table_size_) {
+            nb_id[i] = table_nb_id[i];
+            nb_known[i] = table_nb_known[i];
+            nb_msg_type[i] = table_nb_msg_type[i];
+            nb_seed[i] = table_nb_seed[i];
+            nb_hops[i] = table_nb_hops[i];
+        } else {
+            nb_id[i] = 0x00;
+            nb_known[i] = 0;
+            nb_msg_type[i] = MSG_0;
+            nb_seed[i] = 0;
+            nb_hops[i] = 3;         // initially all neighbor are over 2 hops
         }
     }
-    // set neighbor id
-    table_nb_id[idx] = id;
+    delete [] table_nb_id;
+    delete [] table_nb_known;
+    delete [] table_nb_msg_type;
+    delete [] table_nb_seed;
+    delete [] table_nb_hops;
+    table_nb_id = nb_id;
+    table_nb_known = nb_known;
+    table_nb_msg_type = nb_msg_type;
+    table_nb_seed = nb_seed;
+    table_nb_hops = nb_hops;
+
+    int words = (size + 31) / 32;
+    growSet(onehop_set_, words);
+    growSet(twohop_set_, words);
+    growSet(known_set_, words);
+    growSet(hop1_set_, words);
+    growSet(reach_set_, words);
+    growSet(left_set_, words);
+    nb_words_ = words;
+
+    nb_table_size_ = size;
+}
+
+// Resize a neighbor bitset to words words, new rows are not in the set
+void MacDynamicTdma::growSet(u_int32_t *&set, int words) {
+    u_int32_t *grown = new u_int32_t[words];
+    for(int w=0;w<words;w++)
+        grown[w] = (w < nb_words_) ? set[w] : 0;
+    delete [] set;
+    set = grown;
+}
+
+void MacDynamicTdma::updateNeighbor(int id,MsgType msg_t,u_int8_t seed,u_int8_t hops) {
+    growNeighborTable(id);
+    int n = nbIndex(id);
+    if(n < 0)
+        return;
+    if(!table_nb_known[n]) {
+        table_nb_known[n] = 1;
+        known_set_[NB_WORD(n)] |= NB_BIT(n);
+        table_nb_id[num_nb_++] = id;
+        elect_gen_++;
+    } else if(table_nb_seed[n] != seed || (table_nb_hops[n] >= 3) != (hops >= 3)) {
+        elect_gen_++;
+    }
     // set neighbor msg type
-    table_nb_msg_type[idx] = msg_t;
+    table_nb_msg_type[n] = msg_t;
     // set neighbor seed
-    table_nb_seed[idx] = seed;
+    table_nb_seed[n] = seed;
     // set hops
-    table_nb_hops[idx] = hops;
+    setHops(n, hops);
 
     if(is_seed_sent && seed==node_seed_) {
         node_seed_ = assignSeed();
@@ -1209,336 +1576,291 @@ void MacDynamicTdma::updateNeighbor(char id,MsgType msg_t,u_int8_t seed,u_int8_t
 
     return;
 }
-void MacDynamicTdma::recordOneHop(char id) {
-    int idx = 0;
-
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-
-        if(onehop_nb_id[i]==id) {
-            idx = i;
-            break;
-        }
-        if(onehop_nb_id[i]!=0x00) {
-            idx = i+1;
-        }
-
-    }
-
-    onehop_nb_id[idx] = id;
-    onehop_nb_found[idx] = 1;
-
-
-
+void MacDynamicTdma::recordOneHop(int id) {
+    growNeighborTable(id);
+    int n = nbIndex(id);
+    if(n >= 0)
+        onehop_set_[NB_WORD(n)] |= NB_BIT(n);
 }
-int MacDynamicTdma::checkOneHop(char id) {
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(onehop_nb_id[i]==id) {
-            if(onehop_nb_found[i]==1)
-                return 1;
-            else
-                return 0;
-        }
-    }
-    return 0;
+int MacDynamicTdma::checkOneHop(int id) {
+    int n = nbIndex(id);
+    return (n >= 0 && (onehop_set_[NB_WORD(n)] & NB_BIT(n)));
 }
 
-void MacDynamicTdma::recordTwoHop(char id) {
-    int idx = 0;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(twohop_nb_id[i]==id) {
-            idx = i;
-            break;
-        }
-        if(twohop_nb_id[i]!=0x00) {
-            idx = i+1;
-        }
-    }
-
-    twohop_nb_id[idx] = id;
-    twohop_nb_found[idx] = 1;
+void MacDynamicTdma::recordTwoHop(int id) {
+    growNeighborTable(id);
+    int n = nbIndex(id);
+    if(n >= 0)
+        twohop_set_[NB_WORD(n)] |= NB_BIT(n);
 }
-int MacDynamicTdma::checkTwoHop(char id) {
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(twohop_nb_id[i]==id) {
-            if(twohop_nb_found[i]==1)
-                return 1;
-            else
-                return 0;
-        }
-    }
-    return 0;
+int MacDynamicTdma::checkTwoHop(int id) {
+    int n = nbIndex(id);
+    return (n >= 0 && (twohop_set_[NB_WORD(n)] & NB_BIT(n)));
 }
 
-void MacDynamicTdma::bubbleSort(int *arr1,int *arr2, int len)
+
+/* Net state checkpoint. A node writes its net membership, seeds, frame
+   schedule, slot counter and neighbor table, with the neighbors heard in
+   the current frame, the slot clock and its pending timers with the time
+   left. A frame being received is saved with its header bits and its
+   neighbor list, other user data of it is lost. Restored into a later run
+   whose scheduler clock starts at the checkpoint time ("clock-set"), the
+   node picks up at the slot which was next when the state was saved.
+   Packets queued for sending and the measurements are not saved. */
+void MacDynamicTdma::saveState(FILE *f)
 {
-    int i, j, flag = 1;    // set flag to 1 to start first pass
-    int temp1, temp2;
-
-    for(i = 1; (i <= len) && flag; i++)
-    {
-      flag = 0;
-      for (j=0; j < (len -1); j++)
-     {
-           if (arr1[j+1] < arr1[j] || (arr1[j+1]==arr1[j] && arr2[j+1]<arr2[j]))
-          {
-                temp1 = arr1[j];             // swap elements
-                temp2 = arr2[j];
-                arr1[j] = arr1[j+1];
-                arr2[j] = arr2[j+1];
-                arr1[j+1] = temp1;
-                arr2[j+1] = temp2;
-                flag = 1;               // indicates that a swap occurred.
-           }
-      }
+    double now = Scheduler::instance().clock();
+
+    fprintf(f, "mac %d %d\n", node_ID_, max_slot_num_);
+    fprintf(f, "state %d %d %d %d %d %.17g %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d\n",
+        node_seed_, node_last_seed_, (int) node_msg_type_, node_msg_size_,
+        net_ID_, net_freq_, is_in_net, is_app_start, is_first_node,
+        is_net_entry, is_ack_waiting, waiting_ack_ctslot_count,
+        waiting_ct_slot, waiting_ct_slot_cnt, found_exist_node,
+        is_control_msg_required, is_cack_waiting, waiting_cack_count,
+        is_seed_sent, slot_count_, num_alloc_);
+    unsigned long rs[6];
+    rng_->get_state(rs);
+    fprintf(f, "rng %lu %lu %lu %lu %lu %lu\n", rs[0], rs[1], rs[2], rs[3], rs[4], rs[5]);
+    fprintf(f, "schedule");
+    for(int i=0;i<max_slot_num_;i++)
+        fprintf(f, " %d", tdma_schedule_[i]);
+    fprintf(f, "\nnb %d\n", num_nb_);
+    for(int i=0;i<num_nb_;i++) {
+        int id = table_nb_id[i];
+        int n = nbIndex(id);
+        fprintf(f, "%d %d %d %d %d %d\n", id, (int) table_nb_msg_type[n],
+            table_nb_seed[n], table_nb_hops[n], checkOneHop(id), checkTwoHop(id));
     }
-    return;   //arrays are passed to functions by address; nothing is returned
-}
 
-void MacDynamicTdma::bubbleSort2(int *arr1,char *arr2, int len)
-{
-    int i, j, flag = 1;    // set flag to 1 to start first pass
-    int temp1;
-    char temp2;
-    for(i = 1; (i <= len) && flag; i++)
-    {
-      flag = 0;
-      for (j=0; j < (len -1); j++)
-     {
-           if (arr1[j+1] > arr1[j])
-          {
-                temp1 = arr1[j];             // swap elements
-                temp2 = arr2[j];
-                arr1[j] = arr1[j+1];
-                arr2[j] = arr2[j+1];
-                arr1[j+1] = temp1;
-                arr2[j+1] = temp2;
-                flag = 1;               // indicates that a swap occurred.
-           }
-      }
+    // slot clock and timers, -1 if a timer is not pending
+    fprintf(f, "clock %.17g %lu\n", slot_clock_->next(), slot_clock_->tick());
+    fprintf(f, "timers %d %d %d %.17g %d %.17g %d %d %.17g %d\n",
+        (int) tx_state_, (int) rx_state_, radio_active_,
+        mhTxPkt_.busy() ? mhTxPkt_.expire() : -1.0, mhTxPkt_.frameType(),
+        mhBkOff_.busy() ? mhBkOff_.expire() : -1.0, is_back_off,
+        is_rec_in_back_off,
+        recT_.status() == TIMER_PENDING ? recT_.due() - now : -1.0,
+        record_time);
+    if(!mhRxPkt_.busy()) {
+        fprintf(f, "rx -1\n");
+    } else {
+        Packet *p = pktRx_->copy();
+        fprintf(f, "rx %.17g %d\n", mhRxPkt_.expire(), Packet::hdrlen_);
+        unsigned char *bits = p->bits();
+        for(int i=0;i<Packet::hdrlen_;i++)
+            fprintf(f, (i % 32 == 31) ? "%02x\n" : "%02x", bits[i]);
+        AppData *d = p->userdata();
+        if(d && d->type() == TDL_NB_DATA) {
+            TdlNbData *nb = (TdlNbData *) d;
+            fprintf(f, "\nrxnb %d %d", nb->words_, nb->nrNB_);
+            for(int w=0;w<nb->words_;w++)
+                fprintf(f, " %u", nb->nbSet_[w]);
+            for(int k=0;k<nb->nrNB_;k++)
+                fprintf(f, " %u", nb->nbInfo_[k]);
+            fprintf(f, "\n");
+        } else
+            fprintf(f, "\nrxnb -1 0\n");
+        Packet::free(p);
     }
-    return;   //arrays are passed to functions by address; nothing is returned
+    fprintf(f, "end\n");
 }
 
-int MacDynamicTdma::assignSlots(int id,int msg_t,int rate) {
-    int slotPeriod = 0;
-    int max_msg_size = 0;
-    switch(msg_t) {
-        case 1:
-            // Message Type 1 RAP message require 1/10 s update rate with highest priority
-            slotPeriod = (int) (rate/slot_time_);
-            max_msg_size = 10005;   // double max. size when double BW
-            break;
-        case 2:
-            // Message Type 2 target track message require 1/2 s update rate with second highest priority
-            slotPeriod = (int) (rate/slot_time_);
-            max_msg_size = 2005;
-            break;
-        case 3:
-            // Message Type 3 position report message require 1/2 s update rate with lowest priority
-            slotPeriod = (int) (rate/slot_time_);
-            max_msg_size = 55;
-            break;
-
-        case 0:
-            return 1;
+// Returns 0 if the file has no state of this node
+int MacDynamicTdma::loadState(FILE *f)
+{
+    char tok[64];
+    int id, slots;
+
+    // find the section of this node
+    for(;;) {
+        if(fscanf(f, "%63s", tok) != 1)
+            return 0;
+        if(strcmp(tok, "mac") != 0)
+            continue;
+        if(fscanf(f, "%d %d", &id, &slots) != 2)
+            return 0;
+        if(id == node_ID_ && slots == max_slot_num_)
             break;
     }
-            int slotPayloadSize = 516;  // use 516 for double bandwidth
-            // in this algorithm, we only assign slot based on maximum allow size of each message.
-            int slotsReq = (int) ceil((double) (max_msg_size/slotPayloadSize)+0.5);
-            if(slotsReq<1)
-                slotsReq=1;
-            int periodCount = (int) (max_slot_num_/slotPeriod);
-            int blockCount = (int) (slotPeriod/20);
-
-            int is_assigned_in_frame = 0;
-            printf("Node %i Current message require %i bytes requires slot period = %i slots. %i periods in a cycle. %i blocks in a period. %i slot reserved in a period\n", id,max_msg_size,slotPeriod, periodCount, blockCount, slotsReq);
-            //guarantee 1 slot every 2 seconds
-            tdma_schedule_[(id-65)+1] = id;
-            tdma_schedule_[(id-65)+1+40] = id;
-            tdma_schedule_[(id-65)+1+80] = id;
-            tdma_schedule_[(id-65)+1+120] = id;
-            tdma_schedule_[(id-65)+1+160] = id;
-            for(int i = 0;i<periodCount;i++) {
-                int current_block = 0;
-                int slotPointer = 1;
-                int slotsAssigned = 0;
-                int is_period_full = 0;
-                int is_assigned_in_period = 0;
-                for(int n = 0;n<slotPeriod;n++) {
-                    if(tdma_schedule_[i*slotPeriod+n]==id)
-                        slotsAssigned++;
-                }
-                int f_pos = (id-65) % 16;
-                slotPointer = f_pos;
-                //int startP = 0;
-                while(slotsAssigned<slotsReq && !is_period_full) {
-
-                    //printf("p %i ",slotPointer);
-                    //printf("r %i ",tdma_schedule_[i*slotPeriod+20*current_block+slotPointer+1]);
-                    if(tdma_schedule_[i*slotPeriod+20*current_block+slotPointer+1]>0) {
-                        int cnt_blk = 0;
-                        for(int l=1;l<20;l++) {
-                            if(tdma_schedule_[i*slotPeriod+20*current_block+l]==-1)
-                                cnt_blk++;
-
-                        }
-                        if(cnt_blk==0) { //if this block full, move to next block
-                            if(current_block<blockCount-1) {
-                                current_block++;
-                                slotPointer = f_pos;
-                            } else {
-                                current_block = 0;
-                                slotPointer = f_pos;
-                            }
-                        } else {
-                            //move slot pointer
-                            slotPointer = (slotPointer+16) % 19;
-                        }
-
-                    } else {
-                        // if slot is free
-                        // assign 1 slot
-                        tdma_schedule_[i*slotPeriod+20*current_block+slotPointer+1] = id;
-                        slotsAssigned++;
-                        is_assigned_in_period = 1;
-                        is_assigned_in_frame = 1;
-                        // move to next block
-                        if(current_block<blockCount-1) {
-                            current_block++;
-                            slotPointer = f_pos;
-                        } else {
-                            current_block = 0;
-                            slotPointer = f_pos;
-                        }
-                    }
-
-                    int cnt = 0;
-
-
-                    for(int n = 0;n<slotPeriod;n++) {
-
-                    if(tdma_schedule_[i*slotPeriod+n]==-1)
-                        cnt++;
-                    }
-                    //printf("fp %i ",cnt);
 
-                    if(cnt==0)
-                        is_period_full = 1;
+    int seed, last_seed, msg_t, net;
+    if(fscanf(f, " state %d %d %d %d %d %lf %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d",
+        &seed, &last_seed, &msg_t, &node_msg_size_, &net, &net_freq_,
+        &is_in_net, &is_app_start, &is_first_node, &is_net_entry,
+        &is_ack_waiting, &waiting_ack_ctslot_count, &waiting_ct_slot,
+        &waiting_ct_slot_cnt, &found_exist_node, &is_control_msg_required,
+        &is_cack_waiting, &waiting_cack_count, &is_seed_sent, &slot_count_,
+        &num_alloc_) != 21)
+        return 0;
+    node_seed_ = (u_int8_t) seed;
+    node_last_seed_ = (u_int8_t) last_seed;
+    node_msg_type_ = (MsgType) msg_t;
+    net_ID_ = (u_int8_t) net;
 
+    unsigned long rs[6];
+    if(fscanf(f, " rng %lu %lu %lu %lu %lu %lu", &rs[0], &rs[1], &rs[2], &rs[3], &rs[4], &rs[5]) != 6)
+        return 0;
 
+    if(fscanf(f, "%63s", tok) != 1 || strcmp(tok, "schedule") != 0)
+        return 0;
+    for(int i=0;i<max_slot_num_;i++) {
+        if(fscanf(f, "%d", &tdma_schedule_[i]) != 1)
+            return 0;
+    }
+    // the allocator places everybody again at its next update
+    slot_alloc_.init(tdma_schedule_,max_slot_num_,frame_);
 
+    int cnt;
+    if(fscanf(f, " nb %d", &cnt) != 1)
+        return 0;
+    for(int i=0;i<cnt;i++) {
+        int nb_msg_t, nb_seed, hops, one, two;
+        if(fscanf(f, "%d %d %d %d %d %d", &id, &nb_msg_t, &nb_seed, &hops, &one, &two) != 6)
+            return 0;
+        updateNeighbor(id, (MsgType) nb_msg_t, (u_int8_t) nb_seed, (u_int8_t) hops);
+        if(one)
+            recordOneHop(id);
+        if(two)
+            recordTwoHop(id);
+    }
+    // updateNeighbor() may have drawn a new seed
+    node_seed_ = (u_int8_t) seed;
+    rng_->set_seed(rs);
+    elect_gen_++;
+
+    double next, tx_left, bk_left, rec_left, rx_left;
+    unsigned long tick;
+    int tx_st, rx_st, radio, frame_type, len;
+    if(fscanf(f, " clock %lf %lu", &next, &tick) != 2)
+        return 0;
+    if(fscanf(f, " timers %d %d %d %lf %d %lf %d %d %lf %d", &tx_st, &rx_st,
+        &radio, &tx_left, &frame_type, &bk_left, &is_back_off,
+        &is_rec_in_back_off, &rec_left, &record_time) != 10)
+        return 0;
+    if(fscanf(f, " rx %lf", &rx_left) != 1)
+        return 0;
+    Packet *p = 0;
+    if(rx_left >= 0) {
+        if(fscanf(f, "%d", &len) != 1 || len != Packet::hdrlen_)
+            return 0;
+        p = Packet::alloc();
+        unsigned char *bits = p->bits();
+        for(int i=0;i<len;i++) {
+            unsigned int b;
+            if(fscanf(f, "%2x", &b) != 1) {
+                Packet::free(p);
+                return 0;
+            }
+            bits[i] = (unsigned char) b;
+        }
+        // callbacks of the saving run mean nothing here
+        HDR_CMN(p)->xmit_failure_ = 0;
+        HDR_CMN(p)->xmit_failure_data_ = 0;
+        int words, nrNB;
+        if(fscanf(f, " rxnb %d %d", &words, &nrNB) != 2) {
+            Packet::free(p);
+            return 0;
+        }
+        if(words >= 0) {
+            TdlNbData *nb = new TdlNbData;
+            nb->reset(words, nrNB);
+            p->setdata(nb);
+            for(int w=0;w<words;w++) {
+                if(fscanf(f, "%u", &nb->nbSet_[w]) != 1) {
+                    Packet::free(p);
+                    return 0;
+                }
+            }
+            for(int k=0;k<nrNB;k++) {
+                if(fscanf(f, "%u", &nb->nbInfo_[k]) != 1) {
+                    Packet::free(p);
+                    return 0;
                 }
-
             }
+        }
+    }
 
-    if(is_assigned_in_frame)
-        return 1;
-    else
-        return 0;
+    if(is_in_net)
+        nodeInNetCnt++;
+    ((WirelessPhy *) netif_)->setFreq(net_freq_);
+    radioSwitch(radio);
+
+    // the clock is shared, every node restores the same tick
+    slot_clock_->restore(next, tick);
+    slot_clock_->wake(this);
+    last_tick_ = tick;
+    tx_state_ = (MacState) tx_st;
+    rx_state_ = (MacState) rx_st;
+    if(tx_left >= 0)
+        mhTxPkt_.start(frame_type, tx_left);
+    if(bk_left >= 0)
+        mhBkOff_.restart(bk_left);
+    if(p) {
+        pktRx_ = p;
+        mhRxPkt_.start(p, rx_left);
+    }
+    if(rec_left >= 0)
+        recT_.resched(rec_left);
+    return 1;
 }
 
-int MacDynamicTdma::findNrHops(char id) {
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]==id)
-            return table_nb_hops[i];
-    }
+// Message type as used by the slot allocator, 0 if nothing to send
+int MacDynamicTdma::memberMsgType(MsgType msg_t) {
+    if(msg_t==MSG_1 || msg_t==MSG_2 || msg_t==MSG_3)
+        return (int) msg_t;
+    return 0;
+}
+
+int MacDynamicTdma::findNrHops(int id) {
+    int n = nbIndex(id);
+    if(n >= 0 && table_nb_known[n])
+        return table_nb_hops[n];
     return 3;
 }
 void MacDynamicTdma::allocateDataSlots() {
 
     //find nb
     int memberCnt = 1;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && (table_nb_hops[i]==1 || table_nb_hops[i]==2)) {
+    for(int i=0;i<num_nb_;i++) {
+        int n = nbIndex(table_nb_id[i]);
+        if(table_nb_hops[n]==1 || table_nb_hops[n]==2) {
             memberCnt++;
         }
     }
-    int *members = new int[memberCnt];
-    int *memberMsgT = new int[memberCnt];
-    int *memberReqRate = new int[memberCnt];
-    int *memberRateAdj = new int[memberCnt];
+    if(memberCnt > members_size_) {
+        delete [] members_;
+        members_size_ = 2*memberCnt;
+        members_ = new tdma_member[members_size_];
+    }
     //add a node to the list
     int idx = 0;
-    members[idx] = node_ID_;
-    memberRateAdj[idx] = 0;
-    if(node_msg_type_==MSG_1) {
-        memberMsgT[idx] = 1;
-
-    } else if(node_msg_type_==MSG_2) {
-        memberMsgT[idx] = 2;
-
-    } else if(node_msg_type_==MSG_3) {
-        memberMsgT[idx] = 3;
-
-    } else {
-        memberMsgT[idx] = 0;
-
-    }
+    members_[idx].id = node_ID_;
+    members_[idx].msg_t = memberMsgType(node_msg_type_);
     idx++;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00 && (table_nb_hops[i]==1 || table_nb_hops[i]==2)) {
-                members[idx] = (int) table_nb_id[i];
-                memberRateAdj[idx] = 0;
-                if(table_nb_msg_type[i]==MSG_1) {
-                    memberMsgT[idx] = 1;
-
-                } else if(table_nb_msg_type[i]==MSG_2) {
-                    memberMsgT[idx] = 2;
-
-                } else if(table_nb_msg_type[i]==MSG_3) {
-                    memberMsgT[idx] = 3;
-
-                } else {
-                    memberMsgT[idx] = 0;
-
-                }
-                idx++;
-        }
-
-    }
-    //sorting
-
-    bubbleSort(memberMsgT,members,memberCnt);
-
-    for(int i = 0;i<memberCnt;i++) {
-        if(memberMsgT[i] == 1) {
-            memberReqRate[i] = 10;
-        } else if(memberMsgT[i] == 2) {
-            memberReqRate[i] = 2;
-        } else if(memberMsgT[i] == 3) {
-            memberReqRate[i] = 2;
-        } else {
-            memberReqRate[i] = 0;
+    for(int i=0;i<num_nb_;i++) {
+        int n = nbIndex(table_nb_id[i]);
+        if(table_nb_hops[n]==1 || table_nb_hops[n]==2) {
+            members_[idx].id = table_nb_id[i];
+            members_[idx].msg_t = memberMsgType(table_nb_msg_type[n]);
+            idx++;
         }
-
-    }
-    // reset tdma schedule
-    for(int i=0;i<max_slot_num_;i++){
-        int m = i % 20;
-        if(m!=0)
-            tdma_schedule_[i] = -1;
     }
 
+    // only members whose placement can change are placed again
+    num_alloc_ = slot_alloc_.update(members_,memberCnt);
+    // the slots to skip are found again at the next tick
+    wakeSlots();
 
 
-    int allocated = 0;
-    idx = 0;
-    num_alloc_ = 0;
-    for(int idx=0;idx<memberCnt;idx++) {
-        allocated = assignSlots(members[idx],memberMsgT[idx],memberReqRate[idx]);
-        if(allocated)
-            num_alloc_++;
-    }
-
-
-    printf("Node %i reserve slot ",node_ID_);
-    for(int j=0;j<max_slot_num_;j++) {
+    if(TDL_LOG_ON(log_, TDL_LOG_ALLOC, TDL_LOG_DEBUG)) {
+        printf("Node %i reserve slot ",node_ID_);
+        for(int j=0;j<max_slot_num_;j++) {
             if(tdma_schedule_[j]==(int) node_ID_)
                 printf("%i, ",j);
-
+        }
+        printf("\n");
     }
-    printf("\n");
 
     return;
 }
@@ -1546,13 +1868,13 @@ void MacDynamicTdma::allocateDataSlots() {
 
 
 void MacDynamicTdma::accessControlSlots() {
-    findHashAndSort(slot_count_,NUM_VSLOTS);
-    char winning_node = hashID[0];
-    printf("Node %i found %i as winning node for control slot %i\n",node_ID_,winning_node,slot_count_);
+    findHashAndSort(slot_count_,frame_.num_vslots);
+    int winning_node = hashID[0];
+    TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i found %i as winning node for control slot %i\n",node_ID_,winning_node,slot_count_);
     if(!is_in_net) {
         if(is_net_entry && !is_ack_waiting) {
             int is_vslot_win = 0;
-            for(int i=0;i<NUM_VSLOTS;i++) {
+            for(int i=0;i<frame_.num_vslots;i++) {
                 if(vslotIDs[i]==winning_node)
                     is_vslot_win = 1;
             }
@@ -1563,7 +1885,7 @@ void MacDynamicTdma::accessControlSlots() {
             }
 
         } else if(is_net_entry && is_ack_waiting) {
-            printf("****Node %i is waiting ACK message for %i slot\n",node_ID_,waiting_ack_ctslot_count);
+            TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "****Node %i is waiting ACK message for %i slot\n",node_ID_,waiting_ack_ctslot_count);
         }
     } else {
         // if a node is already in the net
@@ -1572,7 +1894,7 @@ void MacDynamicTdma::accessControlSlots() {
             // if there is ne req in queue, send ACK first
             if(nePkt_) {
                 struct hdr_mac_dynamic_tdma *mh = HDR_MAC_DYNAMIC_TDMA(nePkt_);
-                char reqID = mh->srcID;
+                int reqID = mh->srcID;
                 MsgType reqMsgT = mh->srcMsgType;
                 u_int8_t reqSeed = mh->srcSeed;
                 // update neighbor table with new entry
@@ -1600,14 +1922,14 @@ void MacDynamicTdma::accessControlSlots() {
 
             if(is_control_msg_required) {
                 // send control message
-                printf("Node %i win control slot %i and have something to send\n",node_ID_,slot_count_);
+                TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i win control slot %i and have something to send\n",node_ID_,slot_count_);
                 sendControl();
                 is_control_msg_required = 0;
                 //reallocate data slot
                 //allocateDataSlots();
             } else {
                 // send polling message
-                printf("Node %i win control slot %i but have nothing to send\n",node_ID_,slot_count_);
+                TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i win control slot %i but have nothing to send\n",node_ID_,slot_count_);
                 sendPolling();
             }
         } else {
@@ -1618,27 +1940,44 @@ void MacDynamicTdma::accessControlSlots() {
     return;
 }
 
-void MacDynamicTdma::findLeavingNodes() {
-    double nl_time;
-    for(int i=0;i<MAX_NODE_NUM-1;i++) {
-        if(table_nb_id[i]!=0x00) {
-            if(checkOneHop(table_nb_id[i])) {
-                table_nb_hops[i] = 1;
-            } else if(checkTwoHop(table_nb_id[i])) {
-                table_nb_hops[i] = 2;
-            } else {
-                if(table_nb_hops[i] < 3) {
-                    table_nb_hops[i] = 3;
-                    //record leaving time
-                    char out[100];
-                    nl_time = Scheduler::instance().clock();
-                    sprintf(out, "recordNLTime %i %i %f", node_ID_,table_nb_id[i],nl_time);
-                    Tcl& tcl = Tcl::instance();
-                    tcl.eval(out);
-                }
-            }
+// Neighbors heard in this frame take their hops from it, the ones within
+// 2 hops which were not heard have left.
+int MacDynamicTdma::findLeavingNodes() {
+    double nl_time = Scheduler::instance().clock();
+    int changed = 0;
+    int any_left = 0;
+    for(int w=0;w<nb_words_;w++) {
+        u_int32_t one = onehop_set_[w] & known_set_[w];
+        u_int32_t two = twohop_set_[w] & known_set_[w] & ~one;
+        u_int32_t left = reach_set_[w] & ~(one | two);
+        // joining or leaving the election
+        if(((one | two) & ~reach_set_[w]) || left) {
+            elect_gen_++;
+            changed = 1;
         }
+        u_int32_t change = (one & ~hop1_set_[w]) | (two & hop1_set_[w]) |
+                           ((one | two) & ~reach_set_[w]) | left;
+        left_set_[w] = left;
+        if(left)
+            any_left = 1;
+        while(change) {
+            int n = 32*w + ffs(change) - 1;
+            change &= change - 1;
+            if(one & NB_BIT(n))
+                setHops(n, 1);
+            else if(two & NB_BIT(n))
+                setHops(n, 2);
+            else
+                setHops(n, 3);
+        }
+    }
+    //record leaving time, in order of discovery
+    for(int i=0;any_left && i<num_nb_;i++) {
+        int n = nbIndex(table_nb_id[i]);
+        if(left_set_[NB_WORD(n)] & NB_BIT(n))
+            TdlStats::record(TDL_NL_TIME, "%i %i %f", node_ID_,table_nb_id[i],nl_time);
     }
+    return changed;
 }
 
 
@@ -1649,10 +1988,12 @@ void MacDynamicTdma::findLeavingNodes() {
    occupy one slot time,
    radio turned on for the whole slot.
 */
-void MacDynamicTdma::slotHandler(Event *e)
+void MacDynamicTdma::slotTick()
 {
-	// Restart timer for next slot.
-	mhSlot_.start((Packet *)e, slot_time_);
+	// count the slots skipped since the last tick
+	unsigned long tick = slot_clock_->tick();
+	slot_count_ += (int) (tick - 1 - last_tick_);
+	last_tick_ = tick;
 
 	// reset slot count for next frame.
 	if ((slot_count_ == max_slot_num_) || (slot_count_ == FIRST_ROUND)) {
@@ -1661,8 +2002,8 @@ void MacDynamicTdma::slotHandler(Event *e)
 		//reallocate data slot at the end of cycle, if a node is operating in the net
 		if(is_in_net) {
 
-            printf("******* node %i update neighbor table in new frame\n",node_ID_);
-		    findLeavingNodes();
+            TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_DEBUG, "******* node %i update neighbor table in new frame\n",node_ID_);
+		    nb_stable_ = !findLeavingNodes();
 		    // reallocate data slot
 		    //printf("******* node %i reallocate data slot in new frame\n",node_ID_);
             allocateDataSlots();
@@ -1672,21 +2013,16 @@ void MacDynamicTdma::slotHandler(Event *e)
 		node_last_seed_ = node_seed_;
 		if(!is_net_entry && slot_count_ == max_slot_num_) {
             node_seed_ = assignSeed();
-            printf("Node %i has new seed %i\n",node_ID_,node_seed_);
+            TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_INFO, "Node %i has new seed %i\n",node_ID_,node_seed_);
 		}
 		if(is_conflict_in_frame) {
-            char out[100];
             double ctime = Scheduler::instance().clock();
 
             if(num_conflicts==0) {
                 is_conflict_in_frame = 0;
-                sprintf(out, "recordResolveTime %i %i %i %f", node_ID_,2,num_conflicts,ctime);
-                Tcl& tcl = Tcl::instance();
-                tcl.eval(out);
+                TdlStats::record(TDL_RESOLVE_TIME, "%i %i %i %f", node_ID_,2,num_conflicts,ctime);
             } else {
-                sprintf(out, "recordResolveTime %i %i %i %f", node_ID_,1,num_conflicts,ctime);
-                Tcl& tcl = Tcl::instance();
-                tcl.eval(out);
+                TdlStats::record(TDL_RESOLVE_TIME, "%i %i %i %f", node_ID_,1,num_conflicts,ctime);
             }
 		}
 		num_conflicts = 0;
@@ -1695,12 +2031,8 @@ void MacDynamicTdma::slotHandler(Event *e)
         slot_count_ = 0;
 
         //reset 1-hop and 2-hop neighbors found in previous frame
-        for(int i=0;i<MAX_NODE_NUM-1;i++) {
-            onehop_nb_id[i] = 0x00;
-            onehop_nb_found[i] = 0;
-            twohop_nb_id[i] = 0x00;
-            twohop_nb_found[i] = 0;
-        }
+        memset(onehop_set_, 0, nb_words_*sizeof(u_int32_t));
+        memset(twohop_set_, 0, nb_words_*sizeof(u_int32_t));
 	}
 
 
@@ -1710,7 +2042,7 @@ void MacDynamicTdma::slotHandler(Event *e)
         if(!is_net_entry) {
             is_net_entry = 1;
             waiting_ct_slot_cnt = 0;
-            waiting_ct_slot = (rand() % 5);
+            waiting_ct_slot = rng_->uniform(5);
             if(waiting_ct_slot==0)
                 waiting_ct_slot=1;
 
@@ -1740,7 +2072,7 @@ void MacDynamicTdma::slotHandler(Event *e)
                     waiting_ack_ctslot_count++;
                 // waiting for ack message
                 if(waiting_ack_ctslot_count>=5) {
-                        printf("*****Waiting time for ACK for Node %i has ended.\n",node_ID_);
+                        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "*****Waiting time for ACK for Node %i has ended.\n",node_ID_);
                         is_net_entry = 0;
                         is_ack_waiting = 0;
                         waiting_ack_ctslot_count = 0;
@@ -1750,20 +2082,17 @@ void MacDynamicTdma::slotHandler(Event *e)
 
                 } else if(is_net_entry && waiting_ct_slot_cnt>=waiting_ct_slot) {
                     if(found_exist_node) {
-                        printf("Node %i found exist node in net %i\n",node_ID_,net_ID_);
+                        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i found exist node in net %i\n",node_ID_,net_ID_);
                         accessControlSlots();
                     } else {
-                        printf("Node %i is the first node in net %i\n",node_ID_,net_ID_);
+                        TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "Node %i is the first node in net %i\n",node_ID_,net_ID_);
                         is_in_net = 1;
                         is_net_entry = 0;
                         //printf("******* node %i allocate data slot as first node\n",node_ID_);
                         allocateDataSlots();
                         nodeInNetCnt++;
-                        char out[100];
                         ne_ack_rtime = Scheduler::instance().clock();
-                        sprintf(out, "recordNETime %i %i %f", node_ID_,nodeInNetCnt,ne_ack_rtime-first_pkt_atime);
-                        Tcl& tcl = Tcl::instance();
-                        tcl.eval(out);
+                        TdlStats::record(TDL_NE_TIME, "%i %i %f", node_ID_,nodeInNetCnt,ne_ack_rtime-first_pkt_atime);
                     }
                 }
 		    } else {
@@ -1771,7 +2100,7 @@ void MacDynamicTdma::slotHandler(Event *e)
                     waiting_cack_count++;
                 }
                 if(waiting_cack_count>=5) {
-                    printf("*****Waiting time for control ACK for Node %i has ended.\n",node_ID_);
+                    TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_INFO, "*****Waiting time for control ACK for Node %i has ended.\n",node_ID_);
                     is_control_msg_required = 1;
                     is_cack_waiting = 0;
                     waiting_cack_count = 0;
@@ -1800,10 +2129,167 @@ void MacDynamicTdma::slotHandler(Event *e)
 	}
 
     slot_count_++;
+    skipIdleSlots();
     return;
 
 }
 
+/* With skip_idle_slots_ set, a node listening with the radio on lets the
+   slot clock skip the free slots and the data slots of other nodes which
+   follow. Such a tick would only turn the radio off and on again at the
+   same instant. It stops before the end of the frame, and anything that
+   turns the radio off or changes the schedule wakes the node again.
+   With an energy model such a tick still moves the radio between IDLE
+   and SLEEP (see WirelessPhy::node_sleep()), the phy charges the skipped
+   ticks in one go before it next uses the energy, see skip_ticks(). */
+void MacDynamicTdma::skipIdleSlots()
+{
+    WirelessPhy *phy = (WirelessPhy *) netif_;
+
+    if(!skip_idle_slots_ || !radio_active_)
+        return;
+    if(phy->getFreq() != net_freq_)
+        return;
+    // the next tick starts the net entry
+    if(!is_in_net && is_app_start && !is_net_entry)
+        return;
+
+    int n = 0;
+    for(int s = slot_count_;s<max_slot_num_;s++) {
+        int owner = tdma_schedule_[s];
+        if(owner != -1 && (owner <= 0 || owner == (int) node_ID_))
+            break;
+        n++;
+    }
+    if(n > 0) {
+        slot_clock_->skip(this, n);
+        phy->skip_ticks(slot_clock_->next(), slot_time_, n);
+    }
+}
+
+// Tick the node again from the next slot on
+void MacDynamicTdma::wakeSlots()
+{
+    if(skip_idle_slots_) {
+        syncSlotCount();
+        slot_clock_->wake(this);
+        ((WirelessPhy *) netif_)->end_skip();
+    }
+}
+
+// Bring slot_count_ up to date with the slots skipped so far
+void MacDynamicTdma::syncSlotCount()
+{
+    unsigned long tick = slot_clock_->tick();
+    slot_count_ += (int) (tick - last_tick_);
+    last_tick_ = tick;
+}
+
+/* With fast_forward_ set, a node is quiescent when it has nothing queued,
+   waits for no frame, ACK or back off and no neighbor joined or left at
+   the last frame start. Until a packet reaches it every tick would repeat
+   an idle frame, so once all nodes of its slot clock are quiescent the
+   clock stops ticking and idleAdvance() applies the ticks later on. The
+   polling in the skipped control slots is not simulated: the neighbors
+   count as heard, the seeds they draw are passed on by spreadIdleSeed(). */
+int MacDynamicTdma::quiescent()
+{
+    if(!fast_forward_ || slot_count_ < 0)
+        return 0;
+    if(pktTx_ || callback_ || ctrlPkt_ || nePkt_ || is_back_off)
+        return 0;
+    if(tx_state_ != MAC_IDLE || rx_state_ != MAC_IDLE)
+        return 0;
+    WirelessPhy *phy = (WirelessPhy *) netif_;
+    if(phy->node()->energy_model())
+        return 0;
+    // a node whose application has not started stays silent
+    if(!is_app_start)
+        return !is_in_net;
+    return is_in_net && nb_stable_ && !is_net_entry && !is_ack_waiting &&
+           !is_control_msg_required && !is_cack_waiting && !is_conflict_in_frame;
+}
+
+int MacDynamicTdma::ticksToFrame()
+{
+    syncSlotCount();
+    return max_slot_num_ - slot_count_ + 1;
+}
+
+// The next n ticks of a quiescent node: its reserved slots are counted
+// and every frame start re-draws the seed
+void MacDynamicTdma::idleAdvance(int n)
+{
+    syncSlotCount();
+    last_tick_ += n;
+    while(n > 0) {
+        if(slot_count_ == max_slot_num_)
+            idleFrame();
+        int k = max_slot_num_ - slot_count_;
+        if(k > n)
+            k = n;
+        for(int i=slot_count_;i<slot_count_+k;i++) {
+            if(tdma_schedule_[i] == (int) node_ID_)
+                num_slots_reserved++;
+        }
+        slot_count_ += k;
+        n -= k;
+    }
+}
+
+// Frame start of a skipped frame, the part of slotTick() which does not
+// depend on what was heard. The neighbors count as heard in the new frame.
+void MacDynamicTdma::idleFrame()
+{
+    for(int w=0;w<nb_words_;w++) {
+        onehop_set_[w] = known_set_[w] & hop1_set_[w];
+        twohop_set_[w] = known_set_[w] & reach_set_[w] & ~hop1_set_[w];
+    }
+    is_seed_sent = 0;
+    node_last_seed_ = node_seed_;
+    if(!is_net_entry) {
+        node_seed_ = assignSeed();
+        TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_INFO, "Node %i has new seed %i\n",node_ID_,node_seed_);
+        spreadIdleSeed();
+    }
+    num_conflicts = 0;
+    slot_count_ = 0;
+}
+
+// The skipped frame carries the new seed: the 1-hop neighbors hear it in
+// this node's slot, their 1-hop neighbors in their neighbor lists. Only
+// the nodes of this slot clock are skipping frames as well.
+void MacDynamicTdma::spreadIdleSeed()
+{
+    for(int w=0;w<nb_words_;w++) {
+        for(u_int32_t bits = hop1_set_[w];bits;bits &= bits - 1) {
+            MacDynamicTdma *m = macOf(NODE_ID_BASE + 32*w + ffs(bits) - 1);
+            if(m == 0 || m->slot_clock_ != slot_clock_)
+                continue;
+            m->idleSeedHeard(node_ID_, node_seed_, 1);
+            for(int w2=0;w2<m->nb_words_;w2++) {
+                for(u_int32_t b2 = m->hop1_set_[w2];b2;b2 &= b2 - 1) {
+                    MacDynamicTdma *m2 = macOf(NODE_ID_BASE + 32*w2 + ffs(b2) - 1);
+                    if(m2 != 0 && m2 != this && m2->slot_clock_ == slot_clock_)
+                        m2->idleSeedHeard(node_ID_, node_seed_, 2);
+                }
+            }
+        }
+    }
+}
+
+// Seed of node id heard in a skipped frame, hops away
+void MacDynamicTdma::idleSeedHeard(int id, u_int8_t seed, int hops)
+{
+    int n = nbIndex(id);
+    if(n < 0 || !table_nb_known[n] || table_nb_hops[n] != hops)
+        return;
+    if(table_nb_seed[n] != seed) {
+        table_nb_seed[n] = seed;
+        elect_gen_++;
+    }
+}
+
 void MacDynamicTdma::recvHandler(Event *e)
 {
 	u_int32_t dst, src;
@@ -1840,7 +2326,7 @@ void MacDynamicTdma::recvHandler(Event *e)
 		    // check type of net entry message whether it is request(1) or ACK(2)
 		    if(ne->entry_msg == 1) {
 		        if(is_in_net) {
-                printf("$$$$ Node %i receive net entry request from %i\n",node_ID_,mh->srcID);
+                TDL_LOG(log_, TDL_LOG_NB, TDL_LOG_INFO, "$$$$ Node %i receive net entry request from %i\n",node_ID_,mh->srcID);
 
                 // Add ne to queue, and wait for next available control slot to create and send ACK and also update neighbor
                 // if there is already another ne request in queue, ignore incoming new ne request
@@ -1851,18 +2337,15 @@ void MacDynamicTdma::recvHandler(Event *e)
 		        updateNeighborTable(pktRx_);
 
 		        if(ne->entry_ID==node_ID_) {
-                    printf("$$$$**** Node %i allocate data slot after receive net entry ACK from %i at time %f\n",node_ID_,mh->srcID,Scheduler::instance().clock());
+                    TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_INFO, "$$$$**** Node %i allocate data slot after receive net entry ACK from %i at time %f\n",node_ID_,mh->srcID,Scheduler::instance().clock());
                     is_net_entry = 0;
                     is_ack_waiting = 0;
                     is_in_net = 1;
                     //allocate data slot
                     allocateDataSlots();
                     nodeInNetCnt++;
-                    char out[100];
                     ne_ack_rtime = Scheduler::instance().clock();
-                    sprintf(out, "recordNETime %i %i %f", node_ID_,nodeInNetCnt,ne_ack_rtime-first_pkt_atime);
-                    Tcl& tcl = Tcl::instance();
-                    tcl.eval(out);
+                    TdlStats::record(TDL_NE_TIME, "%i %i %f", node_ID_,nodeInNetCnt,ne_ack_rtime-first_pkt_atime);
 		        } else {
 		        // existing neighbor receive ACK
                     if(is_in_net) {
@@ -1897,7 +2380,7 @@ void MacDynamicTdma::recvHandler(Event *e)
                     // if request is received and no other request in buffer, add request to buffer
                     ctrlPkt_ = pktRx_;
                 } else if(cm->control_msgtype==2) {
-                    printf("******* node %i reallocate data slot after receive control ACK for update in %i\n",node_ID_,cm->control_ID);
+                    TDL_LOG(log_, TDL_LOG_ALLOC, TDL_LOG_INFO, "******* node %i reallocate data slot after receive control ACK for update in %i\n",node_ID_,cm->control_ID);
                     allocateDataSlots();
                     if(ctrlPkt_) {
                             struct control_msg *cm2 = control_msg::access(ctrlPkt_);
@@ -1911,12 +2394,9 @@ void MacDynamicTdma::recvHandler(Event *e)
                         is_cack_waiting = 0;
                         waiting_cack_count = 0;
                         is_control_msg_required = 0;
-                        printf("record update time for node %i at time %f\n",node_ID_,Scheduler::instance().clock());
-                        char out[100];
+                        TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "record update time for node %i at time %f\n",node_ID_,Scheduler::instance().clock());
                         double update_time = Scheduler::instance().clock();
-                        sprintf(out, "recordMsgUpdateTime %i %i %f", node_ID_,0,update_time-update_msg_arr_time);
-                        Tcl& tcl = Tcl::instance();
-                        tcl.eval(out);
+                        TdlStats::record(TDL_MSG_UPDATE_TIME, "%i %i %f", node_ID_,0,update_time-update_msg_arr_time);
                     }
                 }
                 return;
@@ -1957,35 +2437,29 @@ void MacDynamicTdma::recvHandler(Event *e)
 		    radioSwitch(ON);
 
 		    struct polling_msg *ph = polling_msg::access(pktRx_);
-            char firstRunner = ph->runner_ups[0];
-            char secondRunner = ph->runner_ups[1];
-            char thirdRunner = ph->runner_ups[2];
             int backOffOrder = checkPollList(pktRx_);
+            // number of leading runner ups which are 1 hop neighbors
+            int nearRunners = 0;
+            while(nearRunners < frame_.poll_size && findNrHops(ph->runner_ups[nearRunners])==1)
+                nearRunners++;
 		    if(is_in_net && (is_control_msg_required || nePkt_)) {
 
 
                 if(is_control_msg_required)
-                    printf("Node %i in pos %i of poll receives poll and have control to send\n",node_ID_,backOffOrder);
+                    TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i in pos %i of poll receives poll and have control to send\n",node_ID_,backOffOrder);
                 else if(nePkt_)
-                    printf("Node %i in pos %i of poll receives poll and have net entry ACK to send\n",node_ID_,backOffOrder);
-                if(backOffOrder>0) {
-                    // each polled node set backoff time in the interval of 3 ms i.e. 1st,2nd,3rd polled nodes set back off time to 3, 6, 9 ms respectively
-                    if(backOffOrder == 1) {
-                        is_back_off = 1;
-                        mhBkOff_.start(pktRx_,0);
-                    } else if(backOffOrder == 2 && findNrHops(firstRunner)==1) {
-                        is_back_off = 1;
-                        mhBkOff_.start(pktRx_,1*0.010);
-                    } else if(backOffOrder == 3 && findNrHops(firstRunner)==1 && findNrHops(secondRunner)==1) {
-                        is_back_off = 1;
-                        mhBkOff_.start(pktRx_,2*0.010);
-                    }
+                    TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Node %i in pos %i of poll receives poll and have net entry ACK to send\n",node_ID_,backOffOrder);
+                // each polled node set backoff time in the interval of 10 ms i.e. 1st,2nd,3rd polled nodes set back off time to 0, 10, 20 ms respectively,
+                // if every node polled before it is a 1 hop neighbor
+                if(backOffOrder>0 && nearRunners >= backOffOrder-1) {
+                    is_back_off = 1;
+                    mhBkOff_.start(pktRx_,(backOffOrder-1)*0.010);
                 }
 		    } else if(!is_in_net && is_net_entry && !is_ack_waiting) {
                 //printf("New Node %i receives poll and have net entry to send\n",node_ID_,backOffOrder);
-                if(findNrHops(firstRunner)==1 && findNrHops(secondRunner)==1 && findNrHops(thirdRunner)==1) {
+                if(nearRunners == frame_.poll_size) {
                     is_back_off = 1;
-                    mhBkOff_.start(pktRx_,3*0.010);
+                    mhBkOff_.start(pktRx_,frame_.poll_size*0.010);
                 }
 		    }
 		}
@@ -1993,29 +2467,21 @@ void MacDynamicTdma::recvHandler(Event *e)
 }
 
 /* After transmission a certain packet. Turn off the radio. */
-void MacDynamicTdma::sendHandler(Event *e)
+void MacDynamicTdma::sendHandler(int frame_type)
 {
-	/* Once transmission is complete, drop the packet.
-	   p  is just for schedule a event. */
 	SET_TX_STATE(MAC_IDLE);
 
-	hdr_mac_dynamic_tdma* mh = HDR_MAC_DYNAMIC_TDMA((Packet *)e);
-
-
-
 	// Turn off the radio after sending the whole packet. Except when polling is sent, radio must still be on
-	if(mh->frame_type != POLLING_FRAME)
+	if(frame_type != POLLING_FRAME)
         radioSwitch(OFF);
     /* if data packet has been sent, unlock IFQ. */
-    if((FrameType) mh->frame_type==DATA_FRAME) {
-        Packet::free((Packet *)e);
-        if(callback_) {
+    if((FrameType) frame_type==DATA_FRAME) {
+        // keep the IFQ blocked while a segment left over by aggregate() waits
+        if(callback_ && !pktTx_) {
             Handler *h = callback_;
             callback_ = 0;
             h->handle((Event*) 0);
         }
-    } else {
-        Packet::free((Packet *)e);
     }
 }
 
@@ -2024,7 +2490,7 @@ void MacDynamicTdma::backoffHandler(Event *e)
     // send control message
     if(!is_rec_in_back_off) {
         if(is_control_msg_required) {
-            printf("Back off time for node %i has ended and it will send control message in slot %i at time %f\n",node_ID_,slot_count_,Scheduler::instance().clock());
+            TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_DEBUG, "Back off time for node %i has ended and it will send control message in slot %i at time %f\n",node_ID_,slot_count_,Scheduler::instance().clock());
             sendControl();
             is_control_msg_required = 0;
 
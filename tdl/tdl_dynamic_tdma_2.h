@@ -17,6 +17,10 @@ Usage: self-organized TDMA protocol
 #include <queue.h>
 #include <mac.h>	        // Base class for this MAC protocol
 #include "tdl_data_udp.h"
+#include "tdl_slot_alloc.h"
+#include "tdl_frame.h"
+#include "tdl_log.h"
+#include "tdl_slot_clock.h"
 
 #define GET_ETHER_TYPE(x)		GET2BYTE((x))
 #define SET_ETHER_TYPE(x,y)     {u_int16_t t = (y); STORE2BYTE(x,&t);}
@@ -25,8 +29,9 @@ Usage: self-organized TDMA protocol
  * TDMA slot physical spec
  */
 
-#define Phy_SlotTime		0.050		// 50 ms
-#define Phy_GuardTime		0.002		// 2 ms
+// Default slot, a TdlFrame may set another one per net
+#define Phy_SlotTime		FRAME_SLOT_TIME
+#define Phy_GuardTime		FRAME_GUARD_TIME
 #define Phy_RxTxTurnaround	0.000005	// 5 us
 
 class PHY_MIB {
@@ -45,17 +50,16 @@ public:
 // Max data length allowed in one slot (byte)
 #define MAC_TDMA_MAX_DATA_LEN 600
 
-// How many time slots in one frame.
-#define MAC_TDMA_SLOT_NUM     200
+// Initial number of rows in the neighbor table, it grows on demand
+#define NB_TABLE_INIT_SIZE	16
 
-// Maximum number of nodes
-#define MAX_NODE_NUM		16
+// Frame length is max_slot_num_, the rest of the frame geometry (slot time,
+// control slot spacing, vslots, poll size, ...) comes from TdlFrame.
 
-#define NUM_CT_SLOTS        10
-
-#define NUM_VSLOTS          5   //increase num vslots to raise opportunity for net entry
-
-#define POLL_SIZE           3
+// Entries kept per control slot in the election table. The poll list is
+// found within the winner, poll_size runner-ups and the entries skipped on
+// the way: every vslot and this node while it is not in the net.
+#define MAX_ELECT_TOP_K     (1+MAX_POLL_SIZE+MAX_VSLOTS)
 
 // Indicate if this is the very first time the simulation runs.
 #define FIRST_ROUND             -1
@@ -66,6 +70,11 @@ public:
 
 // Initial Seed
 #define INIT_SEED   0
+
+// Random draws of a MAC come from substream rng_key_ (default node ID -
+// NODE_ID_BASE) of MRG32k3a stream TDL_RNG_STREAM_BASE + rng_run_. The
+// base is far past the streams RNG objects take in order of creation.
+#define TDL_RNG_STREAM_BASE	1000000
 // Available Net
 #define MAX_NET_NO       8
 #define CHANNEL_SPACING     25000   //channel spacing 25 kHz
@@ -81,7 +90,7 @@ enum FrameType {
 struct hdr_mac_dynamic_tdma {
 	double			arrival_time;   // use for delay measurement purpose
 	FrameType		frame_type;     // use frametype
-	char			srcID;          // src ID is 1 byte
+	int			srcID;          // src node ID
 	MsgType			srcMsgType;     // src message type indicate priority and update rate
 	u_int8_t		srcSeed;        // src seed is int8
 	u_char			dh_da[4];       // dest address
@@ -89,17 +98,39 @@ struct hdr_mac_dynamic_tdma {
 	u_char			dh_body[1];     // store header type as int8
 };
 
-struct hdr_nb_info {
-    char			nbID[MAX_NODE_NUM-1];       //store neighbors' ID
-	MsgType			nbMsgType[MAX_NODE_NUM-1];  //store neighbors' message type
-	u_int8_t		nbSeed[MAX_NODE_NUM-1];     //store neighbors' seed
-	u_int8_t	    nrNB;	                    // number of active neighbor in the net
-	//Header access metods
-	static int offset_;
-	inline static int& offset() { return offset_; }
-	inline static hdr_nb_info* access(const Packet* p) {
-		return (hdr_nb_info*) p->access(offset_);
+// Neighbor sets are bitsets over (id - NODE_ID_BASE), 32 nodes a word
+#define NB_WORD(i)		((i) >> 5)
+#define NB_BIT(i)		(1u << ((i) & 31))
+
+/* 1-hop neighbors of the sender of a frame. They ride on the frame as its
+   AppData, so the list takes only the room of the neighbors there are and
+   packets of other protocols carry nothing of it. Bit (id - NODE_ID_BASE)
+   of nbSet_ is set for every 1-hop neighbor, nbInfo_ holds their rows,
+   seeds and message types in the order the sender found them, which the
+   receiver keeps for the neighbors new to it. data_ is the AppData the
+   frame had before, it is given back to the frame when it is passed up. */
+class TdlNbData : public AppData {
+public:
+	TdlNbData() : AppData(TDL_NB_DATA), nbSet_(0), nbInfo_(0), words_(0),
+		      nrNB_(0), data_(0), max_words_(0), max_nb_(0) {}
+	TdlNbData(TdlNbData& d);
+	virtual ~TdlNbData();
+	virtual int size() const {
+		return (sizeof(u_int16_t) + words_*sizeof(u_int32_t) +
+			nrNB_*sizeof(u_int32_t));
 	}
+	virtual AppData* copy() { return new TdlNbData(*this); }
+	/* make room for words bitset words and nb neighbors, clearing both */
+	void reset(int words, int nb);
+
+	u_int32_t	*nbSet_;	// store neighbors' ID
+	u_int32_t	*nbInfo_;	// seed | message type << 8 | row << 16
+	int		words_;		// words of nbSet_ up to the last neighbor
+	int		nrNB_;		// number of active neighbor in the net
+	AppData		*data_;		// AppData of the frame itself
+private:
+	int		max_words_;
+	int		max_nb_;
 };
 
 // Mac header length
@@ -107,7 +138,7 @@ struct hdr_nb_info {
 
 // Data structure for net entry request payload
 struct net_entry_msg {
-    char        entry_ID;
+    int         entry_ID;
     u_int8_t    entry_msg; // 1 = request message, 2 = ack message
     //access metods
 	static int offset_;
@@ -121,7 +152,7 @@ struct net_entry_msg {
 
 // Data structure for control payload
 struct control_msg {
-    char        control_ID;
+    int         control_ID;
     u_int8_t    control_msgtype; // 1 = request message, 2 = ack message
     //access metods
 	static int offset_;
@@ -135,7 +166,7 @@ struct control_msg {
 
 // Data structure for polling message
 struct polling_msg {
-    char    runner_ups[3];  // store first three runner ups with highest hash.
+    int     runner_ups[MAX_POLL_SIZE];  // runner ups with highest hash, poll_size of them used
     //access metods
 	static int offset_;
 	inline static int& offset() { return offset_; }
@@ -143,7 +174,38 @@ struct polling_msg {
 		return (polling_msg*) p->access(offset_);
 	}
 };
-#define POLLING_PAYLOAD_SIZE    3
+// bytes per runner up, a polling frame carries poll_size of them
+#define POLLING_ENTRY_SIZE      1
+
+// Kinds of control frames, each has its own packet in the pool
+#define CTRL_NETENTRY           0
+#define CTRL_NETENTRY_ACK       1
+#define CTRL_CONTROL            2
+#define CTRL_CONTROL_ACK        3
+#define CTRL_POLLING            4
+#define NUM_CTRL_KINDS          5
+
+// Length field in front of every segment packed behind the first one
+#define AGG_SUBHDR_LEN          2
+// Most segments packed behind the first one in a data frame
+#define AGG_MAX_SEGMENTS        64
+
+/* Segments packed behind the first packet of an aggregated data frame.
+   It rides on the first packet as its AppData, so every receiver gets
+   its own copy of the segments when the channel copies the frame. */
+class TdlAggData : public AppData {
+public:
+	TdlAggData() : AppData(TDL_AGG_DATA), num_(0), head_size_(0), head_data_(0) {}
+	TdlAggData(TdlAggData& d);
+	virtual ~TdlAggData();
+	virtual int size() const { return sizeof(TdlAggData); }
+	virtual AppData* copy() { return new TdlAggData(*this); }
+
+	Packet  *seg_[AGG_MAX_SEGMENTS];
+	int     num_;
+	int     head_size_;     // size of the first packet before packing
+	AppData *head_data_;    // data of the first packet before packing
+};
 
 #define DATA_Time(len)	(8 * (len) / bandwidth_)
 
@@ -160,6 +222,8 @@ public:
 
 	virtual void start(Packet *p, double time);
 	virtual void stop(Packet *p);
+	// start on the timer's own event, e.g. when restored
+	void restart(double time);
 	virtual void pause(void) { assert(0); }
 	virtual void resume(void) { assert(0); }
 
@@ -179,13 +243,6 @@ protected:
 	double		slottime_;
 };
 
-/* Timers to schedule transmitting and receiving. */
-class SlotDynamicTdmaTimer : public MacDynamicTdmaTimer {
-public:
-	SlotDynamicTdmaTimer(MacDynamicTdma *m) : MacDynamicTdmaTimer(m) {}
-	void 	handle(Event *e);
-};
-
 /* Timers to control packet sending and receiving time. */
 class RxPktDynamicTdmaTimer : public MacDynamicTdmaTimer {
 public:
@@ -194,11 +251,17 @@ public:
 	void	handle(Event *e);
 };
 
+/* The TX timer only keeps the frame type of the frame on the air, the
+   frame itself belongs to the channel once it is sent down. */
 class TxPktDynamicTdmaTimer : public MacDynamicTdmaTimer {
 public:
-	TxPktDynamicTdmaTimer(MacDynamicTdma *m) : MacDynamicTdmaTimer(m) {}
+	TxPktDynamicTdmaTimer(MacDynamicTdma *m) : MacDynamicTdmaTimer(m), frame_type_(0) {}
 
+	void	start(int frame_type, double time);
 	void	handle(Event *e);
+	inline int frameType() { return frame_type_; }
+protected:
+	int	frame_type_;
 };
 /* Timers to control backoff time, after receiving polling. */
 class BackOffTimer : public MacDynamicTdmaTimer {
@@ -212,28 +275,34 @@ class RecordDynTimer : public TimerHandler {
  public:
 	RecordDynTimer(MacDynamicTdma* t) : TimerHandler(), t_(t) {}
 	inline virtual void expire(Event*);
+	// time it expires at while pending
+	inline double due() { return event_.time_; }
  protected:
 	MacDynamicTdma* t_;
 };
 
 // Dynamic TDMA MAC Layer
-class MacDynamicTdma : public Mac {
-	friend class SlotDynamicTdmaTimer;
+class MacDynamicTdma : public Mac, public TdmaSlotClient {
 	friend class RxPktDynamicTdmaTimer;
 	friend class TxPktDynamicTdmaTimer;
 	friend class BackOffTimer;
 
 public:
 	MacDynamicTdma(PHY_MIB* p);
+	~MacDynamicTdma();
 	void		recv(Packet *p, Handler *h);
 	inline int 	hdr_dst(char* hdr, int dst = -2);
 	inline int	hdr_src(char* hdr, int src = -2);
 	inline int	hdr_type(char* hdr, u_int16_t type = 0);
 
 	/* Timer handler */
-	void slotHandler(Event *e);
+	void slotTick();
+	/* Fast-forward over idle frames, see quiescent() */
+	int quiescent();
+	int ticksToFrame();
+	void idleAdvance(int n);
 	void recvHandler(Event *e);
-	void sendHandler(Event *e);
+	void sendHandler(int frame_type);
 	void backoffHandler(Event *e);
 
 	void recordHandler();
@@ -241,11 +310,13 @@ public:
 
 protected:
 	PHY_MIB		*phymib_;
+	// debug output of this node
+	TdlLog		log_;
 
 	// max slot num can be configured
 	int		    max_slot_num_;
     // Node ID
-    char        node_ID_;
+    int         node_ID_;
     // Node Seed
     u_int8_t    node_seed_;
     u_int8_t    node_last_seed_;
@@ -260,9 +331,9 @@ protected:
     // Net Frequency
     double      net_freq_;
     // VSLOTs seed
-    u_int8_t    vslots[NUM_VSLOTS];
-    // define VSLOTs
-    char        vslotIDs[NUM_VSLOTS];
+    u_int8_t    vslots[MAX_VSLOTS];
+    // define VSLOTs, IDs are negative so they never clash with a node ID
+    int         vslotIDs[MAX_VSLOTS];
 
 
 
@@ -270,6 +341,13 @@ protected:
 private:
 	int command(int argc, const char*const* argv);
       void radioSwitch(int i);
+      /* Idle slot skipping, see skipIdleSlots() */
+      void skipIdleSlots();
+      void syncSlotCount();
+      void wakeSlots();
+      void idleFrame();
+      void spreadIdleSeed();
+      void idleSeedHeard(int id, u_int8_t seed, int hops);
 
 	  /* Packet Transmission Functions.*/
 	  void    sendUp(Packet* p);
@@ -279,6 +357,8 @@ private:
 	  void recvDATA(Packet *p);
 	  /* Actually send the packet buffered. */
 	  void send();
+	  /* Pack queued segments behind pktTx_ */
+	  TdlAggData* aggregate();
 	  /* Switch to net channel */
 	  void switchToNetChannel();
 	  /* Net Entry */
@@ -287,18 +367,15 @@ private:
 	  u_int8_t assignSeed();
       /* Allocate data slot */
       void allocateDataSlots();
-      void sortingMembers();
-      int assignSlots(int id, int msg_t, int rate);
-      /* sorting algorithm */
-      void bubbleSort(int *arr1, int *arr2, int len);
-      void bubbleSort2(int *arr1, char *arr2, int len);
+      int memberMsgType(MsgType msg_t);
       /* Access control slots for transmission update or net entry */
       void accessControlSlots();
       /* compute hash */
       int hashSeed(int slot_num, int seed);
       /* Find winning node for a net control slot */
       void findHashAndSort(int slot_num, int vslot_num);
-      char findRunnerUpNode(int pos);
+      void buildElectionRow(int row, int slot_num, int vslot_num);
+      int findRunnerUpNode(int pos);
       /* Send Net Entry message */
       void sendNetEntry();
       /* Send Net entry ACK */
@@ -313,19 +390,44 @@ private:
       /* Update Node's Neighbor table */
       void updateNeighborTable(Packet *p);
       /* Update node's neighbor */
-      void updateNeighbor(char id, MsgType msg_t, u_int8_t seed, u_int8_t hops);
-      /* find leaving node at the end of cycle */
-      void findLeavingNodes();
+      void updateNeighbor(int id, MsgType msg_t, u_int8_t seed, u_int8_t hops);
+      /* Grow the neighbor table so that it has a row for id */
+      void growNeighborTable(int id);
+      void growSet(u_int32_t *&set, int words);
+      /* Net state checkpoint, see saveState() */
+      void saveState(FILE *f);
+      int loadState(FILE *f);
+      /* Fill the neighbor info header of an outgoing frame */
+      void fillNeighborInfo(Packet *p);
+      /* find leaving node at the end of cycle, return 1 if a neighbor joined or left */
+      int findLeavingNodes();
       /* Record 1-hop neighbor found in current frame */
-      void recordOneHop(char id);
+      void recordOneHop(int id);
       /* check if giving neighbor is a 1-hop neighbor */
-      int checkOneHop(char id);
+      int checkOneHop(int id);
       /* Record 2-hop neighbor found in current frame */
-      void recordTwoHop(char id);
+      void recordTwoHop(int id);
       /* check if giving neighbor is a 2-hop neighbor */
-      int checkTwoHop(char id);
+      int checkTwoHop(int id);
       /* determine number of hop of a given neighbor id */
-      int findNrHops(char id);
+      int findNrHops(int id);
+      /* row of a node in the neighbor table, -1 if it has none yet */
+      inline int nbIndex(int id) {
+          int idx = id - NODE_ID_BASE;
+          return (idx >= 0 && idx < nb_table_size_) ? idx : -1;
+      }
+      /* set the hops of row n, keeping hop1_set_ and reach_set_ in step */
+      inline void setHops(int n, u_int8_t hops) {
+          table_nb_hops[n] = hops;
+          if(hops == 1)
+              hop1_set_[NB_WORD(n)] |= NB_BIT(n);
+          else
+              hop1_set_[NB_WORD(n)] &= ~NB_BIT(n);
+          if(hops < 3)
+              reach_set_[NB_WORD(n)] |= NB_BIT(n);
+          else
+              reach_set_[NB_WORD(n)] &= ~NB_BIT(n);
+      }
       /* determine if channel is idle */
 	  inline int	is_idle(void);
 
@@ -350,7 +452,7 @@ private:
 	  };
 
 	  /* Timers */
-	  SlotDynamicTdmaTimer mhSlot_;
+	  TdmaSlotClock *slot_clock_;
 	  TxPktDynamicTdmaTimer mhTxPkt_;
 	  RxPktDynamicTdmaTimer mhRxPkt_;
 	  BackOffTimer mhBkOff_;
@@ -415,6 +517,24 @@ private:
       int num_slots_reserved;
       int num_slots_used;
 
+      //slot payload aggregation
+      int aggregate_;       // pack several segments in one data slot
+      int agg_pull_;        // pulling segments from the IFQ in send()
+      Packet *agg_next_;    // segment just pulled from the IFQ
+
+      // leave the slot clock alone in slots that would change nothing
+      int skip_idle_slots_;
+      unsigned long last_tick_; // slot clock tick slot_count_ is up to date with
+
+      // seed and net entry draws, see TDL_RNG_STREAM_BASE
+      RNG *rng_;
+      int rng_run_;
+      int rng_key_;
+
+      // let the slot clock fast-forward over frames in which nothing happens
+      int fast_forward_;
+      int nb_stable_;           // no neighbor joined or left at the last frame start
+
 
       //schedule record
       int record_time;
@@ -425,11 +545,23 @@ private:
       Packet *ctrlPkt_;
       Packet *nePkt_;
 
+      /* Control frames are built in packets kept by the MAC, one per kind.
+         A packet is used again once the channel has let go of it. */
+      Packet *allocCtrl(int kind);
+      Packet *ctrl_pool_[NUM_CTRL_KINDS];
+      int pool_ctrl_;       // 0 allocates a packet per control frame
+      // packets allocated for frames sent, control and data frames sent
+      int num_pkt_alloc_;
+      int num_ctrl_frames_;
+      int num_data_frames_;
+
 
+	  // Frame geometry of the net, taken from TdlFrame at creation
+	  tdma_frame frame_;
 	  // The time duration for each slot.
-	  static double slot_time_;
+	  double slot_time_;
 	  // Duration for data in each slot
-	  static double data_time_;
+	  double data_time_;
 	  /* The start time for whole TDMA scheduling.
 	  	All net should have the same start time
 	  */
@@ -440,7 +572,16 @@ private:
 	  /* Data structure for tdma scheduling. */
 
 	  int *tdma_schedule_;			// Time slot reserved table
-	  char *table_nb_id;		        // Neighbor's ID Table
+	  TdmaSlotAllocator slot_alloc_;	// fills the data slots of tdma_schedule_
+	  tdma_member *members_;		// member list handed to slot_alloc_
+	  int members_size_;
+
+	  /* Neighbor table. Per-neighbor state is indexed by (id - NODE_ID_BASE),
+	     table_nb_id keeps the neighbors in order of discovery. */
+	  int nb_table_size_;			// rows in the ID-indexed arrays
+	  int num_nb_;				// entries in table_nb_id
+	  int *table_nb_id;		        // Neighbor's ID Table
+	  u_int8_t *table_nb_known;		// 1 if the row is in table_nb_id
 	  MsgType *table_nb_msg_type;		// Neighbor's Message Type Table
 	  u_int8_t *table_nb_seed;			// Neighbor's seeds
 	  u_int8_t *table_nb_hops;			// Neighbor's number of hops (1 = 1 hop, 2 = 2 hops, 3 = over 2 hops)
@@ -454,18 +595,37 @@ private:
 	  int slot_count_;
 
 
-      // Hash Table order from high to low
-      char hashID[MAX_NODE_NUM+NUM_VSLOTS];
-      int hashValue[MAX_NODE_NUM+NUM_VSLOTS];
-
-	  //keep track of 1-hop and 2-hop neighbor in current frame
-      char onehop_nb_id[MAX_NODE_NUM-1];
-      u_int8_t onehop_nb_found[MAX_NODE_NUM-1];
-      char twohop_nb_id[MAX_NODE_NUM-1];
-      u_int8_t twohop_nb_found[MAX_NODE_NUM-1];
-
-
-      char poll_list_[POLL_SIZE];
+      // Hash Table order from high to low, hash_len_ entries are valid.
+      // Only the top of the election is kept, this node included.
+      int hashID[MAX_ELECT_TOP_K+1];
+      int hashValue[MAX_ELECT_TOP_K+1];
+      int hash_len_;
+
+      // Election table, one row per control slot of the frame holding the
+      // top elect_k_ neighbors and vslots. A row is rebuilt when its
+      // generation differs from elect_gen_, which is bumped whenever a
+      // neighbor seed changes or a neighbor joins or leaves the election.
+      int *elect_id_;
+      int *elect_value_;
+      int *elect_len_;
+      int *elect_row_gen_;
+      int elect_rows_;
+      int elect_k_;			// 1 + poll_size + num_vslots
+      int elect_gen_;
+
+	  //1-hop and 2-hop neighbors heard in the current frame, cleared at
+	  //the start of a frame. known_set_, hop1_set_ and reach_set_ follow
+	  //table_nb_known and table_nb_hops (1, and 1 or 2) of the same rows.
+      int nb_words_;
+      u_int32_t *onehop_set_;
+      u_int32_t *twohop_set_;
+      u_int32_t *known_set_;
+      u_int32_t *hop1_set_;
+      u_int32_t *reach_set_;
+      u_int32_t *left_set_;		// left in this frame, findLeavingNodes()
+
+
+      int poll_list_[MAX_POLL_SIZE];
 	  // How many packets has been sent out?
 	  static int tdma_ps_;
 	  // How many packets has been received?
@@ -481,8 +641,6 @@ private:
 
 };
 
-double MacDynamicTdma::slot_time_ = 0;
-double MacDynamicTdma::data_time_ = 0;
 double MacDynamicTdma::start_time_ = 0;
 
 
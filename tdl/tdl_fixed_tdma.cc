@@ -10,6 +10,7 @@
 #include "wireless-phy.h"
 #include "cmu-trace.h"
 #include "tdl_data_udp.h"
+#include "tdl_stats.h"
 #include <stddef.h>
 #include <iostream>
 #include <sstream>
@@ -67,17 +68,6 @@ void MacFixTdmaTimer::stop(Packet *p)
 	rtime = 0.0;    //reset ramaining time
 }
 
-/* Slot timer for TDMA scheduling. */
-void SlotFixTdmaTimer::handle(Event *e)
-{
-	busy_ = 0;
-	paused_ = 0;
-	stime = 0.0;
-	rtime = 0.0;
-
-	mac->slotHandler(e);  //mac is MacFixTdma object
-}
-
 /* Receive Timer */
 void RxPktFixTdmaTimer::handle(Event *e)
 {
@@ -117,7 +107,7 @@ public:
 
 static char nodeID = 0x41;
 MacFixTdma::MacFixTdma(PHY_MIB* p) :
-	Mac(), mhSlot_(this), mhTxPkt_(this), mhRxPkt_(this), recT_(this){
+	Mac(), mhTxPkt_(this), mhRxPkt_(this), recT_(this){
 	/* Global variables setting. */
 	// Setup the phy specs.
 	phymib_ = p;
@@ -128,6 +118,8 @@ MacFixTdma::MacFixTdma(PHY_MIB* p) :
 	//bind("slot_packet_len_", &slot_packet_len_);
 	bind("max_slot_num_", &max_slot_num_);
 	bind("is_active_", &is_active_);
+	bind("log_level_", &log_.level_);
+	bind("log_cats_", &log_.cats_);
 
 
 
@@ -154,7 +146,7 @@ MacFixTdma::MacFixTdma(PHY_MIB* p) :
 
 	// Initialy, the radio is off. NOTE: can't use radioSwitch(OFF) here.
 	radio_active_ = 0;
-        printf("mac created for %d with slot time %f\n",node_ID_,slot_time_);
+        TDL_LOG(log_, TDL_LOG_SLOT, TDL_LOG_INFO, "mac created for %d with slot time %f\n",node_ID_,slot_time_);
 
 	// Do slot scheduling.
 	re_schedule();
@@ -168,7 +160,7 @@ MacFixTdma::MacFixTdma(PHY_MIB* p) :
 
 
 	//Start the Slot timer..
-	mhSlot_.start((Packet *) (& intr_), 0);
+	slot_clock_ = TdmaSlotClock::attach(this, slot_time_, 0);
 	//Start record
     if(is_active_) {
         record_time = 0;
@@ -179,21 +171,14 @@ MacFixTdma::MacFixTdma(PHY_MIB* p) :
 void MacFixTdma::recordHandler()
 {
     //record momentary avg delay
-    char out[100];
-    sprintf(out, "recordAvgPacketDelay %i %i %f", node_ID_,record_time,avg_delay);
-    Tcl& tcl = Tcl::instance();
-    tcl.eval(out);
+    TdlStats::record(TDL_AVG_PACKET_DELAY, "%i %i %f", node_ID_,record_time,avg_delay);
 
     //record individual throughput
-    char out2[100];
-    sprintf(out2, "recordThroughput %i %i %i %i %i", node_ID_,record_time,num_packets_sent,num_bytes_sent,num_tbytes_sent);
-    tcl.eval(out2);
+    TdlStats::record(TDL_THROUGHPUT, "%i %i %i %i %i", node_ID_,record_time,num_packets_sent,num_bytes_sent,num_tbytes_sent);
 
 
     //record individual time slot utilization
-    char out3[100];
-    sprintf(out3, "recordSlotUtil %i %i %i %i", node_ID_,record_time,num_slots_reserved,num_slots_used);
-    tcl.eval(out3);
+    TdlStats::record(TDL_SLOT_UTIL, "%i %i %i %i", node_ID_,record_time,num_slots_reserved,num_slots_used);
 
     record_time++;
     recT_.resched(1);
@@ -201,6 +186,8 @@ void MacFixTdma::recordHandler()
 
 int MacFixTdma::command(int argc, const char*const* argv)
 {
+	if (argc >= 3 && strcmp(argv[1], "log") == 0)
+		return log_.command(argc, argv);
 	if (argc == 3) {
 		if (strcmp(argv[1], "log-target") == 0) {
 			logtarget_ = (NsObject*) TclObject::lookup(argv[2]);
@@ -337,7 +324,7 @@ void MacFixTdma::recv(Packet* p, Handler* h) {
 		//until the tdl application starts, then it can tx or rx in the slot
 		if(!radio_active_)
 			radio_active_ = 1;
-		printf("MAC in %d receive packet %i size %d from Upper Layer\n",node_ID_,ch->uid(),ch->size());
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_DEBUG, "MAC in %d receive packet %i size %d from Upper Layer\n",node_ID_,ch->uid(),ch->size());
 	}
 	/* Incoming packets from phy layer, send UP to ll layer.
 	   Now, it is in receiving mode.
@@ -366,7 +353,7 @@ void MacFixTdma::recv(Packet* p, Handler* h) {
         state(MAC_SEND);
         sendDown(p);
 	} else {
-	    printf("receive control\n");
+	    TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_INFO, "receive control\n");
         free(p);
         h->handle((Event*) 0);
         return;
@@ -380,7 +367,7 @@ void MacFixTdma::sendUp(Packet* p)
 
 	/* Can't receive while transmitting. Should not happen...?*/
 	if (tx_state_ && ch->error() == 0) {
-		printf("<%d>, can't receive while transmitting!\n", index_);
+		TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_ERR, "<%d>, can't receive while transmitting!\n", index_);
 		ch->error() = 1;
 	};
 
@@ -402,7 +389,7 @@ void MacFixTdma::sendUp(Packet* p)
 		/* Note: we don't take the channel status into account,
 		   as collision should not happen...
 		*/
-		printf("<%d>, receiving, but the channel is not idle....???\n", index_);
+		TDL_LOG(log_, TDL_LOG_RX, TDL_LOG_ERR, "<%d>, receiving, but the channel is not idle....???\n", index_);
 	}
 }
 
@@ -456,7 +443,7 @@ void MacFixTdma::send()
 
 	/* Check if there is any packet buffered. */
 	if (!pktTx_) {
-		printf("<%d>, %f, no packet buffered.\n", index_, NOW);
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_ERR, "<%d>, %f, no packet buffered.\n", index_, NOW);
 		return;
 	}
 
@@ -465,7 +452,7 @@ void MacFixTdma::send()
 		/* Note: we don't take the channel status into account, ie. no collision,
 		   as collision should not happen...
 		*/
-		printf("<%d>, %f, transmitting, but the channel is not idle...???\n", index_, NOW);
+		TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_ERR, "<%d>, %f, transmitting, but the channel is not idle...???\n", index_, NOW);
 		return;
 	}
 
@@ -485,7 +472,7 @@ void MacFixTdma::send()
 	radioSwitch(ON);
 
 	/* Start a timer that expires when the packet transmission is complete. */
-	printf("%d send packet %i size %d bytes in slot %d\n",node_ID_,ch->uid(),ch->size(),slot_count_);
+	TDL_LOG(log_, TDL_LOG_TX, TDL_LOG_DEBUG, "%d send packet %i size %d bytes in slot %d\n",node_ID_,ch->uid(),ch->size(),slot_count_);
 	//record delay
 	num_packets_sent++;
 	num_bytes_sent += ch->size()-ETHER_HDR_LEN;
@@ -494,10 +481,7 @@ void MacFixTdma::send()
     double pkt_delay = send_packet_time-packet_arr_time;
     cumulative_delay += pkt_delay;
     avg_delay = cumulative_delay/num_packets_sent;
-    char out[100];
-    sprintf(out, "recordPacketDelay %i %i %f", node_ID_,ch->uid(),send_packet_time-packet_arr_time);
-    Tcl& tcl = Tcl::instance();
-    tcl.eval(out);
+    TdlStats::record(TDL_PACKET_DELAY, "%i %i %f", node_ID_,ch->uid(),send_packet_time-packet_arr_time);
 
     num_slots_used++;
 	mhTxPkt_.start(pktTx_->copy(), stime);
@@ -557,11 +541,8 @@ void MacFixTdma::makePreamble()
    occupy one slot time,
    radio turned on for the whole slot.
 */
-void MacFixTdma::slotHandler(Event *e)
+void MacFixTdma::slotTick()
 {
-	// Restart timer for next slot.
-	mhSlot_.start((Packet *)e, slot_time_);
-
 	// reset slot count for next frame.
 	if ((slot_count_ == max_slot_num_) || (slot_count_ == FIRST_ROUND)) {
 		//printf("<%d>, %f, make the new preamble now.\n", index_, NOW);
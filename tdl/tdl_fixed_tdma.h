@@ -9,6 +9,8 @@
 #include <arp.h>              // ARP functionality
 #include <ll.h>		      // LL functionality
 #include <mac.h>	      // Base class for this MAC protocol
+#include "tdl_log.h"
+#include "tdl_slot_clock.h"
 
 
 #define GET_ETHER_TYPE(x)		GET2BYTE((x))
@@ -109,13 +111,6 @@ protected:
 	double		slottime_;
 };
 
-/* Timers to schedule transmitting and receiving. */
-class SlotFixTdmaTimer : public MacFixTdmaTimer {
-public:
-	SlotFixTdmaTimer(MacFixTdma *m) : MacFixTdmaTimer(m) {}
-	void 	handle(Event *e);
-};
-
 /* Timers to control packet sending and receiving time. */
 class RxPktFixTdmaTimer : public MacFixTdmaTimer {
 public:
@@ -139,8 +134,7 @@ class RecordFixTimer : public TimerHandler {
 	MacFixTdma* t_;
 };
 // Fix TDMA MAC Layer
-class MacFixTdma : public Mac {
-	friend class SlotFixTdmaTimer;
+class MacFixTdma : public Mac, public TdmaSlotClient {
 	friend class RxPktFixTdmaTimer;
 	friend class TxPktFixTdmaTimer;
 
@@ -152,7 +146,7 @@ public:
 	inline int	hdr_type(char* hdr, u_int16_t type = 0);
 
 	/* Timer handler */
-	void slotHandler(Event *e);
+	void slotTick();
 	void recvHandler(Event *e);
 	void sendHandler(Event *e);
 	void recordHandler();
@@ -160,6 +154,8 @@ public:
 
 protected:
 	PHY_MIB		*phymib_;
+	// debug output of this node
+	TdlLog		log_;
 
 	// Both the slot length and max slot num can be configured
 	//int 		slot_packet_len_;
@@ -210,7 +206,7 @@ private:
 	  };
 
 	  /* Timers */
-	  SlotFixTdmaTimer mhSlot_;
+	  TdmaSlotClock *slot_clock_;
 	  TxPktFixTdmaTimer mhTxPkt_;
 	  RxPktFixTdmaTimer mhRxPkt_;
 	  RecordFixTimer recT_;
@@ -0,0 +1,126 @@
+/*
+tdl_frame.cc
+Note: functions for TdlFrame class
+Usage: per-net frame geometry of Mac/DynamicTdma, set from Tcl
+*/
+
+#include "tdl_frame.h"
+#include <string.h>
+#include <stdlib.h>
+
+TdlFrame::net_entry* TdlFrame::nets_ = 0;
+
+static class TdlFrameClass : public TclClass {
+public:
+	TdlFrameClass() : TclClass("TdlFrame") {}
+	TclObject* create(int, const char*const*) {
+		return (new TdlFrame);
+	}
+} class_tdl_frame;
+
+TdlFrame::TdlFrame()
+{
+	tdmaDefaultFrame(&frame_);
+	bind_time("slot_time_", &frame_.slot_time);
+	bind_time("guard_time_", &frame_.guard_time);
+	bind("block_len_", &frame_.block_len);
+	bind("num_vslots_", &frame_.num_vslots);
+	bind("poll_size_", &frame_.poll_size);
+	bind("payload_size_", &frame_.payload_size);
+	bind("guarantee_period_", &frame_.g_period);
+	bind("guarantee_count_", &frame_.g_count);
+	bind("pos_stride_", &frame_.pos_stride);
+}
+
+TdlFrame::~TdlFrame()
+{
+	detach();
+}
+
+void TdlFrame::lookup(int net, tdma_frame *f)
+{
+	for(net_entry *e = nets_;e;e = e->next) {
+		if(e->net == net) {
+			*f = e->frame;
+			return;
+		}
+	}
+	tdmaDefaultFrame(f);
+}
+
+// Drop every net attached to this TdlFrame, they go back to the defaults
+void TdlFrame::detach()
+{
+	net_entry **pe = &nets_;
+	while(*pe) {
+		if((*pe)->owner == this) {
+			net_entry *e = *pe;
+			*pe = e->next;
+			delete e;
+		} else {
+			pe = &(*pe)->next;
+		}
+	}
+}
+
+// Return 0 if the geometry is usable, else what is wrong with it
+const char* TdlFrame::check()
+{
+	if(frame_.slot_time <= 0 || frame_.guard_time < 0 ||
+	   frame_.guard_time >= frame_.slot_time)
+		return "need 0 <= guard_time_ < slot_time_";
+	if(frame_.block_len < 2 || frame_.block_len > MAX_SLOTS_PER_BLOCK)
+		return "block_len_ out of range";
+	if(frame_.num_vslots < 0 || frame_.num_vslots > MAX_VSLOTS)
+		return "num_vslots_ out of range";
+	if(frame_.poll_size < 1 || frame_.poll_size > MAX_POLL_SIZE)
+		return "poll_size_ out of range";
+	if(frame_.payload_size < 1)
+		return "payload_size_ must be positive";
+	if(frame_.g_period < 1 || frame_.g_count < 0)
+		return "bad guarantee_period_ or guarantee_count_";
+	if(frame_.pos_stride < 1 || frame_.pos_stride >= frame_.block_len)
+		return "need 1 <= pos_stride_ < block_len_";
+	return 0;
+}
+
+/*
+ * $frame attach <net>	MACs of net created from now on use the geometry
+ * $frame detach	nets of this frame go back to the defaults
+ */
+int TdlFrame::command(int argc, const char*const* argv)
+{
+	Tcl& tcl = Tcl::instance();
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "detach") == 0) {
+			detach();
+			return TCL_OK;
+		}
+	}
+	if (argc == 3) {
+		if (strcmp(argv[1], "attach") == 0) {
+			const char *err = check();
+			if (err) {
+				tcl.resultf("TdlFrame: %s", err);
+				return TCL_ERROR;
+			}
+			int net = atoi(argv[2]);
+			net_entry *e;
+			for(e = nets_;e;e = e->next) {
+				if(e->net == net)
+					break;
+			}
+			if(e == 0) {
+				e = new net_entry;
+				e->net = net;
+				e->next = nets_;
+				nets_ = e;
+			}
+			e->frame = frame_;
+			e->owner = this;
+			return TCL_OK;
+		}
+	}
+	return TclObject::command(argc, argv);
+}
@@ -0,0 +1,58 @@
+/*
+tdl_frame.h
+Note: header file for TdlFrame class
+Usage: per-net frame geometry of Mac/DynamicTdma, set from Tcl
+*/
+
+#ifndef ns_tdl_frame_h
+#define ns_tdl_frame_h
+
+#include "tclcl.h"
+#include "tdl_slot_alloc.h"
+
+// Upper bounds of the geometry, they size the arrays of the MAC and the
+// polling frame
+#define MAX_VSLOTS		16
+#define MAX_POLL_SIZE		8
+
+/*
+ * Frame geometry of one net. A Mac/DynamicTdma takes the geometry of its
+ * assigned_Net_ when it is created, the defaults of tdl_slot_alloc.h if no
+ * TdlFrame is attached to that net:
+ *
+ *   set f [new TdlFrame]
+ *   $f set block_len_ 10
+ *   $f attach 2		;# nets 2 and 3 get this geometry
+ *   $f attach 3
+ *
+ * attach checks the geometry and keeps a copy of it, set the variables
+ * before. MACs already created keep the geometry they started with.
+ */
+class TdlFrame : public TclObject {
+public:
+	TdlFrame();
+	~TdlFrame();
+
+	// geometry of net, the defaults if no TdlFrame is attached to it
+	static void lookup(int net, tdma_frame *f);
+
+protected:
+	int command(int argc, const char*const* argv);
+
+private:
+	const char* check();
+	void detach();
+
+	tdma_frame frame_;
+
+	// nets attached to a TdlFrame, the last attach of a net wins
+	struct net_entry {
+		int net;
+		tdma_frame frame;
+		TdlFrame *owner;
+		net_entry *next;
+	};
+	static net_entry *nets_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+tdl_log.cc
+Note: functions for TdlLog class
+Usage: leveled debug output of the TDL MACs and agents, per node and category
+*/
+
+#include "tdl_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include "tclcl.h"
+
+static const char* level_names[] = { "off", "err", "info", "debug" };
+
+static const struct {
+	const char	*name;
+	int		cat;
+} cat_names[] = {
+	{ "tx",		TDL_LOG_TX },
+	{ "rx",		TDL_LOG_RX },
+	{ "slot",	TDL_LOG_SLOT },
+	{ "nb",		TDL_LOG_NB },
+	{ "alloc",	TDL_LOG_ALLOC },
+	{ "app",	TDL_LOG_APP },
+	{ "all",	TDL_LOG_ALL }
+};
+
+/*
+ * log <level> ?category ...?
+ * level is off, err, info, debug or 0-3. Without categories all of them
+ * are enabled. The setting is accepted even when TDL_LOGGING is not
+ * defined, so scripts run unchanged on both builds.
+ */
+int TdlLog::command(int argc, const char*const* argv)
+{
+	Tcl& tcl = Tcl::instance();
+
+	if (argc < 3) {
+		tcl.resultf("usage: log <level> ?category ...?");
+		return TCL_ERROR;
+	}
+
+	int level = -1;
+	for (int l = TDL_LOG_OFF; l <= TDL_LOG_DEBUG; l++) {
+		if (strcmp(argv[2], level_names[l]) == 0)
+			level = l;
+	}
+	if (level < 0) {
+		char *end;
+		level = (int) strtol(argv[2], &end, 10);
+		if (*end != 0 || level < TDL_LOG_OFF || level > TDL_LOG_DEBUG) {
+			tcl.resultf("unknown TDL log level %s", argv[2]);
+			return TCL_ERROR;
+		}
+	}
+
+	int cats = (argc == 3) ? TDL_LOG_ALL : 0;
+	for (int i = 3; i < argc; i++) {
+		int found = 0;
+		for (unsigned int c = 0; c < sizeof(cat_names)/sizeof(cat_names[0]); c++) {
+			if (strcmp(argv[i], cat_names[c].name) == 0) {
+				cats |= cat_names[c].cat;
+				found = 1;
+			}
+		}
+		if (!found) {
+			tcl.resultf("unknown TDL log category %s", argv[i]);
+			return TCL_ERROR;
+		}
+	}
+
+	level_ = level;
+	cats_ = cats;
+	return TCL_OK;
+}
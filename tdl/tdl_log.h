@@ -0,0 +1,66 @@
+/*
+tdl_log.h
+Note: header file for TdlLog class
+Usage: leveled debug output of the TDL MACs and agents, per node and category
+*/
+
+#ifndef ns_tdl_log_h
+#define ns_tdl_log_h
+
+#include <stdio.h>
+
+/*
+ * Debug output is only compiled in when TDL_LOGGING is defined, e.g. by
+ * adding -DTDL_LOGGING to DEFINE in the Makefile. Without it TDL_LOG()
+ * compiles to nothing, its arguments are type checked and count as used
+ * but are never evaluated.
+ *
+ * With logging compiled in, every object prints the messages of the
+ * categories set in log_cats_ up to log_level_. Both are bound variables,
+ * so they can be set for a class in ns-default.tcl or the script, or for a
+ * single node:
+ *	$mac set log_level_ 3
+ *	$mac log debug slot alloc	;# same, by name, only slot and alloc
+ *	$mac log off
+ */
+
+// levels
+#define TDL_LOG_OFF		0
+#define TDL_LOG_ERR		1	// unexpected MAC states
+#define TDL_LOG_INFO		2	// net entry, control messages, seeds
+#define TDL_LOG_DEBUG		3	// per slot and per packet output
+
+// categories
+#define TDL_LOG_TX		0x01	// packets sent down to the channel
+#define TDL_LOG_RX		0x02	// packets received or discarded
+#define TDL_LOG_SLOT		0x04	// control slot access, polling, backoff
+#define TDL_LOG_NB		0x08	// net entry and neighbor table
+#define TDL_LOG_ALLOC		0x10	// data slot allocation
+#define TDL_LOG_APP		0x20	// TDL message app and UDP agent
+#define TDL_LOG_ALL		0x3f
+
+class TdlLog {
+public:
+	TdlLog() : level_(TDL_LOG_OFF), cats_(TDL_LOG_ALL) {}
+
+	inline int on(int cat, int level) {
+		return (level <= level_ && (cats_ & cat));
+	}
+
+	// $obj log <level> ?category ...?
+	int command(int argc, const char*const* argv);
+
+	int	level_;
+	int	cats_;
+};
+
+#ifdef TDL_LOGGING
+#define TDL_LOG_ON(log, cat, level)	((log).on(cat, level))
+#define TDL_LOG(log, cat, level, ...) \
+	do { if ((log).on(cat, level)) printf(__VA_ARGS__); } while (0)
+#else
+#define TDL_LOG_ON(log, cat, level)	0
+#define TDL_LOG(log, cat, level, ...)	do { if (0) printf(__VA_ARGS__); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,326 @@
+/*
+tdl_slot_alloc.cc
+Note: functions for TdmaSlotAllocator class
+Usage: data slot allocation for the self-organized TDMA protocol
+*/
+
+#include "tdl_slot_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define FREE_SLOT	-1
+#define CONTROL_SLOT	-2
+
+// Per message type: update period (s) and largest message (bytes).
+// Type 1 RAP messages every 10 s with the highest priority, type 2 target
+// tracks and type 3 position reports every 2 s. Sizes are doubled for the
+// doubled bandwidth.
+static const int msg_rate[NUM_MSG_TYPES] = { 0, 10, 2, 2 };
+static const int msg_max_size[NUM_MSG_TYPES] = { 0, 10005, 2005, 55 };
+
+TdmaSlotAllocator::TdmaSlotAllocator() :
+	schedule_(0), num_slots_(0), is_valid_(0),
+	block_free_(0), num_blocks_(0), slot_block_(0), slot_bit_(0),
+	placed_(0), placed_ok_(0), num_placed_(0), placed_size_(0), num_replaced_(0),
+	log_start_(0), log_slot_(0), log_prev_(0), log_len_(0), log_size_(0)
+{
+}
+
+TdmaSlotAllocator::~TdmaSlotAllocator()
+{
+	delete [] block_free_;
+	delete [] slot_block_;
+	delete [] slot_bit_;
+	delete [] placed_;
+	delete [] placed_ok_;
+	delete [] log_start_;
+	delete [] log_slot_;
+	delete [] log_prev_;
+}
+
+// Work out the block of every slot and the periods of every message type
+// once, placement then only looks them up.
+void TdmaSlotAllocator::init(int *schedule, int num_slots, const tdma_frame &frame)
+{
+	schedule_ = schedule;
+	num_slots_ = num_slots;
+	frame_ = frame;
+	int block_len = frame_.block_len;
+
+	delete [] block_free_;
+	delete [] slot_block_;
+	delete [] slot_bit_;
+	num_blocks_ = (num_slots + block_len - 1) / block_len;
+	block_free_ = new unsigned int[num_blocks_];
+	slot_block_ = new int[num_slots];
+	slot_bit_ = new unsigned int[num_slots];
+	for(int i = 0;i<num_slots;i++) {
+		int l = i % block_len;
+		slot_block_[i] = i / block_len;
+		slot_bit_[i] = (l != 0) ? 1u << l : 0;
+		if(l == 0)
+			schedule_[i] = CONTROL_SLOT;
+	}
+
+	for(int t = 0;t<NUM_MSG_TYPES;t++) {
+		period_[t] = (int) (msg_rate[t]/frame_.slot_time);
+		if(period_[t] > 0) {
+			period_count_[t] = (int) (num_slots/period_[t]);
+			period_blocks_[t] = (int) (period_[t]/block_len);
+		} else {
+			period_count_[t] = 0;
+			period_blocks_[t] = 0;
+		}
+		// in this algorithm, we only assign slot based on maximum allow size of each message.
+		slots_req_[t] = (int) ceil((double) (msg_max_size[t]/frame_.payload_size)+0.5);
+		if(slots_req_[t]<1)
+			slots_req_[t] = 1;
+	}
+
+	num_placed_ = 0;
+	log_len_ = 0;
+	is_valid_ = 0;
+}
+
+// Free every data slot, control slots stay as they are
+void TdmaSlotAllocator::reset()
+{
+	for(int b = 0;b<num_blocks_;b++)
+		block_free_[b] = 0;
+	for(int i = 0;i<num_slots_;i++) {
+		if(slot_bit_[i]) {
+			schedule_[i] = FREE_SLOT;
+			block_free_[slot_block_[i]] |= slot_bit_[i];
+		}
+	}
+	num_placed_ = 0;
+	log_len_ = 0;
+	is_valid_ = 1;
+}
+
+static int compareMembers(const void *a, const void *b)
+{
+	const tdma_member *m1 = (const tdma_member *) a;
+	const tdma_member *m2 = (const tdma_member *) b;
+	if(m1->msg_t != m2->msg_t)
+		return (m1->msg_t < m2->msg_t) ? -1 : 1;
+	if(m1->id != m2->id)
+		return (m1->id < m2->id) ? -1 : 1;
+	return 0;
+}
+
+// Order by message type, then by ID. IDs are unique so the order is total.
+void TdmaSlotAllocator::sortMembers(tdma_member *members, int cnt)
+{
+	qsort(members, cnt, sizeof(tdma_member), compareMembers);
+}
+
+int TdmaSlotAllocator::rebuild(tdma_member *members, int cnt)
+{
+	sortMembers(members, cnt);
+	reset();
+	growMembers(cnt);
+	for(int k = 0;k<cnt;k++)
+		placed_[k] = members[k];
+	num_placed_ = cnt;
+	placeFrom(0);
+	num_replaced_ = cnt;
+
+	int num_alloc = 0;
+	for(int k = 0;k<cnt;k++)
+		num_alloc += placed_ok_[k];
+	return num_alloc;
+}
+
+int TdmaSlotAllocator::update(tdma_member *members, int cnt)
+{
+	if(!is_valid_)
+		return rebuild(members, cnt);
+
+	sortMembers(members, cnt);
+
+	// first member whose placement may differ from the last allocation
+	int k = 0;
+	while(k < cnt && k < num_placed_ &&
+	      placed_[k].id == members[k].id && placed_[k].msg_t == members[k].msg_t)
+		k++;
+
+	if(k < num_placed_)
+		undoFrom(k);
+
+	growMembers(cnt);
+	for(int i = k;i<cnt;i++)
+		placed_[i] = members[i];
+	num_placed_ = cnt;
+	placeFrom(k);
+	num_replaced_ = cnt - k;
+
+	int num_alloc = 0;
+	for(int i = 0;i<cnt;i++)
+		num_alloc += placed_ok_[i];
+	return num_alloc;
+}
+
+// Roll the schedule back to the state right after member k-1 was placed
+void TdmaSlotAllocator::undoFrom(int k)
+{
+	int stop = log_start_[k];
+	while(log_len_ > stop) {
+		log_len_--;
+		int slot = log_slot_[log_len_];
+		int prev = log_prev_[log_len_];
+		schedule_[slot] = prev;
+		if(prev == FREE_SLOT)
+			block_free_[slot_block_[slot]] |= slot_bit_[slot];
+		else
+			block_free_[slot_block_[slot]] &= ~slot_bit_[slot];
+	}
+}
+
+// Place members k..num_placed_-1, the schedule must hold the placement of 0..k-1
+void TdmaSlotAllocator::placeFrom(int k)
+{
+	for(int i = k;i<num_placed_;i++) {
+		log_start_[i] = log_len_;
+		placed_ok_[i] = assignSlots(placed_[i].id, placed_[i].msg_t);
+	}
+}
+
+void TdmaSlotAllocator::setSlot(int slot, int id)
+{
+	if(log_len_ == log_size_)
+		growLog();
+	log_slot_[log_len_] = slot;
+	log_prev_[log_len_] = schedule_[slot];
+	log_len_++;
+
+	schedule_[slot] = id;
+	if(id == FREE_SLOT)
+		block_free_[slot_block_[slot]] |= slot_bit_[slot];
+	else
+		block_free_[slot_block_[slot]] &= ~slot_bit_[slot];
+}
+
+int TdmaSlotAllocator::isPeriodFull(int first_block, int num_blocks)
+{
+	for(int b = first_block;b<first_block+num_blocks;b++) {
+		if(block_free_[b])
+			return 0;
+	}
+	return 1;
+}
+
+int TdmaSlotAllocator::assignSlots(int id, int msg_t)
+{
+	if(msg_t <= 0 || msg_t >= NUM_MSG_TYPES)
+		return 1;
+	int slotPeriod = period_[msg_t];
+	int slotsReq = slots_req_[msg_t];
+	int periodCount = period_count_[msg_t];
+	int blockCount = period_blocks_[msg_t];
+	int block_len = frame_.block_len;
+	int data_len = block_len-1;
+
+	int is_assigned_in_frame = 0;
+	//guarantee 1 slot every g_period slots. Nodes past the first block
+	//share positions, and only claim them when they are still free
+	int g_idx = id-NODE_ID_BASE;
+	int g_pos = (g_idx % data_len)+1;
+	for(int k = 0, g = 0;k<frame_.g_count && g_pos+g<num_slots_;k++, g+=frame_.g_period) {
+		if(g_idx < data_len || schedule_[g_pos+g]==FREE_SLOT)
+			setSlot(g_pos+g, id);
+	}
+	for(int i = 0;i<periodCount;i++) {
+		int period_start = i*slotPeriod;
+		int first_block = slot_block_[period_start];
+		int current_block = 0;
+		int slotPointer = 1;
+		int slotsAssigned = 0;
+		int is_period_full = 0;
+		for(int n = 0;n<slotPeriod;n++) {
+			if(schedule_[period_start+n]==id)
+				slotsAssigned++;
+		}
+		int f_pos = (id-NODE_ID_BASE) % frame_.pos_stride;
+		slotPointer = f_pos;
+		while(slotsAssigned<slotsReq && !is_period_full) {
+			int slot = period_start+block_len*current_block+slotPointer+1;
+			if(schedule_[slot]>0) {
+				if(block_free_[first_block+current_block]==0) {
+					//if this block full, move to next block
+					if(current_block<blockCount-1) {
+						current_block++;
+					} else {
+						current_block = 0;
+					}
+					slotPointer = f_pos;
+				} else {
+					//move slot pointer
+					slotPointer = (slotPointer+frame_.pos_stride) % data_len;
+				}
+			} else {
+				// if slot is free, assign 1 slot
+				setSlot(slot, id);
+				slotsAssigned++;
+				is_assigned_in_frame = 1;
+				// move to next block
+				if(current_block<blockCount-1) {
+					current_block++;
+				} else {
+					current_block = 0;
+				}
+				slotPointer = f_pos;
+			}
+
+			if(isPeriodFull(first_block, blockCount))
+				is_period_full = 1;
+		}
+	}
+
+	if(is_assigned_in_frame)
+		return 1;
+	else
+		return 0;
+}
+
+void TdmaSlotAllocator::growMembers(int cnt)
+{
+	if(cnt <= placed_size_)
+		return;
+	int size = (placed_size_ > 0) ? placed_size_ : 16;
+	while(size < cnt)
+		size *= 2;
+
+	tdma_member *placed = new tdma_member[size];
+	int *placed_ok = new int[size];
+	int *log_start = new int[size];
+	for(int i = 0;i<num_placed_;i++) {
+		placed[i] = placed_[i];
+		placed_ok[i] = placed_ok_[i];
+		log_start[i] = log_start_[i];
+	}
+	delete [] placed_;
+	delete [] placed_ok_;
+	delete [] log_start_;
+	placed_ = placed;
+	placed_ok_ = placed_ok;
+	log_start_ = log_start;
+	placed_size_ = size;
+}
+
+void TdmaSlotAllocator::growLog()
+{
+	int size = (log_size_ > 0) ? 2*log_size_ : 256;
+	int *log_slot = new int[size];
+	int *log_prev = new int[size];
+	if(log_len_ > 0) {
+		memcpy(log_slot, log_slot_, log_len_*sizeof(int));
+		memcpy(log_prev, log_prev_, log_len_*sizeof(int));
+	}
+	delete [] log_slot_;
+	delete [] log_prev_;
+	log_slot_ = log_slot;
+	log_prev_ = log_prev;
+	log_size_ = size;
+}
@@ -0,0 +1,147 @@
+/*
+tdl_slot_alloc.h
+Note: header file for TdmaSlotAllocator class
+Usage: data slot allocation for the self-organized TDMA protocol
+*/
+
+#ifndef ns_tdl_slot_alloc_h
+#define ns_tdl_slot_alloc_h
+
+// Node IDs are handed out from 'A' so traces keep their usual numbering.
+// A node's row in the neighbor table is (id - NODE_ID_BASE).
+#define NODE_ID_BASE		0x41
+
+// A block is one control slot followed by its data slots
+#define SLOTS_PER_BLOCK		20
+// Data slots between two consecutive control slots
+#define DATA_SLOTS_PER_BLOCK	(SLOTS_PER_BLOCK-1)
+// Longest block, the free slots of a block are kept in one word
+#define MAX_SLOTS_PER_BLOCK	32
+
+/*
+ * Frame geometry defaults, used by a net without a TdlFrame. They give the
+ * schedules the geometry was hard-coded to: a control slot every 20 slots
+ * of 50 ms, 5 vslots, 3 runner ups, 516 byte slots, a guaranteed slot every
+ * 40 slots up to the 5th one and node start positions 16 apart.
+ */
+#define FRAME_SLOT_TIME		0.050		// 50 ms
+#define FRAME_GUARD_TIME	0.002		// 2 ms
+#define FRAME_NUM_VSLOTS	5
+#define FRAME_POLL_SIZE		3
+#define FRAME_PAYLOAD_SIZE	516
+#define FRAME_G_PERIOD		40
+#define FRAME_G_COUNT		5
+#define FRAME_POS_STRIDE	16
+
+// Frame geometry of a net, set from Tcl by TdlFrame
+struct tdma_frame {
+	double slot_time;	// slot duration (s)
+	double guard_time;	// end of a slot left unused (s)
+	int block_len;		// slots per block, control slot included
+	int num_vslots;		// vslots taking part in the control slot election
+	int poll_size;		// runner ups named by a polling frame
+	int payload_size;	// data bytes per slot, sizes the slot requests
+	int g_period;		// slots between the guaranteed slots of a node
+	int g_count;		// guaranteed slots of a node per frame
+	int pos_stride;		// spacing of node start positions within a block
+};
+
+static inline void tdmaDefaultFrame(tdma_frame *f)
+{
+	f->slot_time = FRAME_SLOT_TIME;
+	f->guard_time = FRAME_GUARD_TIME;
+	f->block_len = SLOTS_PER_BLOCK;
+	f->num_vslots = FRAME_NUM_VSLOTS;
+	f->poll_size = FRAME_POLL_SIZE;
+	f->payload_size = FRAME_PAYLOAD_SIZE;
+	f->g_period = FRAME_G_PERIOD;
+	f->g_count = FRAME_G_COUNT;
+	f->pos_stride = FRAME_POS_STRIDE;
+}
+
+// Message types 0-3, type 0 sends nothing
+#define NUM_MSG_TYPES		4
+
+// Net member as seen by the allocator
+struct tdma_member {
+	int id;         // node ID
+	int msg_t;      // message type 0-3, 0 means nothing to send
+};
+
+/*
+ * Allocates the data slots of a frame among the net members.
+ *
+ * Members are placed one after another in (message type, ID) order, every
+ * placement depends on the slots taken by the members before it. rebuild()
+ * wipes the data slots and places everybody, update() keeps the placement of
+ * the longest unchanged prefix of the ordered member list, undoes the rest
+ * and places only those members again. Both give the same schedule.
+ */
+class TdmaSlotAllocator {
+public:
+	TdmaSlotAllocator();
+	~TdmaSlotAllocator();
+
+	// schedule is owned by the caller, init() marks its control slots
+	void init(int *schedule, int num_slots, const tdma_frame &frame);
+
+	// return number of members which got at least one slot
+	int update(tdma_member *members, int cnt);
+	int rebuild(tdma_member *members, int cnt);
+
+	inline int placed() { return num_placed_; }
+	// members placed again by the last update()
+	inline int replaced() { return num_replaced_; }
+	// block of a control slot, -1 for a data slot
+	inline int controlBlock(int slot) {
+		return slot_bit_[slot] ? -1 : slot_block_[slot];
+	}
+	inline int numBlocks() { return num_blocks_; }
+
+private:
+	void reset();
+	void sortMembers(tdma_member *members, int cnt);
+	void undoFrom(int k);
+	void placeFrom(int k);
+	int assignSlots(int id, int msg_t);
+	void setSlot(int slot, int id);
+	int isPeriodFull(int first_block, int num_blocks);
+	void growMembers(int cnt);
+	void growLog();
+
+	int		*schedule_;
+	int		num_slots_;
+	tdma_frame	frame_;
+	int		is_valid_;      // schedule holds the placement of placed_
+
+	// free data slots, bit l of block b is set if slot b*block_len+l is free
+	unsigned int	*block_free_;
+	int		num_blocks_;
+
+	// per slot, its block and its bit in block_free_ (0 for a control slot)
+	int		*slot_block_;
+	unsigned int	*slot_bit_;
+
+	// per message type: slots per period, periods per frame, blocks per
+	// period and slots needed per period
+	int		period_[NUM_MSG_TYPES];
+	int		period_count_[NUM_MSG_TYPES];
+	int		period_blocks_[NUM_MSG_TYPES];
+	int		slots_req_[NUM_MSG_TYPES];
+
+	// members in placement order and whether each one got a slot
+	tdma_member	*placed_;
+	int		*placed_ok_;
+	int		num_placed_;
+	int		placed_size_;
+	int		num_replaced_;
+
+	// undo log, the writes of member k start at log_start_[k]
+	int		*log_start_;
+	int		*log_slot_;
+	int		*log_prev_;
+	int		log_len_;
+	int		log_size_;
+};
+
+#endif
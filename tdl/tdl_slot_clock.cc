@@ -0,0 +1,193 @@
+/*
+tdl_slot_clock.cc
+Note: functions for TdmaSlotClock class
+Usage: one scheduler event per TDMA slot shared by all TDL MACs
+*/
+
+#include "tdl_slot_clock.h"
+#include <stdlib.h>
+#include <string.h>
+
+TdmaSlotClock* TdmaSlotClock::head_ = 0;
+
+TdmaSlotClock::TdmaSlotClock(double slot_time) :
+	slot_time_(slot_time), next_(0), running_(0), tick_(0), ff_(0), ff_wake_(0),
+	clients_(0), num_(0), size_(0), num_detached_(0), link_(0)
+{
+}
+
+TdmaSlotClock* TdmaSlotClock::attach(TdmaSlotClient *c, double slot_time, double delay)
+{
+	double first = Scheduler::instance().clock() + delay;
+	TdmaSlotClock *clk;
+
+	for(clk = head_;clk != 0;clk = clk->link_) {
+		if(clk->slot_time_ != slot_time)
+			continue;
+		// a new client ticks from its first slot on
+		clk->resume();
+		if(clk->running_ && clk->next_ == first)
+			break;
+		if(!clk->running_) {
+			clk->start(delay);
+			break;
+		}
+	}
+	if(clk == 0) {
+		clk = new TdmaSlotClock(slot_time);
+		clk->link_ = head_;
+		head_ = clk;
+		clk->start(delay);
+	}
+
+	if(clk->num_ == clk->size_) {
+		int size = (clk->size_ > 0) ? 2*clk->size_ : 64;
+		TdmaSlotClient **clients = new TdmaSlotClient*[size];
+		if(clk->num_ > 0)
+			memcpy(clients, clk->clients_, clk->num_*sizeof(TdmaSlotClient*));
+		delete [] clk->clients_;
+		clk->clients_ = clients;
+		clk->size_ = size;
+	}
+	clk->clients_[clk->num_++] = c;
+	return clk;
+}
+
+void TdmaSlotClock::detach(TdmaSlotClient *c)
+{
+	for(int i = 0;i<num_;i++) {
+		if(clients_[i] == c) {
+			clients_[i] = 0;
+			num_detached_++;
+			return;
+		}
+	}
+}
+
+void TdmaSlotClock::start(double delay)
+{
+	running_ = 1;
+	next_ = Scheduler::instance().clock() + delay;
+	Scheduler::instance().schedule(this, &intr_, delay);
+}
+
+// Drop detached clients, keeping the order of the others
+void TdmaSlotClock::compact()
+{
+	int k = 0;
+	for(int i = 0;i<num_;i++) {
+		if(clients_[i] != 0)
+			clients_[k++] = clients_[i];
+	}
+	num_ = k;
+	num_detached_ = 0;
+}
+
+void TdmaSlotClock::handle(Event *)
+{
+	if(ff_) {
+		// the wake up tick is handled as usual
+		advance(ff_wake_);
+		ff_ = 0;
+	}
+	if(num_detached_)
+		compact();
+	if(num_ == 0) {
+		// restarted by the next attach()
+		running_ = 0;
+		return;
+	}
+
+	// re-arm first, as the per-node timers did
+	next_ = Scheduler::instance().clock() + slot_time_;
+	Scheduler::instance().schedule(this, &intr_, slot_time_);
+	tick_++;
+
+	// clients attached from a tick only start at their own first tick
+	int n = num_;
+	for(int i = 0;i<n;i++) {
+		if(clients_[i] != 0 && clients_[i]->wake_tick_ <= tick_)
+			clients_[i]->slotTick();
+	}
+
+	for(int i = 0;i<num_;i++) {
+		if(clients_[i] != 0 && !clients_[i]->quiescent())
+			return;
+	}
+	enterFastForward();
+}
+
+// Replace the event of the next tick by one SLOT_CLOCK_FF_TICKS ticks on.
+// Tick times are sums of slot_time_ as they would be tick by tick.
+void TdmaSlotClock::enterFastForward()
+{
+	double wake = next_;
+	for(int k = 1;k<SLOT_CLOCK_FF_TICKS;k++)
+		wake += slot_time_;
+	Scheduler &s = Scheduler::instance();
+	s.cancel(&intr_);
+	s.schedule(this, &intr_, (wake > s.clock()) ? wake - s.clock() : 0);
+	ff_wake_ = tick_ + SLOT_CLOCK_FF_TICKS;
+	ff_ = 1;
+}
+
+// First tick due at or after t
+unsigned long TdmaSlotClock::ticksBefore(double t)
+{
+	unsigned long to = tick_ + 1;
+	double next = next_;
+	while(next < t && to < ff_wake_) {
+		next += slot_time_;
+		to++;
+	}
+	return to;
+}
+
+// Apply the ticks before tick to. A step never passes a frame start of a
+// client, so frame starts run in the order they would tick by tick.
+void TdmaSlotClock::advance(unsigned long to)
+{
+	while(tick_ + 1 < to) {
+		unsigned long n = to - 1 - tick_;
+		for(int i = 0;i<num_;i++) {
+			if(clients_[i] != 0 && (unsigned long) clients_[i]->ticksToFrame() < n)
+				n = clients_[i]->ticksToFrame();
+		}
+		for(int i = 0;i<num_;i++) {
+			if(clients_[i] != 0)
+				clients_[i]->idleAdvance((int) n);
+		}
+		tick_ += n;
+		for(unsigned long k = 0;k<n;k++)
+			next_ += slot_time_;
+	}
+}
+
+void TdmaSlotClock::sync()
+{
+	if(ff_)
+		advance(ticksBefore(Scheduler::instance().clock()));
+}
+
+void TdmaSlotClock::restore(double next, unsigned long tick)
+{
+	Scheduler &s = Scheduler::instance();
+	if(running_)
+		s.cancel(&intr_);
+	running_ = 1;
+	ff_ = 0;
+	tick_ = tick;
+	next_ = next;
+	s.schedule(this, &intr_, (next_ > s.clock()) ? next_ - s.clock() : 0);
+}
+
+void TdmaSlotClock::resume()
+{
+	if(!ff_)
+		return;
+	sync();
+	ff_ = 0;
+	Scheduler &s = Scheduler::instance();
+	s.cancel(&intr_);
+	s.schedule(this, &intr_, (next_ > s.clock()) ? next_ - s.clock() : 0);
+}
@@ -0,0 +1,109 @@
+/*
+tdl_slot_clock.h
+Note: header file for TdmaSlotClock class
+Usage: one scheduler event per TDMA slot shared by all TDL MACs
+*/
+
+#ifndef ns_tdl_slot_clock_h
+#define ns_tdl_slot_clock_h
+
+#include "scheduler.h"
+
+// Longest stretch a fast-forwarding clock sleeps, in ticks
+#define SLOT_CLOCK_FF_TICKS	4096
+
+// A MAC driven by a slot clock
+class TdmaSlotClient {
+public:
+	TdmaSlotClient() : wake_tick_(0) {}
+	virtual ~TdmaSlotClient() {}
+	// start of a slot
+	virtual void slotTick() = 0;
+
+	// Fast-forward, see TdmaSlotClock::fastForward(). A client is
+	// quiescent if its next ticks would only repeat idle frames.
+	virtual int quiescent() { return 0; }
+	// ticks up to and including the one starting the next frame
+	virtual int ticksToFrame() { return 1; }
+	// apply the next n ticks without calling slotTick()
+	virtual void idleAdvance(int) {}
+
+	// first tick the client is called for again, see TdmaSlotClock::skip()
+	unsigned long	wake_tick_;
+};
+
+/*
+ * Every TDL MAC used to run its own slot timer re-armed every slot_time_,
+ * i.e. one scheduler event per node and slot. MACs whose slots start at
+ * the same instants now share a clock, which fires once per slot and
+ * calls the MACs in the order they attached. That is the order in which
+ * their own timers expired, since those were started in the same order
+ * and always re-armed with the same delay.
+ *
+ * When every client is quiescent after a tick the clock fast-forwards: it
+ * drops its per-slot event and only wakes up SLOT_CLOCK_FF_TICKS ticks
+ * later. The ticks in between are applied lazily by idleAdvance(), frame
+ * starts in time order and within a tick in client order, so the frame
+ * start updates draw their random numbers in the usual order. sync() does
+ * so up to the current time, resume() also goes back to one event per
+ * slot. A client calls resume() before anything that may end its
+ * quiescence, i.e. a packet or a timer of its own.
+ */
+class TdmaSlotClock : public Handler {
+public:
+	// Tick c every slot_time, first in delay seconds. Joins the clock
+	// with the same slot time whose next tick is due then.
+	static TdmaSlotClock* attach(TdmaSlotClient *c, double slot_time, double delay);
+	void detach(TdmaSlotClient *c);
+
+	void handle(Event *e);
+
+	// apply the ticks skipped up to now
+	void sync();
+	// leave fast-forward, the next tick is handled as usual
+	void resume();
+	// continue a checkpointed clock, its last tick was tick and the
+	// next one is due at next. Before the run starts.
+	void restore(double next, unsigned long tick);
+	inline int fastForward() { return ff_; }
+
+	inline int clients() { return num_; }
+	// time of the next tick
+	inline double next() { return next_; }
+	// ticks so far, the current one included while it is handled
+	inline unsigned long tick() { return tick_; }
+	// leave c out of the next n ticks
+	inline void skip(TdmaSlotClient *c, int n) { c->wake_tick_ = tick_ + n + 1; }
+	// call c again from the next tick on
+	inline void wake(TdmaSlotClient *c) { c->wake_tick_ = 0; }
+
+private:
+	TdmaSlotClock(double slot_time);
+	void start(double delay);
+	void compact();
+	void enterFastForward();
+	unsigned long ticksBefore(double t);
+	void advance(unsigned long to);
+
+	double		slot_time_;
+	double		next_;		// time of the next tick
+	int		running_;
+	unsigned long	tick_;
+	Event		intr_;
+
+	// fast-forward: tick_ and next_ are those of the last tick applied,
+	// intr_ is due at tick ff_wake_
+	int		ff_;
+	unsigned long	ff_wake_;
+
+	// registered MACs in tick order, detached ones are 0 until compacted
+	TdmaSlotClient	**clients_;
+	int		num_;
+	int		size_;
+	int		num_detached_;
+
+	TdmaSlotClock	*link_;
+	static TdmaSlotClock *head_;
+};
+
+#endif
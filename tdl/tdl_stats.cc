@@ -0,0 +1,265 @@
+/*
+tdl_stats.cc
+Note: functions for TdlStats class
+Usage: native record sink for TDL measurements
+*/
+
+#include "tdl_stats.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* metric_names[TDL_NUM_METRICS] = {
+	"recordPktArrTime",
+	"recordNETime",
+	"recordNLTime",
+	"recordResolveTime",
+	"recordMsgUpdateTime",
+	"recordPacketDelay",
+	"recordAvgPacketDelay",
+	"recordThroughput",
+	"recordRAP",
+	"recordPosReport",
+	"recordRadarTrack",
+	"recordSlotUtil"
+};
+
+TdlStats* TdlStats::instance_ = 0;
+
+static class TdlStatsClass : public TclClass {
+public:
+	TdlStatsClass() : TclClass("TdlStats") {}
+	TclObject* create(int, const char*const*) {
+		return (new TdlStats);
+	}
+} class_tdl_stats;
+
+TdlStats::TdlStats() : tcl_compat_(1)
+{
+	bind("tcl_compat_", &tcl_compat_);
+	for(int m = 0;m<TDL_NUM_METRICS;m++) {
+		out_[m].fp = 0;
+		out_[m].buf = 0;
+		out_[m].len = 0;
+		out_[m].name = 0;
+	}
+	// only one sink per simulation, the last one created wins
+	if(instance_ == 0)
+		atexit(flushAtExit);
+	instance_ = this;
+}
+
+TdlStats::~TdlStats()
+{
+	closeAll();
+	if(instance_ == this)
+		instance_ = 0;
+}
+
+int TdlStats::metricIndex(const char *name)
+{
+	for(int m = 0;m<TDL_NUM_METRICS;m++) {
+		if(strcmp(name, metric_names[m]) == 0)
+			return m;
+	}
+	return -1;
+}
+
+/*
+ * The line the record* proc of the scripts writes for the arguments args,
+ * which is args itself for all procs but two.
+ */
+static int procLine(int m, const char *args, char *line, int size)
+{
+	char a[64], b[64];
+	int rest;
+
+	switch(m) {
+	case TDL_PKT_ARR_TIME:
+		// "$arr_time $pkt_Id"
+		if(sscanf(args, "%63s %63s", a, b) == 2)
+			return snprintf(line, size, "%s %s", b, a);
+		break;
+	case TDL_RESOLVE_TIME:
+		// "$node_id found-conflict $num_conflict $frame_time" for type 1
+		if(sscanf(args, "%63s %63s %n", a, b, &rest) == 2)
+			return snprintf(line, size, "%s %s %s", a,
+					strcmp(b, "1") == 0 ? "found-conflict" :
+					"resolve-conflict", args + rest);
+		break;
+	}
+	return snprintf(line, size, "%s", args);
+}
+
+void TdlStats::record(TdlMetric m, const char *fmt, ...)
+{
+	TdlStats *s = instance_;
+	char rec[TDL_STATS_REC_SIZE];
+	va_list ap;
+
+	if(s && s->out_[m].fp) {
+		char args[TDL_STATS_REC_SIZE];
+		va_start(ap, fmt);
+		int len = vsnprintf(args, sizeof(args), fmt, ap);
+		va_end(ap);
+		if(len < 0)
+			return;
+		len = procLine(m, args, rec, sizeof(rec) - 1);
+		if(len < 0)
+			return;
+		if(len > (int) sizeof(rec) - 2)
+			len = sizeof(rec) - 2;
+		rec[len++] = '\n';
+		s->append(m, rec, len);
+		return;
+	}
+	if(s && !s->tcl_compat_)
+		return;
+
+	// compatibility mode, hand the record to the proc of the script
+	int n = snprintf(rec, sizeof(rec), "%s ", metric_names[m]);
+	va_start(ap, fmt);
+	vsnprintf(rec + n, sizeof(rec) - n, fmt, ap);
+	va_end(ap);
+	Tcl::instance().eval(rec);
+}
+
+void TdlStats::append(int m, const char *rec, int len)
+{
+	tdl_stats_out &o = out_[m];
+	if(o.len + len > TDL_STATS_BUF_SIZE)
+		flushOne(m);
+	memcpy(o.buf + o.len, rec, len);
+	o.len += len;
+}
+
+void TdlStats::flushOne(int m)
+{
+	tdl_stats_out &o = out_[m];
+	if(o.fp && o.len > 0) {
+		fwrite(o.buf, 1, o.len, o.fp);
+		fflush(o.fp);
+	}
+	o.len = 0;
+}
+
+void TdlStats::flush()
+{
+	for(int m = 0;m<TDL_NUM_METRICS;m++)
+		flushOne(m);
+}
+
+int TdlStats::open(int m, const char *fname)
+{
+	tdl_stats_out &o = out_[m];
+	if(o.fp) {
+		flushOne(m);
+		fclose(o.fp);
+	}
+	o.fp = fopen(fname, "w");
+	if(o.fp == 0)
+		return 0;
+	if(o.name != fname) {
+		char *name = new char[strlen(fname) + 1];
+		strcpy(name, fname);
+		delete [] o.name;
+		o.name = name;
+	}
+	if(o.buf == 0)
+		o.buf = new char[TDL_STATS_BUF_SIZE];
+	o.len = 0;
+	return 1;
+}
+
+/*
+ * Open every metric file again under its own name in dir, for the runs
+ * of "$ns sweep", which would all write to the files of the parent else.
+ * Returns the metric which failed or -1.
+ */
+int TdlStats::reopen(const char *dir)
+{
+	for(int m = 0;m<TDL_NUM_METRICS;m++) {
+		tdl_stats_out &o = out_[m];
+		if(o.fp == 0)
+			continue;
+		const char *base = strrchr(o.name, '/');
+		base = base ? base + 1 : o.name;
+		char *fname = new char[strlen(dir) + strlen(base) + 2];
+		sprintf(fname, "%s/%s", dir, base);
+		int ok = open(m, fname);
+		delete [] fname;
+		if(!ok)
+			return m;
+	}
+	return -1;
+}
+
+void TdlStats::closeAll()
+{
+	for(int m = 0;m<TDL_NUM_METRICS;m++) {
+		tdl_stats_out &o = out_[m];
+		flushOne(m);
+		if(o.fp)
+			fclose(o.fp);
+		o.fp = 0;
+		delete [] o.buf;
+		o.buf = 0;
+		delete [] o.name;
+		o.name = 0;
+	}
+}
+
+void TdlStats::flushAtExit()
+{
+	if(instance_)
+		instance_->closeAll();
+}
+
+/*
+ * $stats file <record proc> <file name>	write the metric to a file
+ * $stats flush					write out buffered records
+ * $stats close					flush and close all files
+ * $stats reopen <dir>				the files again, in dir
+ */
+int TdlStats::command(int argc, const char*const* argv)
+{
+	Tcl& tcl = Tcl::instance();
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "flush") == 0) {
+			flush();
+			return TCL_OK;
+		}
+		if (strcmp(argv[1], "close") == 0) {
+			closeAll();
+			return TCL_OK;
+		}
+	}
+	if (argc == 3) {
+		if (strcmp(argv[1], "reopen") == 0) {
+			int m = reopen(argv[2]);
+			if (m >= 0) {
+				tcl.resultf("cannot open %s in %s",
+					    out_[m].name, argv[2]);
+				return TCL_ERROR;
+			}
+			return TCL_OK;
+		}
+	}
+	if (argc == 4) {
+		if (strcmp(argv[1], "file") == 0) {
+			int m = metricIndex(argv[2]);
+			if (m < 0) {
+				tcl.resultf("unknown TDL metric %s", argv[2]);
+				return TCL_ERROR;
+			}
+			if (!open(m, argv[3])) {
+				tcl.resultf("cannot open %s", argv[3]);
+				return TCL_ERROR;
+			}
+			return TCL_OK;
+		}
+	}
+	return TclObject::command(argc, argv);
+}
@@ -0,0 +1,76 @@
+/*
+tdl_stats.h
+Note: header file for TdlStats class
+Usage: native record sink for TDL measurements
+*/
+
+#ifndef ns_tdl_stats_h
+#define ns_tdl_stats_h
+
+#include <stdio.h>
+#include "tclcl.h"
+
+/*
+ * Every metric used to be written by a record* proc defined in the
+ * simulation script. A metric with a file attached is now written by
+ * TdlStats, one line per record the same as the proc writes it, e.g.
+ * "node_id packet_id delay_time" for recordPacketDelay. Callers pass the
+ * proc arguments, see procLine() for the procs writing something else.
+ * A metric without a file still calls its proc, unless tcl_compat_ is 0.
+ */
+enum TdlMetric {
+	TDL_PKT_ARR_TIME = 0,	// recordPktArrTime
+	TDL_NE_TIME,		// recordNETime
+	TDL_NL_TIME,		// recordNLTime
+	TDL_RESOLVE_TIME,	// recordResolveTime
+	TDL_MSG_UPDATE_TIME,	// recordMsgUpdateTime
+	TDL_PACKET_DELAY,	// recordPacketDelay
+	TDL_AVG_PACKET_DELAY,	// recordAvgPacketDelay
+	TDL_THROUGHPUT,		// recordThroughput
+	TDL_RAP,		// recordRAP
+	TDL_POS_REPORT,		// recordPosReport
+	TDL_RADAR_TRACK,	// recordRadarTrack
+	TDL_SLOT_UTIL,		// recordSlotUtil
+	TDL_NUM_METRICS
+};
+
+// Records are kept in memory and written out in blocks of this size
+#define TDL_STATS_BUF_SIZE	65536
+// Longest single record
+#define TDL_STATS_REC_SIZE	256
+
+struct tdl_stats_out {
+	FILE	*fp;
+	char	*buf;
+	int	len;
+	char	*name;	// file name, for reopen()
+};
+
+class TdlStats : public TclObject {
+public:
+	TdlStats();
+	~TdlStats();
+
+	static void record(TdlMetric m, const char *fmt, ...);
+
+	void flush();
+	void closeAll();
+
+protected:
+	int command(int argc, const char*const* argv);
+
+private:
+	int metricIndex(const char *name);
+	int open(int m, const char *fname);
+	int reopen(const char *dir);
+	void append(int m, const char *rec, int len);
+	void flushOne(int m);
+
+	static void flushAtExit();
+	static TdlStats *instance_;
+
+	tdl_stats_out out_[TDL_NUM_METRICS];
+	int tcl_compat_;	// metrics without a file go to their record* proc
+};
+
+#endif
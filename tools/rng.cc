@@ -233,6 +233,13 @@ RNG::command(int argc, const char*const* argv)
 			tcl.resultf("%6e", uniform(d));
 			return (TCL_OK);
 		}
+#ifndef OLD_RNG
+		// next-substream-all <n>: every RNG, see next_substream_all()
+		if (strcmp(argv[1], "next-substream-all") == 0) {
+			next_substream_all(strtoul(argv[2], NULL, 0));
+			return (TCL_OK);
+		}
+#endif /* !OLD_RNG */
 		if (strcmp(argv[1], "seed") == 0) {
 			int s = atoi(argv[2]);
 			// NEEDSWORK: should be a way to set seed to PRDEF_SEED_SOURCE
@@ -304,6 +311,13 @@ RNG::command(int argc, const char*const* argv)
 			}
 			return(TCL_OK);
 		}
+#ifndef OLD_RNG
+		// stream <k> <j>: substream j of stream k, see set_stream()
+		if (strcmp(argv[1], "stream") == 0) {
+			set_stream(strtoul(argv[2], NULL, 0), strtoul(argv[3], NULL, 0));
+			return (TCL_OK);
+		}
+#endif /* !OLD_RNG */
 		if (strcmp(argv[1], "normal") == 0) {
 			double avg = strtod(argv[2], NULL);
 			double std = strtod(argv[3], NULL);
@@ -781,6 +795,7 @@ double RNG::U01d ()
  */
 RNG::RNG (long seed) 
 {
+	link();
 	set_seed (seed);
 	init();
 }
@@ -851,6 +866,7 @@ double RNG::next_seed_[6] =
 // 
 RNG::RNG (const char *s) 
 { 
+	link();
 	if (strlen (s) > 99) {
 		strncpy (name_, s, 99);
 		name_[100] = 0;
@@ -891,6 +907,67 @@ void RNG::reset_next_substream ()
 		Cg_[i] = Bg_[i]; 
 } 
 
+//------------------------------------------------------------------------- 
+// Keep all RNGs in a list, to move them all n substreams on.
+// 
+RNG *RNG::all_ = 0;
+
+void RNG::link ()
+{
+	prev_rng_ = 0;
+	next_rng_ = all_;
+	if (all_)
+		all_->prev_rng_ = this;
+	all_ = this;
+}
+
+RNG::~RNG ()
+{
+	if (prev_rng_)
+		prev_rng_->next_rng_ = next_rng_;
+	else
+		all_ = next_rng_;
+	if (next_rng_)
+		next_rng_->prev_rng_ = prev_rng_;
+}
+
+void RNG::next_substream_all (unsigned long n)
+{
+	for (RNG *r = all_; r; r = r->next_rng_)
+		for (unsigned long i = 0; i < n; i++)
+			r->reset_next_substream();
+}
+
+//------------------------------------------------------------------------- 
+// Go to substream j of stream k of the default package seed, without
+// taking a stream from next_seed_.
+// 
+RNG::RNG (unsigned long stream, unsigned long substream) 
+{ 
+	link();
+	name_[0] = 0;
+	anti_ = false; 
+	inc_prec_ = false; 
+	set_stream (stream, substream);
+} 
+
+void RNG::set_stream (unsigned long k, unsigned long j) 
+{ 
+	double B1[3][3], B2[3][3]; 
+	for (int i = 0; i < 6; ++i) 
+		Ig_[i] = 12345.0; 
+	MatPowModM (A1p127, B1, m1, (long) k); 
+	MatPowModM (A2p127, B2, m2, (long) k); 
+	MatVecModM (B1, Ig_, Ig_, m1); 
+	MatVecModM (B2, &Ig_[3], &Ig_[3], m2); 
+	MatPowModM (A1p76, B1, m1, (long) j); 
+	MatPowModM (A2p76, B2, m2, (long) j); 
+	MatVecModM (B1, Ig_, Bg_, m1); 
+	MatVecModM (B2, &Ig_[3], &Bg_[3], m2); 
+	for (int i = 0; i < 6; ++i) 
+		Cg_[i] = Bg_[i]; 
+} 
+
 //------------------------------------------------------------------------- 
 void RNG::set_package_seed (const unsigned long seed[6]) 
 { 
@@ -112,6 +112,8 @@ public:
 #else
 	RNG(const char* name = "");
 	RNG(long seed);
+	RNG(unsigned long stream, unsigned long substream);
+	~RNG();
 	void init();
 	long seed();
 	void set_seed (long seed);
@@ -119,7 +121,12 @@ public:
 	double next_double();
 #endif /* OLD_RNG */
 
-	RNG(RNGSources source, int seed = 1) { set_seed(source, seed); };
+	RNG(RNGSources source, int seed = 1) {
+#ifndef OLD_RNG
+		link();
+#endif /* !OLD_RNG */
+		set_seed(source, seed);
+	};
 	void set_seed(RNGSources source, int seed = 1);
 	inline static RNG* defaultrng() { return (default_); }
 
@@ -155,6 +162,23 @@ public:
 	  is computed, and C g and B g are set to N g .
 	*/
 
+	static void next_substream_all (unsigned long n); 
+	/*
+	  Moves every RNG object, created by Tcl or by C++, n substreams on as
+	  reset_next_substream does, e.g. to start the runs of "$ns sweep" on
+	  different substreams.
+	*/
+
+	void set_stream (unsigned long stream, unsigned long substream); 
+	/*
+	  Makes this object stream number stream of the default package seed,
+	  i.e. the stream the (stream+1)-th declared RNG gets if
+	  set_package_seed is never called, positioned at the beginning of its
+	  substream number substream. Unlike declaring a new RNG, the seed of
+	  the next declared RNG is not modified. The constructor RNG(stream,
+	  substream) does the same for a new object.
+	*/
+
 	void set_antithetic (bool a); 
 	/*
 	  If a = true, the stream will start generating antithetic variates,
@@ -335,6 +359,13 @@ protected:   // need to be public?
 	  String to store the optional name of the current RngStream object. 
 	*/
 
+	RNG *next_rng_, *prev_rng_; 
+	static RNG *all_; 
+	void link (); 
+	/*
+	  List of all RNG objects, for next_substream_all.
+	*/
+
 	static double next_seed_[6]; 
 	/*
 	  Static vector to store the beginning state of the next RngStream to 
@@ -138,6 +138,8 @@ Phy802_15_4::Phy802_15_4(PHY_PIB *pp)
 		rxThisTotNum[i] = 0;
 	}
 	mac = 0;
+	// frames on other frequencies still count for carrier sense
+	freq_selective_ = 0;
 	T_transition_local_ = T_transition_; // 2.31 change: set local variable since WirelessPhy::T_transition_ is not visible to CsmaCA802_15_4
 }
 